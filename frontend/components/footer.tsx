@@ -1,8 +1,64 @@
+import { useEffect, useState } from "react";
+import { invoke } from "@tauri-apps/api/core";
+
+// Mirrors the Telemetry struct returned by the get_telemetry command
+interface Telemetry {
+  mips: number;
+  instructionsRetired: number;
+  virtualTimeRatio: number;
+  tlbHitRate: number;
+  idlePercentage: number;
+}
+
+// The emulator only refreshes its telemetry twice a second, polling faster wouldn't show anything new
+const PollInterval = 1000;
+
+function formatCount(value: number) {
+  const units = ["", "K", "M", "G", "T"];
+  let unit = 0;
+  while (value >= 1000 && unit < units.length - 1) {
+    value /= 1000;
+    unit += 1;
+  }
+
+  return `${value.toFixed(unit === 0 ? 0 : 1)}${units[unit]}`;
+}
+
+function TelemetryItem({ label, value }: { label: string, value: string }) {
+  return (
+    <div className="flex gap-1">
+      <span>{label}</span>
+      <span className="font-mono text-foreground">{value}</span>
+    </div>
+  );
+}
+
 export function Footer() {
+  const [telemetry, setTelemetry] = useState<Telemetry | null>(null);
+
+  useEffect(() => {
+    const poll = async () => {
+      setTelemetry(await invoke<Telemetry>("get_telemetry"));
+    };
+
+    void poll();
+    const interval = setInterval(() => void poll(), PollInterval);
+    return () => clearInterval(interval);
+  }, []);
+
   return (
     <div
       className="fixed inset-x-0 bottom-0 h-7 select-none border-t bg-background/80 backdrop-blur supports-[backdrop-filter]:bg-background/60"
     >
+      {telemetry && (
+        <div className="flex h-full items-center justify-end gap-4 px-3 text-xs text-muted-foreground">
+          <TelemetryItem label="MIPS" value={telemetry.mips.toFixed(1)}/>
+          <TelemetryItem label="Instret" value={formatCount(telemetry.instructionsRetired)}/>
+          <TelemetryItem label="Speed" value={`${telemetry.virtualTimeRatio.toFixed(2)}x`}/>
+          <TelemetryItem label="TLB" value={`${(telemetry.tlbHitRate * 100).toFixed(1)}%`}/>
+          <TelemetryItem label="Idle" value={`${telemetry.idlePercentage.toFixed(1)}%`}/>
+        </div>
+      )}
     </div>
   );
 }
@@ -3,6 +3,7 @@ import { useXTerm } from "react-xtermjs";
 import { FitAddon } from "@xterm/addon-fit";
 import { ResizablePanel } from "@/components/ui/resizable";
 import { listen } from '@tauri-apps/api/event';
+import { invoke } from "@tauri-apps/api/core";
 
 type WriteCommandData = {
     terminalId: string;
@@ -56,11 +57,16 @@ export function Terminal({ terminalId } : TerminalProps) {
                 instance.clear();
         })
 
+        const inputListener = instance.onData((data) => {
+            invoke("send_terminal_input", { terminalId: terminalId, data: data });
+        });
+
         document.addEventListener("resize", fitTerminal)
 
         return() => {
             writeUnlisten.then((unlistenFn) => unlistenFn());
             clearUnlisten.then((unlistenFn) => unlistenFn());
+            inputListener.dispose();
             window.removeEventListener('resize', fitTerminal)
         }
     }, [instance]);
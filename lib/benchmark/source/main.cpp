@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <emu/address_space.hpp>
+#include <emu/literals.hpp>
+#include <emu/utils.hpp>
+#include <emu/devices/ram.hpp>
+#include <emu/devices/8250_uart.hpp>
+#include <emu/devices/riscv/mmu.hpp>
+#include <emu/riscv/core.hpp>
+#include <emu/riscv/machine_mode_firmware.hpp>
+#include <emu/riscv/machine_mode_firmware_extensions.hpp>
+
+namespace {
+
+    using namespace ds;
+    using namespace ds::literals;
+
+    enum ExitCode {
+        ExitSuccess         = 0,
+        ExitInvalidUsage    = 2
+    };
+
+    // Every benchmark is measured this many times, the median is reported
+    constexpr static auto Repetitions = 5;
+    constexpr static auto DefaultMinTime = std::chrono::duration<double>(0.2);
+
+    struct Options {
+        std::string_view filter;
+        std::chrono::duration<double> min_time = DefaultMinTime;
+        bool json = false;
+    };
+
+    // Runs the measured operation the given number of times
+    using Operation = std::function<void(std::uint64_t iterations)>;
+
+    struct Benchmark {
+        std::string name;
+
+        // Creates all state the benchmark needs and returns the operation to measure
+        std::function<Operation()> setup;
+    };
+
+    struct Result {
+        std::string name;
+        std::uint64_t iterations;
+        double ns_per_op;
+    };
+
+    // Keeps the compiler from optimizing away computations whose result is never used
+    template<typename T>
+    auto do_not_optimize(const T &value) -> void {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    auto print_usage(const char *program_name) -> void {
+        std::fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "Measures the throughput of individual emulator subsystems.\n"
+            "\n"
+            "Options:\n"
+            "  --filter <text>       Only run benchmarks whose name contains the given text\n"
+            "  --min-time <seconds>  Minimum duration of a single measurement (default %.1f)\n"
+            "  --json                Print the results as JSON instead of a table\n",
+            program_name, DefaultMinTime.count()
+        );
+    }
+
+    auto parse_options(int argc, char **argv) -> std::optional<Options> {
+        Options options;
+
+        for (int i = 1; i < argc; i += 1) {
+            const std::string_view argument = argv[i];
+            if (argument == "--json") {
+                options.json = true;
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for argument '%s'\n", argv[i]);
+                return std::nullopt;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--filter") {
+                options.filter = value;
+            } else if (argument == "--min-time") {
+                options.min_time = std::chrono::duration<double>(std::strtod(value, nullptr));
+            } else {
+                std::fprintf(stderr, "Unknown argument '%s'\n", argv[i - 1]);
+                return std::nullopt;
+            }
+        }
+
+        return options;
+    }
+
+    auto measure(const Benchmark &benchmark, std::chrono::duration<double> min_time) -> Result {
+        const auto operation = benchmark.setup();
+
+        const auto time = [&](std::uint64_t iterations) {
+            const auto start = std::chrono::steady_clock::now();
+            operation(iterations);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+        };
+
+        // Find an iteration count that takes at least the minimum time
+        std::uint64_t iterations = 1;
+        for (auto elapsed = time(iterations); elapsed < min_time; elapsed = time(iterations)) {
+            const auto factor = elapsed.count() <= 0 ? 100.0 : std::clamp(min_time / elapsed * 1.2, 2.0, 100.0);
+            iterations = std::uint64_t(double(iterations) * factor);
+        }
+
+        std::vector<double> samples;
+        for (int i = 0; i < Repetitions; i += 1) {
+            samples.push_back(time(iterations).count() * 1'000'000'000 / double(iterations));
+        }
+        std::ranges::sort(samples);
+
+        return { benchmark.name, iterations, samples[samples.size() / 2] };
+    }
+
+    namespace encode {
+
+        constexpr auto r(std::uint32_t opcode, std::uint32_t rd, std::uint32_t funct3, std::uint32_t rs1, std::uint32_t rs2, std::uint32_t funct7) -> std::uint32_t {
+            return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+        }
+
+        constexpr auto i(std::uint32_t opcode, std::uint32_t rd, std::uint32_t funct3, std::uint32_t rs1, std::int32_t imm) -> std::uint32_t {
+            return ((std::uint32_t(imm) & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+        }
+
+        constexpr auto s(std::uint32_t funct3, std::uint32_t rs1, std::uint32_t rs2, std::int32_t imm) -> std::uint32_t {
+            const auto value = std::uint32_t(imm);
+            return (emu::util::extract_bits<5, 11>(value) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (emu::util::extract_bits<0, 4>(value) << 7) | 0x23;
+        }
+
+        constexpr auto b(std::uint32_t funct3, std::uint32_t rs1, std::uint32_t rs2, std::int32_t imm) -> std::uint32_t {
+            const auto value = std::uint32_t(imm);
+            return (emu::util::extract_bits<12, 12>(value) << 31) | (emu::util::extract_bits<5, 10>(value) << 25) | (rs2 << 20) | (rs1 << 15) |
+                   (funct3 << 12) | (emu::util::extract_bits<1, 4>(value) << 8) | (emu::util::extract_bits<11, 11>(value) << 7) | 0x63;
+        }
+
+        constexpr auto jal(std::uint32_t rd, std::int32_t imm) -> std::uint32_t {
+            const auto value = std::uint32_t(imm);
+            return (emu::util::extract_bits<20, 20>(value) << 31) | (emu::util::extract_bits<1, 10>(value) << 21) | (emu::util::extract_bits<11, 11>(value) << 20) |
+                   (emu::util::extract_bits<12, 19>(value) << 12) | (rd << 7) | 0x6F;
+        }
+
+        constexpr auto add(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2)     { return r(0x33, rd, 0b000, rs1, rs2, 0x00); }
+        constexpr auto sub(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2)     { return r(0x33, rd, 0b000, rs1, rs2, 0x20); }
+        constexpr auto xor_(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2)    { return r(0x33, rd, 0b100, rs1, rs2, 0x00); }
+        constexpr auto or_(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2)     { return r(0x33, rd, 0b110, rs1, rs2, 0x00); }
+        constexpr auto and_(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2)    { return r(0x33, rd, 0b111, rs1, rs2, 0x00); }
+        constexpr auto sltu(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2)    { return r(0x33, rd, 0b011, rs1, rs2, 0x00); }
+        constexpr auto addi(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm)     { return i(0x13, rd, 0b000, rs1, imm); }
+        constexpr auto andi(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm)     { return i(0x13, rd, 0b111, rs1, imm); }
+        constexpr auto slli(std::uint32_t rd, std::uint32_t rs1, std::int32_t shamt)   { return i(0x13, rd, 0b001, rs1, shamt); }
+        constexpr auto lw(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm)       { return i(0x03, rd, 0b010, rs1, imm); }
+        constexpr auto sw(std::uint32_t rs2, std::uint32_t rs1, std::int32_t imm)      { return s(0b010, rs1, rs2, imm); }
+        constexpr auto beq(std::uint32_t rs1, std::uint32_t rs2, std::int32_t imm)     { return b(0b000, rs1, rs2, imm); }
+        constexpr auto amo(std::uint32_t funct5, std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r(0x2F, rd, 0b010, rs1, rs2, funct5 << 2); }
+
+    }
+
+    // Executes a program that loops forever on a single core without MMU, one instruction per iteration
+    auto core_step(std::vector<std::uint32_t> program) -> Operation {
+        struct State {
+            emu::AddressSpace<std::uint32_t> address_space;
+            emu::dev::Ram ram { 64_KiB };
+            emu::riscv::Core core;
+        };
+
+        auto state = std::make_shared<State>();
+        state->address_space.map(0x0000'0000, &state->ram);
+        state->address_space.reset();
+        state->ram.write(0, { reinterpret_cast<const std::uint8_t *>(program.data()), program.size() * sizeof(std::uint32_t) });
+
+        state->core = emu::riscv::Core(0, &state->address_space);
+        state->core.reset();
+
+        // Data accessed by the load/store and AMO loops
+        state->core.x(10) = 32_KiB;
+
+        return [state](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i += 1) {
+                do_not_optimize(state->core.step());
+            }
+        };
+    }
+
+    auto read_physical(std::size_t peripheral_count) -> Operation {
+        constexpr static auto PeripheralSize = 4_KiB;
+
+        struct State {
+            emu::AddressSpace<std::uint32_t> address_space;
+            std::vector<std::unique_ptr<emu::dev::Ram>> peripherals;
+        };
+
+        auto state = std::make_shared<State>();
+        for (std::size_t i = 0; i < peripheral_count; i += 1) {
+            auto &peripheral = state->peripherals.emplace_back(std::make_unique<emu::dev::Ram>(PeripheralSize));
+            state->address_space.map(std::uint32_t(i * PeripheralSize), peripheral.get());
+        }
+        state->address_space.reset();
+
+        // Access all peripherals in turn so the cost of finding any of them is averaged
+        return [state, peripheral_count](std::uint64_t iterations) {
+            std::uint32_t value = 0;
+            std::size_t index = 0;
+            for (std::uint64_t i = 0; i < iterations; i += 1) {
+                do_not_optimize(state->address_space.read_physical(std::uint32_t(index * PeripheralSize), emu::util::to_byte_span(value)));
+                do_not_optimize(value);
+
+                index = index + 1 == peripheral_count ? 0 : index + 1;
+            }
+        };
+    }
+
+    // Translates an address mapped through a regular two level Sv32 page table
+    auto mmu_translate(bool tlb_hit) -> Operation {
+        constexpr static std::uint32_t RootPageTable    = 0x1000;
+        constexpr static std::uint32_t LeafPageTable    = 0x2000;
+        constexpr static std::uint32_t PhysicalPage     = 0x3000;
+        constexpr static std::uint32_t VirtualAddress   = 0x4000'0123;
+
+        constexpr static std::uint32_t V = 1U << 0, R = 1U << 1, W = 1U << 2, A = 1U << 6, D = 1U << 7;
+
+        struct State {
+            emu::AddressSpace<std::uint32_t> address_space;
+            emu::dev::Ram ram { 64_KiB };
+            emu::dev::riscv::MMU<std::uint32_t> mmu;
+            emu::riscv::Core core;
+        };
+
+        auto state = std::make_shared<State>();
+        state->address_space.map(0x0000'0000, &state->ram);
+        state->address_space.reset();
+
+        const std::uint32_t root_entry = ((LeafPageTable / 4_KiB) << 10) | V;
+        const std::uint32_t leaf_entry = ((PhysicalPage / 4_KiB) << 10) | V | R | W | A | D;
+        state->ram.write(RootPageTable + emu::util::extract_bits<22, 31>(VirtualAddress) * 4, emu::util::to_byte_span(root_entry));
+        state->ram.write(LeafPageTable + emu::util::extract_bits<12, 21>(VirtualAddress) * 4, emu::util::to_byte_span(leaf_entry));
+
+        state->core = emu::riscv::Core(0, &state->address_space);
+        state->core.reset();
+        state->core.satp() = emu::util::bit<31>() | (RootPageTable / 4_KiB);
+
+        return [state, tlb_hit](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i += 1) {
+                if (!tlb_hit)
+                    state->mmu.invalidate();
+
+                do_not_optimize(state->mmu.translate(state->core, VirtualAddress, emu::AccessType::Load));
+            }
+        };
+    }
+
+    auto sbi_call() -> Operation {
+        constexpr static std::uint32_t BaseExtension = 0x10;
+        constexpr static std::uint32_t GetSpecVersion = 0;
+
+        struct State {
+            emu::AddressSpace<std::uint32_t> address_space;
+            emu::riscv::Core core;
+            emu::riscv::m_mode::MachineModeFirmware<emu::riscv::m_mode::MachineModeFirmwareExtensions<std::uint32_t>> firmware;
+        };
+
+        auto state = std::make_shared<State>();
+        state->core = emu::riscv::Core(0, &state->address_space);
+        state->core.reset();
+        state->firmware.reset();
+
+        return [state](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; i += 1) {
+                do_not_optimize(state->firmware.sbi_call(state->core, BaseExtension, GetSpecVersion, 0, 0, 0, 0, 0, 0));
+            }
+        };
+    }
+
+    // Writes characters the way a polling console driver does: wait for the transmitter to be empty, then write the byte
+    auto uart_output() -> Operation {
+        constexpr static std::uint32_t BaseAddress = 0xF400'0000;
+        constexpr static std::uint32_t TransmitHoldingRegister = 0, LineStatusRegister = 5;
+
+        struct State {
+            emu::AddressSpace<std::uint32_t> address_space;
+            emu::dev::UART8250 uart;
+            std::uint64_t output_count = 0;
+        };
+
+        auto state = std::make_shared<State>();
+        state->uart.output_callback([state = state.get()](std::uint8_t) {
+            state->output_count += 1;
+        });
+        state->address_space.map(BaseAddress, &state->uart);
+        state->address_space.reset();
+
+        return [state](std::uint64_t iterations) {
+            std::uint8_t status = 0;
+            const std::uint8_t character = 'A';
+            for (std::uint64_t i = 0; i < iterations; i += 1) {
+                state->address_space.read_physical(BaseAddress + LineStatusRegister, emu::util::to_byte_span(status));
+                state->address_space.write_physical(BaseAddress + TransmitHoldingRegister, emu::util::to_byte_span(character));
+            }
+            do_not_optimize(state->output_count);
+        };
+    }
+
+    auto get_benchmarks() -> std::vector<Benchmark> {
+        using namespace encode;
+
+        std::vector<Benchmark> benchmarks = {
+            { "core.step/alu", [] {
+                return core_step({
+                    add(5, 5, 6), xor_(7, 7, 5), slli(8, 5, 3), sub(9, 8, 7),
+                    or_(6, 6, 9), and_(11, 9, 5), sltu(12, 11, 8), addi(6, 6, 1),
+                    jal(0, -32)
+                });
+            } },
+            { "core.step/branch", [] {
+                return core_step({
+                    addi(5, 5, 1), andi(6, 5, 1), beq(6, 0, 8), addi(7, 7, 1),
+                    jal(0, -16)
+                });
+            } },
+            { "core.step/load_store", [] {
+                return core_step({
+                    lw(5, 10, 0), addi(5, 5, 1), sw(5, 10, 4), lw(6, 10, 8),
+                    sw(6, 10, 12), sw(5, 10, 0),
+                    jal(0, -24)
+                });
+            } },
+            { "core.step/amo", [] {
+                constexpr static std::uint32_t AmoAdd = 0x00, AmoSwap = 0x01, LoadReserved = 0x02, StoreConditional = 0x03;
+                return core_step({
+                    addi(6, 0, 1), amo(AmoAdd, 5, 10, 6), amo(AmoSwap, 7, 10, 5),
+                    amo(LoadReserved, 8, 10, 0), amo(StoreConditional, 9, 10, 8),
+                    jal(0, -20)
+                });
+            } },
+            { "mmu.translate/hit", [] { return mmu_translate(true); } },
+            { "mmu.translate/miss", [] { return mmu_translate(false); } },
+            { "sbi_call/base.get_spec_version", [] { return sbi_call(); } },
+            { "uart8250.output", [] { return uart_output(); } },
+        };
+
+        for (const std::size_t peripheral_count : { 1, 10, 100 }) {
+            benchmarks.emplace_back("address_space.read_physical/" + std::to_string(peripheral_count), [peripheral_count] {
+                return read_physical(peripheral_count);
+            });
+        }
+
+        return benchmarks;
+    }
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+    if (!options.has_value()) {
+        print_usage(argv[0]);
+        return ExitInvalidUsage;
+    }
+
+    std::vector<Result> results;
+    for (const auto &benchmark : get_benchmarks()) {
+        if (!benchmark.name.contains(options->filter))
+            continue;
+
+        const auto &result = results.emplace_back(measure(benchmark, options->min_time));
+        if (!options->json)
+            std::printf("%-40s %14.2f ns/op %16.0f ops/s %14llu iterations\n",
+                result.name.c_str(), result.ns_per_op, 1'000'000'000 / result.ns_per_op, static_cast<unsigned long long>(result.iterations));
+    }
+
+    if (options->json) {
+        std::printf("[\n");
+        for (std::size_t i = 0; i < results.size(); i += 1) {
+            const auto &result = results[i];
+            std::printf("  {\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.3f,\"ops_per_second\":%.0f}%s\n",
+                result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+                result.ns_per_op, 1'000'000'000 / result.ns_per_op, i + 1 < results.size() ? "," : "");
+        }
+        std::printf("]\n");
+    }
+
+    return ExitSuccess;
+}
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <emu/elf.hpp>
+#include <emu/utils.hpp>
+#include <emu/devices/ram.hpp>
+#include <emu/riscv/emulator.hpp>
+#include <emu/devices/riscv/mmu.hpp>
+
+namespace {
+
+    using namespace ds;
+
+    enum ExitCode {
+        ExitAllPassed       = 0,
+        ExitFailure         = 1,
+        ExitInvalidUsage    = 2
+    };
+
+    // Room left behind the last segment for the stack and whatever scratch memory the test environment uses
+    constexpr static std::uint64_t ScratchMemorySize = 1 * 1024 * 1024;
+    constexpr static std::uint64_t RamAlignment = 1 * 1024 * 1024;
+
+    struct Options {
+        unsigned jobs = std::max(1U, std::thread::hardware_concurrency());
+        std::uint64_t max_steps = 10'000'000;
+        bool native_misaligned_access = false;
+        std::vector<std::string> paths;
+    };
+
+    enum class Status {
+        Passed,
+        Failed,
+        Timeout,
+        Halted,
+        LoadError
+    };
+
+    struct Result {
+        Status status = Status::LoadError;
+        std::string message;
+        std::uint32_t failed_test = 0;  // Number of the failing test case, as reported through tohost
+        std::uint64_t steps = 0;
+        std::uint64_t pc = 0;
+    };
+
+    // RV32 or RV64 machine, depending on the class of the test executable
+    template<typename T>
+    struct TestMachine {
+        explicit TestMachine(std::size_t ram_size) : ram(ram_size) { }
+
+        emu::riscv::Emulator<1, T> emulator;
+        emu::dev::BasicRam<T> ram;
+        emu::dev::riscv::MMU<T> mmu;
+    };
+
+    auto print_usage(const char *program_name) -> void {
+        std::fprintf(stderr,
+            "Usage: %s [options] <elf or directory>...\n"
+            "\n"
+            "Runs RISC-V conformance tests, such as the riscv-tests or riscv-arch-test suites, inside the emulator.\n"
+            "Every test is loaded into its own machine and runs until it writes its result to the 'tohost' symbol:\n"
+            "1 means the test passed, any other odd value reports the number of the failing test case shifted left by one.\n"
+            "Directories are searched recursively for ELF files. 32 bit executables run on an RV32 hart, 64 bit ones on an RV64 hart.\n"
+            "\n"
+            "The emulator starts harts in supervisor mode without any M-mode code running, so the tests need to be built\n"
+            "against a test environment that doesn't rely on machine mode CSRs or MRET to report their result.\n"
+            "\n"
+            "Options:\n"
+            "  --jobs <count>      Number of tests run in parallel\n"
+            "  --max-steps <n>     Number of steps after which a test that didn't report a result is considered hung\n"
+            "  --native-misaligned Perform misaligned loads and stores in the emulator instead of trapping to the test\n",
+            program_name
+        );
+    }
+
+    auto parse_options(int argc, char **argv) -> std::optional<Options> {
+        Options options;
+
+        for (int i = 1; i < argc; i += 1) {
+            const std::string_view argument = argv[i];
+            if (!argument.starts_with("--")) {
+                options.paths.emplace_back(argument);
+                continue;
+            }
+            if (argument == "--native-misaligned") {
+                options.native_misaligned_access = true;
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for argument '%s'\n", argv[i]);
+                return std::nullopt;
+            }
+
+            if (argument == "--jobs") {
+                options.jobs = std::max(1UL, std::strtoul(argv[++i], nullptr, 0));
+            } else if (argument == "--max-steps") {
+                options.max_steps = std::max(1ULL, std::strtoull(argv[++i], nullptr, 0));
+            } else {
+                std::fprintf(stderr, "Unknown argument '%s'\n", argv[i]);
+                return std::nullopt;
+            }
+        }
+
+        if (options.paths.empty())
+            return std::nullopt;
+
+        return options;
+    }
+
+    // Expands directories into the files they contain. Files that turn out not to be ELF files are skipped there,
+    // as test suites usually keep their disassembly listings and other build outputs right next to the binaries
+    auto collect_tests(const std::vector<std::string> &paths) -> std::vector<std::string> {
+        std::vector<std::string> tests;
+
+        for (const auto &path : paths) {
+            std::error_code error;
+            if (!std::filesystem::is_directory(path, error)) {
+                tests.push_back(path);
+                continue;
+            }
+
+            std::vector<std::string> directory_tests;
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(path, error)) {
+                if (!entry.is_regular_file())
+                    continue;
+
+                std::FILE *file = std::fopen(entry.path().c_str(), "rb");
+                if (file == nullptr)
+                    continue;
+
+                std::uint8_t magic[4] = { };
+                const auto bytes_read = std::fread(magic, 1, sizeof(magic), file);
+                std::fclose(file);
+
+                if (emu::ElfFile::is_elf({ magic, bytes_read }))
+                    directory_tests.push_back(entry.path().string());
+            }
+
+            std::ranges::sort(directory_tests);
+            tests.insert(tests.end(), directory_tests.begin(), directory_tests.end());
+        }
+
+        return tests;
+    }
+
+    template<typename T>
+    auto run_machine(const emu::ElfFile &elf, std::uint64_t base_address, std::uint64_t ram_size, std::uint64_t tohost, const Options &options) -> Result {
+        Result result;
+
+        // Machines are far too big to live on a worker thread's stack
+        auto machine = std::make_unique<TestMachine<T>>(ram_size);
+        auto &emulator = machine->emulator;
+        emulator.address_space().map(T(base_address), &machine->ram);
+        for (const auto &segment : elf.segments()) {
+            emulator.add_boot_image(T(segment.address), segment.data);
+        }
+
+        emulator.address_space().add_address_translator(&machine->mmu);
+        emulator.set_native_misaligned_access(options.native_misaligned_access);
+        emulator.power_up();
+        emulator.cores()[0].pc() = T(elf.entry());
+
+        // Only start watching once the boot images have been copied, they would trigger it right away otherwise
+        const auto tohost_address = T(tohost);
+        emulator.address_space().set_write_watch(typename emu::AddressSpace<T>::WatchRange { tohost_address, T(tohost_address + 4) });
+
+        for (; result.steps < options.max_steps; result.steps += 1) {
+            result.pc = emulator.current_core().pc();
+            emulator.step();
+
+            if (!emulator.is_powered_up()) {
+                result.status = Status::Halted;
+                result.message = "machine shut down without reporting a result";
+                return result;
+            }
+
+            if (!emulator.address_space().write_watch_triggered())
+                continue;
+
+            std::uint32_t value = 0;
+            emulator.address_space().read_physical(tohost_address, emu::util::to_byte_span(value));
+
+            // Tests may well clear tohost before writing their result
+            if (value == 0)
+                continue;
+
+            result.steps += 1;
+            if (value == 1) {
+                result.status = Status::Passed;
+            } else if ((value & 1) == 1) {
+                result.status = Status::Failed;
+                result.failed_test = value >> 1;
+            } else {
+                result.status = Status::Failed;
+                result.message = "unexpected value written to tohost";
+                result.failed_test = value;
+            }
+
+            return result;
+        }
+
+        result.status = Status::Timeout;
+        result.pc = emulator.current_core().pc();
+        return result;
+    }
+
+    auto run_test(const std::string &path, const Options &options) -> Result {
+        Result result;
+
+        const auto elf = emu::ElfFile::load(path);
+        if (!elf.has_value()) {
+            result.message = "not a valid ELF file";
+            return result;
+        }
+        if (elf->machine() != emu::ElfFile::MachineRiscV) {
+            result.message = "not a RISC-V executable";
+            return result;
+        }
+        if (elf->segments().empty()) {
+            result.message = "no loadable segments";
+            return result;
+        }
+
+        const auto tohost = elf->find_symbol("tohost");
+        if (tohost == nullptr) {
+            result.message = "no 'tohost' symbol";
+            return result;
+        }
+
+        // Map RAM right where the test was linked to instead of relocating it
+        std::uint64_t lowest_address = UINT64_MAX, highest_address = 0;
+        for (const auto &segment : elf->segments()) {
+            lowest_address  = std::min(lowest_address, segment.address);
+            highest_address = std::max(highest_address, segment.address + segment.memory_size);
+        }
+
+        const auto base_address = lowest_address & ~(RamAlignment - 1);
+        const auto ram_size = (highest_address - base_address + ScratchMemorySize + RamAlignment - 1) & ~(RamAlignment - 1);
+        if (elf->is_64bit())
+            return run_machine<std::uint64_t>(*elf, base_address, ram_size, tohost->value, options);
+
+        if (base_address + ram_size > UINT32_MAX) {
+            result.message = "segments don't fit into the 32 bit address space";
+            return result;
+        }
+
+        return run_machine<std::uint32_t>(*elf, base_address, ram_size, tohost->value, options);
+    }
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+    if (!options.has_value()) {
+        print_usage(argv[0]);
+        return ExitInvalidUsage;
+    }
+
+    const auto tests = collect_tests(options->paths);
+    if (tests.empty()) {
+        std::fprintf(stderr, "No tests found\n");
+        return ExitInvalidUsage;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // Every test runs in its own machine, so they can all run in parallel
+    std::vector<Result> results(tests.size());
+    std::atomic<std::size_t> next_test = 0;
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned i = 0; i < std::min<std::size_t>(options->jobs, results.size()); i += 1) {
+            workers.emplace_back([&] {
+                for (auto index = next_test++; index < results.size(); index = next_test++) {
+                    results[index] = run_test(tests[index], *options);
+                }
+            });
+        }
+    }
+
+    std::size_t passed = 0;
+    for (std::size_t i = 0; i < results.size(); i += 1) {
+        const auto &path = tests[i];
+        const auto &result = results[i];
+
+        switch (result.status) {
+            case Status::Passed:
+                passed += 1;
+                std::printf("PASS     %s (%llu steps)\n", path.c_str(), static_cast<unsigned long long>(result.steps));
+                break;
+            case Status::Failed:
+                if (result.message.empty())
+                    std::printf("FAIL     %s: test case %u failed at pc 0x%08llX\n", path.c_str(), result.failed_test, static_cast<unsigned long long>(result.pc));
+                else
+                    std::printf("FAIL     %s: %s (0x%08X) at pc 0x%08llX\n", path.c_str(), result.message.c_str(), result.failed_test, static_cast<unsigned long long>(result.pc));
+                break;
+            case Status::Timeout:
+                std::printf("TIMEOUT  %s: no result after %llu steps, pc 0x%08llX\n", path.c_str(), static_cast<unsigned long long>(result.steps), static_cast<unsigned long long>(result.pc));
+                break;
+            case Status::Halted:
+                std::printf("HALTED   %s: %s at pc 0x%08llX\n", path.c_str(), result.message.c_str(), static_cast<unsigned long long>(result.pc));
+                break;
+            case Status::LoadError:
+                std::printf("ERROR    %s: %s\n", path.c_str(), result.message.c_str());
+                break;
+        }
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::printf("\n%zu of %zu tests passed\n", passed, results.size());
+    std::fprintf(stderr, "Ran %zu tests in %.3fs\n", results.size(), elapsed.count());
+
+    return passed == results.size() ? ExitAllPassed : ExitFailure;
+}
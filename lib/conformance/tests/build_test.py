@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+# Assembles a test source into an executable the conformance runner can load. Only needs llvm-mc and llvm-objcopy.
+#
+# Usage: build_test.py <llvm-mc> <llvm-objcopy> <source> <output>
+#
+# Tests run in supervisor mode right from the start of their code at 0x80000000 and report their result by
+# storing to 'tohost' at 0x80001000: 1 if all test cases passed, (test case << 1) | 1 for the first one that failed.
+# Sources in rv32/ are built into 32 bit executables, sources in rv64/ into 64 bit ones. Compressed instructions are only
+# emitted after an explicit .option rvc, so tests of the base ISA also run on cores without the C extension.
+
+import pathlib
+import struct
+import subprocess
+import sys
+import tempfile
+
+CodeAddress = 0x8000_0000
+ToHostAddress = 0x8000_1000
+Features = '+m,+a,+f,+d,+zba,+zbb,+zbs'
+
+CodeOffset = 0x1000
+DataOffset = 0x2000
+SymbolsOffset = 0x3000
+
+
+def assemble(llvm_mc: str, llvm_objcopy: str, source: pathlib.Path, xlen: int) -> bytes:
+    with tempfile.TemporaryDirectory() as directory:
+        obj = pathlib.Path(directory) / 'test.o'
+        code = pathlib.Path(directory) / 'test.bin'
+        subprocess.check_call([llvm_mc, f'-triple=riscv{xlen}', f'-mattr={Features}', '-filetype=obj', '-o', obj, source])
+        subprocess.check_call([llvm_objcopy, '-O', 'binary', '-j', '.text', obj, code])
+
+        return code.read_bytes()
+
+
+# Executable with a code and a data segment, the latter holding tohost, and a symbol table naming tohost
+def link(code: bytes, xlen: int) -> bytes:
+    if len(code) > ToHostAddress - CodeAddress:
+        raise ValueError('code overlaps tohost')
+
+    data = bytes(8)
+    strings = b'\0tohost\0'
+    wide = xlen == 64
+
+    if wide:
+        header_size, program_header_size, section_header_size = 64, 56, 64
+        symbols = bytes(24) + struct.pack('<IBBHQQ', 1, 0x11, 0, 2, ToHostAddress, len(data))
+    else:
+        header_size, program_header_size, section_header_size = 52, 32, 40
+        symbols = bytes(16) + struct.pack('<IIIBBH', 1, ToHostAddress, len(data), 0x11, 0, 2)
+
+    strings_offset = SymbolsOffset + len(symbols)
+    section_headers_offset = (strings_offset + len(strings) + 7) & ~7
+
+    def program_header(offset, address, size, flags):
+        if wide:
+            return struct.pack('<IIQQQQQQ', 1, flags, offset, address, address, size, size, 0x1000)
+        return struct.pack('<IIIIIIII', 1, offset, address, address, size, size, flags, 0x1000)
+
+    def section_header(name, kind, flags, address, offset, size, link_index, info, alignment, entry_size):
+        if wide:
+            return struct.pack('<IIQQQQIIQQ', name, kind, flags, address, offset, size, link_index, info, alignment, entry_size)
+        return struct.pack('<IIIIIIIIII', name, kind, flags, address, offset, size, link_index, info, alignment, entry_size)
+
+    identification = b'\x7fELF' + bytes([2 if wide else 1, 1, 1, 0]) + bytes(8)
+    if wide:
+        header = identification + struct.pack('<HHIQQQIHHHHHH', 2, 243, 1, CodeAddress, header_size, section_headers_offset, 0,
+                                               header_size, program_header_size, 2, section_header_size, 5, 0)
+    else:
+        header = identification + struct.pack('<HHIIIIIHHHHHH', 2, 243, 1, CodeAddress, header_size, section_headers_offset, 0,
+                                               header_size, program_header_size, 2, section_header_size, 5, 0)
+
+    program_headers = program_header(CodeOffset, CodeAddress, len(code), 5) + program_header(DataOffset, ToHostAddress, len(data), 6)
+    section_headers = (bytes(section_header_size) +
+                       section_header(0, 1, 6, CodeAddress, CodeOffset, len(code), 0, 0, 4, 0) +
+                       section_header(0, 1, 3, ToHostAddress, DataOffset, len(data), 0, 0, 8, 0) +
+                       section_header(0, 2, 0, 0, SymbolsOffset, len(symbols), 4, 1, 8, len(symbols) // 2) +
+                       section_header(0, 3, 0, 0, strings_offset, len(strings), 0, 0, 1, 0))
+
+    image = bytearray(section_headers_offset + len(section_headers))
+    for offset, content in ((0, header), (header_size, program_headers), (CodeOffset, code), (DataOffset, data),
+                            (SymbolsOffset, symbols), (strings_offset, strings), (section_headers_offset, section_headers)):
+        image[offset:offset + len(content)] = content
+
+    return bytes(image)
+
+
+def main() -> int:
+    if len(sys.argv) != 5:
+        print(f'Usage: {sys.argv[0]} <llvm-mc> <llvm-objcopy> <source> <output>', file=sys.stderr)
+        return 2
+
+    llvm_mc, llvm_objcopy, source, output = sys.argv[1], sys.argv[2], pathlib.Path(sys.argv[3]), pathlib.Path(sys.argv[4])
+    xlen = {'rv32': 32, 'rv64': 64}.get(source.parent.name)
+    if xlen is None:
+        print(f'{source} is neither in rv32/ nor in rv64/', file=sys.stderr)
+        return 2
+
+    output.parent.mkdir(parents=True, exist_ok=True)
+    output.write_bytes(link(assemble(llvm_mc, llvm_objcopy, source, xlen), xlen))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,50 @@
+# RV32I compares against sign extended immediates
+.option norelax
+.text
+_start:
+    lui s1, 0x80001          # tohost
+    # test 2: slti with a positive register and a negative immediate
+    li gp, 2
+    li t1, 5
+    slti t2, t1, -1
+    bnez t2, fail
+    # test 3: sltiu sign extends the immediate before comparing unsigned
+    li gp, 3
+    sltiu t2, t1, -1
+    li t0, 1
+    bne t2, t0, fail
+    # test 4: slti with a negative register
+    li gp, 4
+    li t1, -5
+    slti t2, t1, 3
+    li t0, 1
+    bne t2, t0, fail
+    slti t2, t1, -6
+    bnez t2, fail
+    # test 5: sltiu with a negative register is a large unsigned number
+    li gp, 5
+    sltiu t2, t1, 3
+    bnez t2, fail
+    # test 6: sltiu rd, rs1, 1 is seqz
+    li gp, 6
+    sltiu t2, zero, 1
+    li t0, 1
+    bne t2, t0, fail
+    sltiu t2, t1, 1
+    bnez t2, fail
+    # test 7: slt and sltu on the same values
+    li gp, 7
+    li t3, 3
+    slt t2, t1, t3
+    li t0, 1
+    bne t2, t0, fail
+    sltu t2, t1, t3
+    bnez t2, fail
+    li t0, 1
+    sw t0, 0(s1)
+1:  j 1b
+fail:
+    slli gp, gp, 1
+    ori gp, gp, 1
+    sw gp, 0(s1)
+1:  j 1b
@@ -0,0 +1,130 @@
+# Zba, Zbb and Zbs instructions
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    li gp, 2
+    li a0, 0x00f00000
+    clz a1, a0
+    li t0, 8
+    bne a1, t0, fail
+    ctz a1, a0
+    li t0, 20
+    bne a1, t0, fail
+    cpop a1, a0
+    li t0, 4
+    bne a1, t0, fail
+    clz a1, zero
+    li t0, 32
+    bne a1, t0, fail
+    li gp, 3
+    li a0, 0x12345680
+    sext.b a1, a0
+    li t0, 0xffffff80
+    bne a1, t0, fail
+    li a0, 0x8001
+    sext.h a1, a0
+    li t0, 0xffff8001
+    bne a1, t0, fail
+    zext.h a1, a1
+    li t0, 0x8001
+    bne a1, t0, fail
+    li gp, 4
+    li a0, 0x12345678
+    rev8 a1, a0
+    li t0, 0x78563412
+    bne a1, t0, fail
+    li a0, 0x00120300
+    orc.b a1, a0
+    li t0, 0x00ffff00
+    bne a1, t0, fail
+    li gp, 5
+    li a0, 0x80000001
+    rori a1, a0, 1
+    li t0, 0xc0000000
+    bne a1, t0, fail
+    li a2, 33
+    rol a1, a0, a2
+    li t0, 0x00000003
+    bne a1, t0, fail
+    ror a1, a0, a2
+    li t0, 0xc0000000
+    bne a1, t0, fail
+    li gp, 6
+    li a0, 0xf0
+    li a2, 0x3c
+    andn a1, a0, a2
+    li t0, 0xc0
+    bne a1, t0, fail
+    orn a1, a0, a2
+    li t0, 0xfffffff3
+    bne a1, t0, fail
+    xnor a1, a0, a2
+    li t0, 0xffffff33
+    bne a1, t0, fail
+    li gp, 7
+    li a0, -5
+    li a2, 3
+    min a1, a0, a2
+    bne a1, a0, fail
+    max a1, a0, a2
+    bne a1, a2, fail
+    minu a1, a0, a2
+    bne a1, a2, fail
+    maxu a1, a0, a2
+    bne a1, a0, fail
+    li gp, 8
+    li a0, 10
+    li a2, 1000
+    sh1add a1, a0, a2
+    li t0, 1020
+    bne a1, t0, fail
+    sh2add a1, a0, a2
+    li t0, 1040
+    bne a1, t0, fail
+    sh3add a1, a0, a2
+    li t0, 1080
+    bne a1, t0, fail
+    li gp, 9
+    li a0, 0x10
+    bseti a1, a0, 31
+    li t0, 0x80000010
+    bne a1, t0, fail
+    bclri a1, a1, 4
+    li t0, 0x80000000
+    bne a1, t0, fail
+    binvi a1, a1, 0
+    li t0, 0x80000001
+    bne a1, t0, fail
+    bexti a2, a1, 31
+    li t0, 1
+    bne a2, t0, fail
+    li a3, 36
+    bset a2, zero, a3
+    li t0, 16
+    bne a2, t0, fail
+    bclr a2, a1, a3
+    bne a2, a1, fail
+    binv a2, a1, a3
+    li t0, 0x80000011
+    bne a2, t0, fail
+    bext a2, a2, a3
+    li t0, 1
+    bne a2, t0, fail
+    li gp, 10
+    li a0, 0x123
+    slli a1, a0, 4
+    srli a1, a1, 4
+    bne a1, a0, fail
+    li a0, -64
+    srai a1, a0, 3
+    li t0, -8
+    bne a1, t0, fail
+    li t0, 1
+    sw t0, 0(s1)
+1:  j 1b
+fail:
+    slli gp, gp, 1
+    ori gp, gp, 1
+    sw gp, 0(s1)
+1:  j 1b
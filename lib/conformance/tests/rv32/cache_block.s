@@ -0,0 +1,54 @@
+# Zicbom and Zicboz cache block operations
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    li s2, 0x80002000
+    li gp, 2
+    li t0, -1
+    li t1, 0
+1:  add t2, s2, t1
+    sw t0, 0(t2)
+    addi t1, t1, 4
+    li t3, 256
+    blt t1, t3, 1b
+    addi a0, s2, 64+13      # unaligned address inside the second block
+    .insn i 0x0F, 2, x0, a0, 4
+    lw a1, 60(s2)
+    bne a1, t0, fail
+    lw a1, 64(s2)
+    bnez a1, fail
+    lw a1, 124(s2)
+    bnez a1, fail
+    lw a1, 128(s2)
+    bne a1, t0, fail
+    li gp, 3
+    .insn i 0x0F, 2, x0, s2, 1
+    .insn i 0x0F, 2, x0, s2, 2
+    .insn i 0x0F, 2, x0, s2, 0
+    lw a1, 0(s2)
+    bne a1, t0, fail
+    # test 4: access fault outside RAM
+    li gp, 4
+    la t0, trap
+    csrw stvec, t0
+    li s3, 0
+    li a0, 0x10000000
+    .insn i 0x0F, 2, x0, a0, 4
+    li t0, 7
+    bne s3, t0, fail
+    li t0, 1
+    sw t0, 0(s1)
+1:  j 1b
+fail:
+    slli gp, gp, 1
+    ori gp, gp, 1
+    sw gp, 0(s1)
+1:  j 1b
+.align 2
+trap:
+    csrr s3, scause
+    csrr t0, sepc
+    addi t0, t0, 4
+    csrw sepc, t0
+    sret
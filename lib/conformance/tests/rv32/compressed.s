@@ -0,0 +1,106 @@
+# RV32C compressed instructions
+.option norelax
+.option rvc
+.text
+_start:
+    lui s1, 0x80001         # tohost
+    li gp, 0
+    # test 2: c.li / c.addi / c.mv / c.add
+    li gp, 2
+    c.li a1, -5
+    c.addi a1, 7
+    c.mv a2, a1
+    c.add a2, a1
+    li t0, 4
+    bne a2, t0, fail
+    # test 3: c.lui, c.srli, c.srai, c.andi, c.slli
+    li gp, 3
+    c.lui a3, 0xfffff
+    c.srai a3, 4
+    li t0, 0xffffff00
+    bne a3, t0, fail
+    c.srli a3, 8
+    li t0, 0x00ffffff
+    bne a3, t0, fail
+    c.andi a3, -16
+    li t0, 0x00fffff0
+    bne a3, t0, fail
+    c.slli a3, 4
+    li t0, 0x0fffff00
+    bne a3, t0, fail
+    # test 4: c.sub c.xor c.or c.and
+    li gp, 4
+    li a4, 0xf0
+    li a5, 0x3c
+    mv s0, a4
+    c.sub s0, a5
+    li t0, 0xb4
+    bne s0, t0, fail
+    mv s0, a4
+    c.xor s0, a5
+    li t0, 0xcc
+    bne s0, t0, fail
+    mv s0, a4
+    c.or s0, a5
+    li t0, 0xfc
+    bne s0, t0, fail
+    mv s0, a4
+    c.and s0, a5
+    li t0, 0x30
+    bne s0, t0, fail
+    # test 5: stack: c.addi16sp, c.addi4spn, c.swsp/c.lwsp, c.sw/c.lw
+    li gp, 5
+    lui sp, 0x80003
+    c.addi16sp sp, -64
+    li t0, 0x12345678
+    c.swsp t0, 60(sp)
+    c.lwsp t1, 60(sp)
+    bne t0, t1, fail
+    c.addi4spn a5, sp, 16
+    li t0, 0xcafe
+    c.sw a4, 4(a5)
+    c.lw s0, 4(a5)
+    bne a4, s0, fail
+    lw t1, 20(sp)
+    bne a4, t1, fail
+    # test 6: c.j / c.jal / c.jr / c.jalr / c.beqz / c.bnez
+    li gp, 6
+    c.j 1f
+    j fail
+1:  c.jal func
+    li t0, 42
+    bne a0, t0, fail
+    la t2, func
+    c.jalr t2
+    bne a0, t0, fail
+    la t2, 2f
+    c.jr t2
+    j fail
+2:  li s0, 0
+    c.beqz s0, 3f
+    j fail
+3:  c.bnez s0, fail
+    li s0, 1
+    c.bnez s0, 4f
+    j fail
+4:
+    # test 7: 32 bit instruction at a 2 byte aligned address, and link address of c.jal
+    li gp, 7
+    c.nop
+    auipc t0, 0
+    c.jal 5f
+5:  sub t1, ra, t0
+    li t2, 6
+    bne t1, t2, fail
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+    j pass
+fail:
+    slli t0, gp, 1
+    ori t0, t0, 1
+    sw t0, 0(s1)
+    j fail
+func:
+    li a0, 42
+    c.jr ra
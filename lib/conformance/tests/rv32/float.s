@@ -0,0 +1,229 @@
+# F and D extensions, including the sstatus.FS gating
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    li s2, 0x80001100       # scratch
+    # test 2: FP disabled -> illegal instruction; install trap handler
+    li gp, 2
+    la t0, trap
+    csrw stvec, t0
+    li s3, 0
+    fadd.s f0, f1, f2
+    li t0, 1
+    bne s3, t0, fail
+    li t0, 0x2000
+    csrs sstatus, t0
+    # test 3: fadd.s and flags
+    li gp, 3
+    li t0, 0x3fc00000       # 1.5
+    fmv.w.x f1, t0
+    li t0, 0x40200000       # 2.5
+    fmv.w.x f2, t0
+    fadd.s f3, f1, f2
+    fmv.x.w a0, f3
+    li t0, 0x40800000
+    bne a0, t0, fail
+    csrr a0, fflags
+    bnez a0, fail
+    # SD/FS dirty
+    csrr a0, sstatus
+    li t0, 0x80006000
+    and a0, a0, t0
+    bne a0, t0, fail
+    # test 4: div by zero sets DZ
+    li gp, 4
+    fmv.w.x f4, zero
+    fdiv.s f5, f1, f4
+    csrr a0, fflags
+    li t0, 0x08
+    bne a0, t0, fail
+    fclass.s a0, f5
+    li t0, 0x80
+    bne a0, t0, fail
+    csrw fflags, zero
+    # test 5: inexact 1/3 and canonical NaN 0/0
+    li gp, 5
+    li t0, 0x40400000
+    fmv.w.x f6, t0
+    li t0, 0x3f800000
+    fmv.w.x f7, t0
+    fdiv.s f8, f7, f6
+    csrr a0, fflags
+    li t0, 1
+    bne a0, t0, fail
+    fdiv.s f8, f4, f4
+    fmv.x.w a0, f8
+    li t0, 0x7fc00000
+    bne a0, t0, fail
+    csrr a0, fflags
+    li t0, 0x11
+    bne a0, t0, fail
+    # test 6: double arithmetic via fld/fsd and fcvt
+    li gp, 6
+    li t0, 7
+    fcvt.d.w f10, t0
+    li t0, -2
+    fcvt.d.w f11, t0
+    fmul.d f12, f10, f11
+    fcvt.w.d a0, f12
+    li t0, -14
+    bne a0, t0, fail
+    fsd f12, 0(s2)
+    fld f13, 0(s2)
+    feq.d a0, f12, f13
+    beqz a0, fail
+    lw a0, 4(s2)
+    li t0, 0xc02c0000       # -14.0 high word
+    bne a0, t0, fail
+    # test 7: rounding modes on fcvt.w.s
+    li gp, 7
+    li t0, 0x40200000       # 2.5
+    fmv.w.x f1, t0
+    fcvt.w.s a0, f1, rne
+    li t0, 2
+    bne a0, t0, fail
+    fcvt.w.s a0, f1, rmm
+    li t0, 3
+    bne a0, t0, fail
+    fcvt.w.s a0, f1, rdn
+    li t0, 2
+    bne a0, t0, fail
+    fcvt.w.s a0, f1, rup
+    li t0, 3
+    bne a0, t0, fail
+    fneg.s f2, f1
+    fcvt.w.s a0, f2, rtz
+    li t0, -2
+    bne a0, t0, fail
+    # saturation
+    fcvt.wu.s a0, f2
+    bnez a0, fail
+    csrw fcsr, zero
+    fcvt.w.s a0, f8          # NaN
+    li t0, 0x7fffffff
+    bne a0, t0, fail
+    csrr a0, fflags
+    li t0, 0x10
+    bne a0, t0, fail
+    # test 8: dynamic rounding via frm: 1/3 rounded up vs down
+    li gp, 8
+    li t0, 2
+    csrw frm, t0            # RDN
+    fdiv.s f20, f7, f6
+    li t0, 3
+    csrw frm, t0            # RUP
+    fdiv.s f21, f7, f6
+    fmv.x.w a0, f20
+    fmv.x.w a1, f21
+    addi a0, a0, 1
+    bne a0, a1, fail
+    csrr a0, fcsr
+    li t0, 0x71
+    bne a0, t0, fail
+    # invalid frm -> illegal
+    li t0, 5
+    csrw frm, t0
+    li s3, 0
+    fadd.s f0, f1, f2
+    li t0, 1
+    bne s3, t0, fail
+    csrw frm, zero
+    # test 9: fma / fnmsub
+    li gp, 9
+    li t0, 0x40000000       # 2
+    fmv.w.x f1, t0
+    li t0, 0x40400000       # 3
+    fmv.w.x f2, t0
+    li t0, 0x3f800000       # 1
+    fmv.w.x f3, t0
+    fmadd.s f4, f1, f2, f3
+    fcvt.w.s a0, f4
+    li t0, 7
+    bne a0, t0, fail
+    fnmsub.s f4, f1, f2, f3
+    fcvt.w.s a0, f4
+    li t0, -5
+    bne a0, t0, fail
+    fmsub.s f4, f1, f2, f3
+    fcvt.w.s a0, f4
+    li t0, 5
+    bne a0, t0, fail
+    fnmadd.s f4, f1, f2, f3
+    fcvt.w.s a0, f4
+    li t0, -7
+    bne a0, t0, fail
+    # test 10: min/max with -0/+0 and NaN, sgnj
+    li gp, 10
+    fmv.w.x f1, zero
+    fneg.s f2, f1
+    fmin.s f3, f1, f2
+    fmv.x.w a0, f3
+    li t0, 0x80000000
+    bne a0, t0, fail
+    fmax.s f3, f2, f1
+    fmv.x.w a0, f3
+    bnez a0, fail
+    fmin.s f3, f8, f7
+    feq.s a0, f3, f7
+    beqz a0, fail
+    fabs.s f3, f2
+    fmv.x.w a0, f3
+    bnez a0, fail
+    # test 11: NaN boxing: a double read as single is the canonical NaN
+    li gp, 11
+    fcvt.s.d f3, f12
+    fcvt.w.s a0, f3
+    li t0, -14
+    bne a0, t0, fail
+    fadd.s f3, f12, f12      # improperly boxed
+    fmv.x.w a0, f3
+    li t0, 0x7fc00000
+    bne a0, t0, fail
+    # test 12: flt/fle, conversions unsigned, sqrt
+    li gp, 12
+    flt.s a0, f1, f7
+    beqz a0, fail
+    fle.s a0, f7, f1
+    bnez a0, fail
+    li t0, 0xffffffff
+    fcvt.d.wu f14, t0
+    fcvt.wu.d a0, f14
+    bne a0, t0, fail
+    li t0, 0x41100000        # 9
+    fmv.w.x f1, t0
+    fsqrt.s f2, f1
+    fcvt.w.s a0, f2
+    li t0, 3
+    bne a0, t0, fail
+    # flw/fsw
+    fsw f2, 8(s2)
+    flw f3, 8(s2)
+    feq.s a0, f2, f3
+    beqz a0, fail
+    # compressed fld/fsd
+    mv s0, s2
+    fmv.d f10, f12
+.option push
+.option rvc
+    c.fsd f10, 16(s0)
+    c.fld f9, 16(s0)
+.option pop
+    feq.d a0, f9, f12
+    beqz a0, fail
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+1:  j 1b
+fail:
+    slli gp, gp, 1
+    ori gp, gp, 1
+    sw gp, 0(s1)
+1:  j 1b
+.align 2
+trap:
+    li s3, 1
+    csrr t0, sepc
+    addi t0, t0, 4
+    csrw sepc, t0
+    sret
@@ -0,0 +1,85 @@
+# Supervisor timer interrupts set up through the SBI TIME extension
+.option norelax
+.text
+_start:
+    lui s1, 0x80001          # tohost
+    la t0, trap
+    csrw stvec, t0
+    li s2, 0                 # number of traps taken
+    # test 2: no interrupt while STIE is clear
+    li gp, 2
+    li a7, 0x54494D45        # TIME
+    li a6, 0
+    li a0, 0
+    li a1, 0
+    ecall                    # set_timer(0), fires right away
+    nop
+    nop
+    bnez s2, fail
+    # test 3: still nothing with STIE set but SIE clear
+    li gp, 3
+    li t0, 0x20
+    csrs sie, t0
+    nop
+    nop
+    bnez s2, fail
+    # test 4: setting SIE takes it
+    li gp, 4
+    csrsi sstatus, 2
+    nop
+    li t0, 1
+    bne s2, t0, fail
+    li t0, 0x80000005
+    bne s3, t0, fail
+    # test 5: WFI wakes up with interrupts disabled, without trapping
+    li gp, 5
+    csrci sstatus, 2
+    li a7, 0x54494D45
+    li a6, 0
+    li a0, 200
+    li a1, 0
+    ecall
+    wfi
+    li t0, 1
+    bne s2, t0, fail
+    csrr t0, sip
+    andi t0, t0, 0x20
+    beqz t0, fail
+    # test 6: supervisor interrupts are always enabled in user mode
+    li gp, 6
+    la t0, user
+    csrw sepc, t0
+    li t0, 0x120             # SPP and SPIE
+    csrc sstatus, t0
+    sret
+user:
+    nop
+    j fail
+after_user:
+    li t0, 2
+    bne s2, t0, fail
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+    j pass
+fail:
+    slli t0, gp, 1
+    ori t0, t0, 1
+    sw t0, 0(s1)
+    j fail
+.balign 4
+trap:
+    addi s2, s2, 1
+    csrr s3, scause
+    li a7, 0x54494D45        # push the timer out
+    li a6, 0
+    li a0, -1
+    li a1, -1
+    ecall
+    li t0, 2
+    bne s2, t0, 1f
+    la t0, after_user        # second trap comes from user mode, resume in S-mode
+    csrw sepc, t0
+    li t0, 0x100
+    csrs sstatus, t0
+1:  sret
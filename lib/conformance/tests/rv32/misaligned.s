@@ -0,0 +1,100 @@
+# Misaligned loads and stores, either performed natively or trapped to the test
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    la t0, trap
+    csrw stvec, t0
+    li s2, 0x80003000
+    li gp, 2
+    # detect mode: misaligned load either traps (s3 = 4) or succeeds
+    li s3, 0
+    li t0, 0x44332211
+    sw t0, 0(s2)
+    li t0, 0x88776655
+    sw t0, 4(s2)
+    lw a0, 1(s2)
+    li t0, 4
+    beq s3, t0, trapping
+    li t0, 0x55443322
+    bne a0, t0, fail
+    li gp, 3
+    lhu a0, 3(s2)
+    li t0, 0x5544
+    bne a0, t0, fail
+    lh a0, 7(s2)
+    li t0, 0x88
+    bnez s3, fail
+    # test 4: store across page boundary
+    li gp, 4
+    li a1, 0x80002ffd
+    li t0, 0xaabbccdd
+    sw t0, 0(a1)
+    lbu a0, 0(a1)
+    li t0, 0xdd
+    bne a0, t0, fail
+    lbu a0, 3(a1)
+    li t0, 0xaa
+    bne a0, t0, fail
+    lw a0, 0(a1)
+    li t0, 0xaabbccdd
+    bne a0, t0, fail
+    # test 5: AMO still traps
+    li gp, 5
+    li s3, 0
+    amoadd.w a0, t0, (a1)
+    li t0, 6
+    bne s3, t0, fail
+    # test 6: access crossing the end of RAM faults as a whole
+    li gp, 6
+    li s3, 0
+    li a1, 0x801ffffe
+    sw zero, -2(a1)
+    li t0, 0x12345678
+    sw t0, 0(a1)
+    li t0, 7
+    bne s3, t0, fail
+    lw a0, -4(a1)
+    bnez a0, fail
+    # test 7: fld misaligned
+    li gp, 7
+    li t0, 0x2000
+    csrs sstatus, t0
+    fld f1, 1(s2)
+    fsd f1, 17(s2)
+    lw a0, 18(s2)
+    li t0, 0x66554433
+    bne a0, t0, fail
+    j reservation
+trapping:
+    li gp, 8
+    csrr a0, stval
+    addi t0, s2, 1
+    bne a0, t0, fail
+    # test 9: LR always traps when misaligned and reports the address
+reservation:
+    li gp, 9
+    li s3, 0
+    csrw stval, zero
+    addi a1, s2, 2
+    lr.w a0, (a1)
+    li t0, 4
+    bne s3, t0, fail
+    csrr a0, stval
+    bne a0, a1, fail
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+1:  j 1b
+fail:
+    slli gp, gp, 1
+    ori gp, gp, 1
+    sw gp, 0(s1)
+1:  j 1b
+.align 2
+trap:
+    csrr s3, scause
+    csrr t0, sepc
+    addi t0, t0, 4
+    csrw sepc, t0
+    sret
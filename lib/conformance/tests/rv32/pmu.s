@@ -0,0 +1,186 @@
+# Counter CSRs and the SBI PMU extension
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    la t0, trap
+    csrw stvec, t0
+    li gp, 2
+    rdinstret a0
+    nop
+    nop
+    rdinstret a1
+    sub a1, a1, a0
+    li t0, 3
+    bne a1, t0, fail
+    li gp, 3
+    rdcycle a0
+    nop
+    rdcycle a1
+    sub a1, a1, a0
+    li t0, 2
+    bne a1, t0, fail
+    li gp, 4
+    csrr a0, 0xC06
+    li t1, 1
+    bnez t1, 1f
+1:  beqz t1, fail
+    bnez t1, 2f
+2:  csrr a1, 0xC06
+    sub a1, a1, a0
+    li t0, 2
+    bne a1, t0, fail
+    li gp, 5
+    li s3, 0
+    csrw cycle, zero
+    li t0, 2
+    bne s3, t0, fail
+    li gp, 6
+    li a7, 0x504D55
+    li a6, 0
+    ecall
+    bnez a0, fail
+    li t0, 7
+    bne a1, t0, fail
+    li a6, 1
+    li a0, 2
+    ecall
+    bnez a0, fail
+    li t0, 0x3fc02
+    bne a1, t0, fail
+    li gp, 7
+    li a6, 2
+    li a0, 0
+    li a1, 0x7f
+    li a2, 0
+    li a3, 2
+    li a4, 0
+    li a5, 0
+    ecall
+    bnez a0, fail
+    li t0, 2
+    bne a1, t0, fail
+    li a6, 4
+    li a0, 2
+    li a1, 1
+    li a2, 0
+    ecall
+    bnez a0, fail
+    rdinstret s4
+    nop
+    rdinstret s5
+    bne s4, s5, fail
+    li a6, 4
+    li a0, 2
+    li a1, 1
+    li a2, 0
+    ecall
+    li t0, -8
+    bne a0, t0, fail
+    li a6, 3
+    li a0, 2
+    li a1, 1
+    li a2, 1
+    li a3, 1000
+    li a4, 0
+    ecall
+    bnez a0, fail
+    rdinstret s4
+    addi s4, s4, -1000
+    li t0, 5
+    bgeu s4, t0, fail
+    li gp, 8
+    li a6, 2
+    li a0, 0
+    li a1, 0x7f
+    li a2, 0
+    li a3, 0x20000
+    li a4, 5
+    li a5, 0
+    ecall
+    bnez a0, fail
+    li t0, 5
+    bne a1, t0, fail
+    # cycles config on instret-only mask fails
+    li a6, 2
+    li a0, 2
+    li a1, 1
+    li a2, 0
+    li a3, 1
+    li a4, 0
+    ecall
+    li t0, -2
+    bne a0, t0, fail
+    # dtlb miss event
+    li a6, 2
+    li a0, 0
+    li a1, 0x7f
+    li a2, 0
+    li a3, 0x1001b
+    ecall
+    bnez a0, fail
+    li t0, 3
+    bne a1, t0, fail
+    # time is no performance counter and keeps running
+    li gp, 9
+    li a6, 1
+    li a0, 1
+    ecall
+    li t0, -3
+    bne a0, t0, fail
+    li a6, 4
+    li a0, 1
+    li a1, 1
+    li a2, 0
+    ecall
+    li t0, -3
+    bne a0, t0, fail
+    # only configured counters can be started or stopped
+    li gp, 10
+    li a6, 4
+    li a0, 0
+    li a1, 1
+    li a2, 0
+    ecall
+    li t0, -3
+    bne a0, t0, fail
+    li a6, 3
+    li a0, 4
+    li a1, 1
+    li a2, 0
+    ecall
+    li t0, -3
+    bne a0, t0, fail
+    rdcycle a0
+    nop
+    rdcycle a1
+    beq a0, a1, fail
+    # stopping with reset releases the counter
+    li a6, 4
+    li a0, 2
+    li a1, 1
+    li a2, 1
+    ecall
+    bnez a0, fail
+    li a6, 4
+    li a0, 2
+    li a1, 1
+    li a2, 0
+    ecall
+    li t0, -3
+    bne a0, t0, fail
+    li t0, 1
+    sw t0, 0(s1)
+1:  j 1b
+fail:
+    slli gp, gp, 1
+    ori gp, gp, 1
+    sw gp, 0(s1)
+1:  j 1b
+.align 2
+trap:
+    csrr s3, scause
+    csrr t0, sepc
+    addi t0, t0, 4
+    csrw sepc, t0
+    sret
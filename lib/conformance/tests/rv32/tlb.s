@@ -0,0 +1,82 @@
+# Sv32 translation, including TLB entries surviving traps and permission changes
+.option norelax
+.text
+_start:
+    lui s1, 0x80001          # tohost
+    la t0, trap
+    csrw stvec, t0
+    li s2, 0
+    li s4, 0x80010000
+    li t0, 0x200000CF        # root[0x200]: identity megapage
+    li t1, 0x800
+    add t1, t1, s4
+    sw t0, 0(t1)
+    li t0, 0x20004401        # root[1] -> L0 at 0x80011000
+    sw t0, 4(s4)
+    li t0, 0x20008057        # L0[0]: user page at 0x80020000, V R W U A, not dirty
+    li s5, 0x80011000
+    sw t0, 0(s5)
+    li t0, 0x1234
+    li t1, 0x80020000
+    sw t0, 0(t1)
+    li t0, 0x80080010        # Sv32, root 0x80010
+    csrw satp, t0
+    sfence.vma
+    # test 2: supervisor access to user pages with SUM
+    li gp, 2
+    li t0, 0x40000
+    csrs sstatus, t0
+    li a0, 0x400000
+    lw a1, 0(a0)
+    li t0, 0x1234
+    bne a1, t0, fail
+    # test 3: first store sets D even though the page has been cached by the load
+    li gp, 3
+    li t0, 0x5678
+    sw t0, 0(a0)
+    lw t1, 0(s5)
+    andi t1, t1, 0x80
+    beqz t1, fail
+    # test 4: clearing SUM takes effect without a fence
+    li gp, 4
+    li t0, 0x40000
+    csrc sstatus, t0
+.option push
+.option norvc
+    lw a1, 0(a0)
+.option pop
+    li t0, 1
+    bne s2, t0, fail
+    li t0, 13
+    bne s3, t0, fail
+    # test 5: traps keep cached translations usable
+    li gp, 5
+.option push
+.option norvc
+    unimp
+.option pop
+    li t0, 2
+    bne s2, t0, fail
+    li t0, 0x40000
+    csrs sstatus, t0
+    lw a1, 0(a0)
+    li t0, 0x5678
+    bne a1, t0, fail
+    csrw satp, zero
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+    j pass
+fail:
+    slli t0, gp, 1
+    ori t0, t0, 1
+    sw t0, 0(s1)
+    j fail
+.balign 4
+trap:
+    addi s2, s2, 1
+    csrr s3, scause
+    csrr t4, sepc
+    addi t4, t4, 4
+    csrw sepc, t4
+    sret
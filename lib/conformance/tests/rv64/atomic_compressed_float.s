@@ -0,0 +1,141 @@
+# RV64 A, C, F and D instructions
+.option norelax
+.option rvc
+.text
+_start:
+    lui s1, 0x80001
+    slli s1, s1, 32
+    srli s1, s1, 32
+    lui sp, 0x80003
+    slli sp, sp, 32
+    srli sp, sp, 32
+    # test 2: amo.d
+    li gp, 2
+    li a0, 0x100000000
+    sd a0, 0(sp)
+    li a1, 0x0ffffffff
+    amoadd.d a2, a1, (sp)
+    bne a2, a0, fail
+    ld a3, 0(sp)
+    li t0, 0x1ffffffff
+    bne a3, t0, fail
+    li a1, -1
+    amomaxu.d a2, a1, (sp)
+    ld a3, 0(sp)
+    bne a3, a1, fail
+    li a1, 5
+    amomin.d a2, a1, (sp)
+    ld a3, 0(sp)
+    li t0, -1
+    bne a3, t0, fail
+    # test 3: amo.w sign extends and only touches the word
+    li gp, 3
+    li a0, 0x7fffffff
+    sd a0, 8(sp)
+    addi t1, sp, 8
+    li a1, 1
+    amoadd.w a2, a1, (t1)
+    bne a2, a0, fail
+    lw a3, 0(t1)
+    li t0, 0xffffffff80000000
+    bne a3, t0, fail
+    ld a3, 0(t1)
+    li t0, 0x80000000
+    bne a3, t0, fail
+    # test 4: lr.d / sc.d
+    li gp, 4
+    lr.d a2, (sp)
+    li a1, 0x123456789
+    sc.d a3, a1, (sp)
+    bnez a3, fail
+    ld a2, 0(sp)
+    bne a2, a1, fail
+    sc.d a3, a1, (sp)
+    beqz a3, fail
+    # test 5: compressed RV64 instructions
+    li gp, 5
+    li a0, 0x7fffffff
+    c.addiw a0, 1
+    li t0, 0xffffffff80000000
+    bne a0, t0, fail
+    li a4, 0x7fffffff
+    li a5, 0x7fffffff
+    c.addw a4, a5
+    li t0, -2
+    bne a4, t0, fail
+    li a4, 0
+    c.subw a4, a5
+    li t0, 0xffffffff80000001
+    bne a4, t0, fail
+    li a5, 0x1122334455667788
+    mv s0, sp
+    c.sd a5, 16(s0)
+    c.ld a4, 16(s0)
+    bne a4, a5, fail
+    c.sdsp a5, 248(sp)
+    c.ldsp a3, 248(sp)
+    bne a3, a5, fail
+    c.slli a3, 40
+    li t0, 0x6677880000000000
+    bne a3, t0, fail
+    mv a4, a3
+    c.srai a4, 36
+    li t0, 0x6677880
+    bne a4, t0, fail
+    li a4, -1
+    c.srli a4, 33
+    li t0, 0x7fffffff
+    bne a4, t0, fail
+    # test 6: double precision with 64 bit integers
+    li t0, 0x6000
+    csrs sstatus, t0
+    li gp, 6
+    li a0, -3
+    fcvt.d.l fa0, a0
+    fcvt.l.d a1, fa0
+    bne a1, a0, fail
+    li a0, 0x4000000000000000
+    fcvt.d.lu fa1, a0
+    fmv.x.d a2, fa1
+    li t0, 0x43d0000000000000
+    bne a2, t0, fail
+    fcvt.lu.d a3, fa1
+    bne a3, a0, fail
+    fmv.d.x fa2, t0
+    feq.d a4, fa2, fa1
+    beqz a4, fail
+    fsd fa2, 24(sp)
+    ld a5, 24(sp)
+    bne a5, t0, fail
+    # fcvt.w.d of a large value saturates and sign extends
+    fcvt.w.d a1, fa1, rtz
+    li t0, 0x7fffffff
+    bne a1, t0, fail
+    li a0, -1
+    fcvt.d.l fa0, a0
+    fcvt.wu.d a1, fa0, rtz
+    bnez a1, fail
+    fcvt.lu.d a1, fa0, rtz
+    bnez a1, fail
+    # fmv.x.w sign extends
+    li a0, 0x80000000
+    fmv.w.x fa3, a0
+    fmv.x.w a1, fa3
+    li t0, 0xffffffff80000000
+    bne a1, t0, fail
+    # test 7: fcvt.s.l
+    li gp, 7
+    li a0, 16777217
+    fcvt.s.l fa0, a0, rtz
+    fcvt.l.s a1, fa0
+    li t0, 16777216
+    bne a1, t0, fail
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+    j pass
+fail:
+    slli t0, gp, 1
+    ori t0, t0, 1
+    sw t0, 0(s1)
+    j fail
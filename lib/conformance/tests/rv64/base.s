@@ -0,0 +1,119 @@
+# RV64I base instructions
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    slli s1, s1, 32
+    srli s1, s1, 32          # tohost
+    lui sp, 0x80003
+    slli sp, sp, 32
+    srli sp, sp, 32
+    # test 2: 64 bit add/sub, shifts
+    li gp, 2
+    li a0, 0x123456789abcdef0
+    li a1, 0x0fedcba987654321
+    add a2, a0, a1
+    li t0, 0x2222222222222211
+    bne a2, t0, fail
+    sub a2, a0, a1
+    li t0, 0x02468acf13579bcf
+    bne a2, t0, fail
+    slli a2, a0, 40
+    li t0, 0xbcdef00000000000
+    bne a2, t0, fail
+    srai a2, a2, 44
+    li t0, 0xfffffffffffbcdef
+    bne a2, t0, fail
+    li t1, 63
+    srl a2, a0, t1
+    bnez a2, fail
+    li t1, 64+4              # shift amount is masked to 6 bits
+    sll a2, a0, t1
+    li t0, 0x23456789abcdef00
+    bne a2, t0, fail
+    # test 3: W instructions
+    li gp, 3
+    li a0, 0x7fffffff
+    addiw a2, a0, 1
+    li t0, 0xffffffff80000000
+    bne a2, t0, fail
+    addw a2, a0, a0
+    li t0, -2
+    bne a2, t0, fail
+    li a1, 0x100000000
+    subw a2, a1, a0          # 0 - 0x7fffffff
+    li t0, 0xffffffff80000001
+    bne a2, t0, fail
+    slliw a2, a0, 1
+    j fail2
+fail2:
+    li t0, -2
+    bne a2, t0, fail
+    li a3, 0xffffffff80000000
+    sraiw a2, a3, 4
+    li t0, 0xfffffffff8000000
+    bne a2, t0, fail
+    srliw a2, a3, 4
+    li t0, 0x08000000
+    bne a2, t0, fail
+    li t1, 33                # only 5 bits of the shift amount count
+    sraw a2, a3, t1
+    li t0, 0xffffffffc0000000
+    bne a2, t0, fail
+    srlw a2, a3, t1
+    li t0, 0x40000000
+    bne a2, t0, fail
+    sllw a2, a0, t1
+    li t0, -2
+    bne a2, t0, fail
+    # test 4: loads and stores
+    li gp, 4
+    li a0, 0x8899aabbccddeeff
+    sd a0, 0(sp)
+    ld a2, 0(sp)
+    bne a2, a0, fail
+    lw a2, 0(sp)
+    li t0, 0xffffffffccddeeff
+    bne a2, t0, fail
+    lwu a2, 0(sp)
+    li t0, 0xccddeeff
+    bne a2, t0, fail
+    lw a2, 4(sp)
+    li t0, 0xffffffff8899aabb
+    bne a2, t0, fail
+    lhu a2, 6(sp)
+    li t0, 0x8899
+    bne a2, t0, fail
+    sw zero, 4(sp)
+    ld a2, 0(sp)
+    li t0, 0xccddeeff
+    bne a2, t0, fail
+    # test 5: compares and branches with 64 bit values
+    li gp, 5
+    li a0, 0x8000000000000000
+    li a1, 1
+    slt a2, a0, a1
+    beqz a2, fail
+    sltu a2, a0, a1
+    bnez a2, fail
+    bge a0, a1, fail
+    bltu a0, a1, fail
+    sltiu a2, a1, -1
+    beqz a2, fail
+    # test 6: lui, auipc
+    li gp, 6
+    lui a2, 0x80000
+    li t0, 0xffffffff80000000
+    bne a2, t0, fail
+    auipc a2, 0
+    srli t0, a2, 32
+    bnez t0, fail
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+    j pass
+fail:
+    slli t0, gp, 1
+    ori t0, t0, 1
+    sw t0, 0(s1)
+    j fail
@@ -0,0 +1,625 @@
+# RV64 M and Zba, Zbb and Zbs instructions
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    slli s1, s1, 32
+    srli s1, s1, 32
+    li gp, 2
+    li a0, 0x8000000000000001
+    li a1, 0xfffffffffffffffd
+    mul a2, a0, a1
+    li t0, 0x7ffffffffffffffd
+    bne a2, t0, fail
+    li gp, 3
+    li a0, 0x8000000000000001
+    li a1, 0xfffffffffffffffd
+    mulh a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 4
+    li a0, 0x8000000000000001
+    li a1, 0xfffffffffffffffd
+    mulhu a2, a0, a1
+    li t0, 0x7fffffffffffffff
+    bne a2, t0, fail
+    li gp, 5
+    li a0, 0x8000000000000001
+    li a1, 0xfffffffffffffffd
+    mulhsu a2, a0, a1
+    li t0, 0x8000000000000002
+    bne a2, t0, fail
+    li gp, 6
+    li a0, 0x8000000000000001
+    li a1, 0xfffffffffffffffd
+    mulw a2, a0, a1
+    li t0, 0xfffffffffffffffd
+    bne a2, t0, fail
+    li gp, 7
+    li a0, 0x123456789abcdef
+    li a1, 0xfedcba987654321
+    mul a2, a0, a1
+    li t0, 0x22236d88fe5618cf
+    bne a2, t0, fail
+    li gp, 8
+    li a0, 0x123456789abcdef
+    li a1, 0xfedcba987654321
+    mulh a2, a0, a1
+    li t0, 0x121fa00ad77d74
+    bne a2, t0, fail
+    li gp, 9
+    li a0, 0x123456789abcdef
+    li a1, 0xfedcba987654321
+    mulhu a2, a0, a1
+    li t0, 0x121fa00ad77d74
+    bne a2, t0, fail
+    li gp, 10
+    li a0, 0x123456789abcdef
+    li a1, 0xfedcba987654321
+    mulhsu a2, a0, a1
+    li t0, 0x121fa00ad77d74
+    bne a2, t0, fail
+    li gp, 11
+    li a0, 0x123456789abcdef
+    li a1, 0xfedcba987654321
+    mulw a2, a0, a1
+    li t0, 0xfffffffffe5618cf
+    bne a2, t0, fail
+    li gp, 12
+    li a0, 0xffffffffffffffff
+    li a1, 0xffffffffffffffff
+    mul a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 13
+    li a0, 0xffffffffffffffff
+    li a1, 0xffffffffffffffff
+    mulh a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 14
+    li a0, 0xffffffffffffffff
+    li a1, 0xffffffffffffffff
+    mulhu a2, a0, a1
+    li t0, 0xfffffffffffffffe
+    bne a2, t0, fail
+    li gp, 15
+    li a0, 0xffffffffffffffff
+    li a1, 0xffffffffffffffff
+    mulhsu a2, a0, a1
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 16
+    li a0, 0xffffffffffffffff
+    li a1, 0xffffffffffffffff
+    mulw a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 17
+    li a0, 0x5
+    li a1, 0x7
+    mul a2, a0, a1
+    li t0, 0x23
+    bne a2, t0, fail
+    li gp, 18
+    li a0, 0x5
+    li a1, 0x7
+    mulh a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 19
+    li a0, 0x5
+    li a1, 0x7
+    mulhu a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 20
+    li a0, 0x5
+    li a1, 0x7
+    mulhsu a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 21
+    li a0, 0x5
+    li a1, 0x7
+    mulw a2, a0, a1
+    li t0, 0x23
+    bne a2, t0, fail
+    li gp, 22
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    div a2, a0, a1
+    li t0, 0x8000000000000000
+    bne a2, t0, fail
+    li gp, 23
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    rem a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 24
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    divu a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 25
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    remu a2, a0, a1
+    li t0, 0x8000000000000000
+    bne a2, t0, fail
+    li gp, 26
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    divw a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 27
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    remw a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 28
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    divuw a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 29
+    li a0, 0x8000000000000000
+    li a1, 0xffffffffffffffff
+    remuw a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 30
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    div a2, a0, a1
+    li t0, 0xfffffffffffffffd
+    bne a2, t0, fail
+    li gp, 31
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    rem a2, a0, a1
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 32
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    divu a2, a0, a1
+    li t0, 0x7ffffffffffffffc
+    bne a2, t0, fail
+    li gp, 33
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    remu a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 34
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    divw a2, a0, a1
+    li t0, 0xfffffffffffffffd
+    bne a2, t0, fail
+    li gp, 35
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    remw a2, a0, a1
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 36
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    divuw a2, a0, a1
+    li t0, 0x7ffffffc
+    bne a2, t0, fail
+    li gp, 37
+    li a0, 0xfffffffffffffff9
+    li a1, 0x2
+    remuw a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 38
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    div a2, a0, a1
+    li t0, 0xfffffffffffffffd
+    bne a2, t0, fail
+    li gp, 39
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    rem a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 40
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    divu a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 41
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    remu a2, a0, a1
+    li t0, 0x7
+    bne a2, t0, fail
+    li gp, 42
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    divw a2, a0, a1
+    li t0, 0xfffffffffffffffd
+    bne a2, t0, fail
+    li gp, 43
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    remw a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 44
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    divuw a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 45
+    li a0, 0x7
+    li a1, 0xfffffffffffffffe
+    remuw a2, a0, a1
+    li t0, 0x7
+    bne a2, t0, fail
+    li gp, 46
+    li a0, 0x64
+    li a1, 0x0
+    div a2, a0, a1
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 47
+    li a0, 0x64
+    li a1, 0x0
+    rem a2, a0, a1
+    li t0, 0x64
+    bne a2, t0, fail
+    li gp, 48
+    li a0, 0x64
+    li a1, 0x0
+    divu a2, a0, a1
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 49
+    li a0, 0x64
+    li a1, 0x0
+    remu a2, a0, a1
+    li t0, 0x64
+    bne a2, t0, fail
+    li gp, 50
+    li a0, 0x64
+    li a1, 0x0
+    divw a2, a0, a1
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 51
+    li a0, 0x64
+    li a1, 0x0
+    remw a2, a0, a1
+    li t0, 0x64
+    bne a2, t0, fail
+    li gp, 52
+    li a0, 0x64
+    li a1, 0x0
+    divuw a2, a0, a1
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 53
+    li a0, 0x64
+    li a1, 0x0
+    remuw a2, a0, a1
+    li t0, 0x64
+    bne a2, t0, fail
+    li gp, 54
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    div a2, a0, a1
+    li t0, 0x80000000
+    bne a2, t0, fail
+    li gp, 55
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    rem a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 56
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    divu a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 57
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    remu a2, a0, a1
+    li t0, 0xffffffff80000000
+    bne a2, t0, fail
+    li gp, 58
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    divw a2, a0, a1
+    li t0, 0xffffffff80000000
+    bne a2, t0, fail
+    li gp, 59
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    remw a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 60
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    divuw a2, a0, a1
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 61
+    li a0, 0xffffffff80000000
+    li a1, 0xffffffffffffffff
+    remuw a2, a0, a1
+    li t0, 0xffffffff80000000
+    bne a2, t0, fail
+    li gp, 62
+    li a0, 0x1234567890
+    li a1, 0x11
+    div a2, a0, a1
+    li t0, 0x112233444
+    bne a2, t0, fail
+    li gp, 63
+    li a0, 0x1234567890
+    li a1, 0x11
+    rem a2, a0, a1
+    li t0, 0xc
+    bne a2, t0, fail
+    li gp, 64
+    li a0, 0x1234567890
+    li a1, 0x11
+    divu a2, a0, a1
+    li t0, 0x112233444
+    bne a2, t0, fail
+    li gp, 65
+    li a0, 0x1234567890
+    li a1, 0x11
+    remu a2, a0, a1
+    li t0, 0xc
+    bne a2, t0, fail
+    li gp, 66
+    li a0, 0x1234567890
+    li a1, 0x11
+    divw a2, a0, a1
+    li t0, 0x3142535
+    bne a2, t0, fail
+    li gp, 67
+    li a0, 0x1234567890
+    li a1, 0x11
+    remw a2, a0, a1
+    li t0, 0xb
+    bne a2, t0, fail
+    li gp, 68
+    li a0, 0x1234567890
+    li a1, 0x11
+    divuw a2, a0, a1
+    li t0, 0x3142535
+    bne a2, t0, fail
+    li gp, 69
+    li a0, 0x1234567890
+    li a1, 0x11
+    remuw a2, a0, a1
+    li t0, 0xb
+    bne a2, t0, fail
+    li gp, 70
+    li a0, 0xfffff0000001
+    li a1, 0x123456789abcdef0
+    add.uw a2, a0, a1
+    li t0, 0x123456798abcdef1
+    bne a2, t0, fail
+    li gp, 71
+    li a0, 0xfffff0000001
+    li a1, 0x123456789abcdef0
+    sh1add.uw a2, a0, a1
+    li t0, 0x1234567a7abcdef2
+    bne a2, t0, fail
+    li gp, 72
+    li a0, 0xf0000001
+    li a1, 0x123456789abcdef0
+    sh3add.uw a2, a0, a1
+    li t0, 0x123456801abcdef8
+    bne a2, t0, fail
+    li gp, 73
+    li a0, 0xf0000001
+    li a1, 0x123456789abcdef0
+    sh2add a2, a0, a1
+    li t0, 0x1234567c5abcdef4
+    bne a2, t0, fail
+    li gp, 74
+    li a0, 0xfffffffff0000001
+    slli.uw a2, a0, 4
+    li t0, 0xf00000010
+    bne a2, t0, fail
+    li gp, 75
+    li a0, 0x123456789abcdef0
+    clz a2, a0
+    li t0, 0x3
+    bne a2, t0, fail
+    li gp, 76
+    li a0, 0x123456789abcdef0
+    clzw a2, a0
+    li t0, 0x0
+    bne a2, t0, fail
+    li gp, 77
+    li a0, 0xffffffff00000000
+    clzw a2, a0
+    li t0, 0x20
+    bne a2, t0, fail
+    li gp, 78
+    li a0, 0x100000000000
+    ctz a2, a0
+    li t0, 0x2c
+    bne a2, t0, fail
+    li gp, 79
+    li a0, 0x100000000000
+    ctzw a2, a0
+    li t0, 0x20
+    bne a2, t0, fail
+    li gp, 80
+    li a0, 0x0
+    ctz a2, a0
+    li t0, 0x40
+    bne a2, t0, fail
+    li gp, 81
+    li a0, 0x123456789abcdef0
+    cpop a2, a0
+    li t0, 0x20
+    bne a2, t0, fail
+    li gp, 82
+    li a0, 0x123456789abcdef0
+    cpopw a2, a0
+    li t0, 0x13
+    bne a2, t0, fail
+    li gp, 83
+    li a0, 0x80000000
+    sext.w a2, a0
+    li t0, 0xffffffff80000000
+    bne a2, t0, fail
+    li gp, 84
+    li a0, 0x123456789abcdef0
+    zext.h a2, a0
+    li t0, 0xdef0
+    bne a2, t0, fail
+    li gp, 85
+    li a0, 0x80
+    sext.b a2, a0
+    li t0, 0xffffffffffffff80
+    bne a2, t0, fail
+    li gp, 86
+    li a0, 0x123456789abcdef0
+    rev8 a2, a0
+    li t0, 0xf0debc9a78563412
+    bne a2, t0, fail
+    li gp, 87
+    li a0, 0x1000000100000
+    orc.b a2, a0
+    li t0, 0xff000000ff0000
+    bne a2, t0, fail
+    li gp, 88
+    li a0, 0x123456789abcdef0
+    li a1, 0x44
+    rol a2, a0, a1
+    li t0, 0x23456789abcdef01
+    bne a2, t0, fail
+    li gp, 89
+    li a0, 0x123456789abcdef0
+    li a1, 0x4
+    ror a2, a0, a1
+    li t0, 0x123456789abcdef
+    bne a2, t0, fail
+    li gp, 90
+    li a0, 0x123456789abcdef0
+    li a1, 0x24
+    rolw a2, a0, a1
+    li t0, 0xffffffffabcdef09
+    bne a2, t0, fail
+    li gp, 91
+    li a0, 0x123456789abcdef0
+    li a1, 0x4
+    rorw a2, a0, a1
+    li t0, 0x9abcdef
+    bne a2, t0, fail
+    li gp, 92
+    li a0, 0x123456789abcdef0
+    rori a2, a0, 63
+    li t0, 0x2468acf13579bde0
+    bne a2, t0, fail
+    li gp, 93
+    li a0, 0x123456789abcdef0
+    roriw a2, a0, 31
+    li t0, 0x3579bde1
+    bne a2, t0, fail
+    li gp, 94
+    li a0, 0x123456789abcdef0
+    li a1, 0xff
+    andn a2, a0, a1
+    li t0, 0x123456789abcde00
+    bne a2, t0, fail
+    li gp, 95
+    li a0, 0x8000000000000001
+    li a1, 0x5
+    max a2, a0, a1
+    li t0, 0x5
+    bne a2, t0, fail
+    li gp, 96
+    li a0, 0x8000000000000001
+    li a1, 0x5
+    minu a2, a0, a1
+    li t0, 0x5
+    bne a2, t0, fail
+    li gp, 97
+    li a0, 0x3
+    li a1, 0x5
+    max a2, a0, a1
+    li t0, 0x5
+    bne a2, t0, fail
+    li gp, 98
+    li a0, 0x0
+    li a1, 0x3f
+    bset a2, a0, a1
+    li t0, 0x8000000000000000
+    bne a2, t0, fail
+    li gp, 99
+    li a0, 0xffffffffffffffff
+    li a1, 0x28
+    bclr a2, a0, a1
+    li t0, 0xfffffeffffffffff
+    bne a2, t0, fail
+    li gp, 100
+    li a0, 0x0
+    li a1, 0x20
+    binv a2, a0, a1
+    li t0, 0x100000000
+    bne a2, t0, fail
+    li gp, 101
+    li a0, 0x200000000000
+    li a1, 0x2d
+    bext a2, a0, a1
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 102
+    li a0, 0x0
+    bseti a2, a0, 63
+    li t0, 0x8000000000000000
+    bne a2, t0, fail
+    li gp, 103
+    li a0, 0x200000000000
+    bexti a2, a0, 45
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 104
+    li a0, 0x8000000000000000
+    srai a2, a0, 63
+    li t0, 0xffffffffffffffff
+    bne a2, t0, fail
+    li gp, 105
+    li a0, 0x8000000000000000
+    srli a2, a0, 63
+    li t0, 0x1
+    bne a2, t0, fail
+    li gp, 106
+    li a0, 0x1
+    slli a2, a0, 63
+    li t0, 0x8000000000000000
+    bne a2, t0, fail
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+    j pass
+fail:
+    slli t0, gp, 1
+    ori t0, t0, 1
+    sw t0, 0(s1)
+    j fail
@@ -0,0 +1,129 @@
+# Sv39 and Sv48 translation
+.option norelax
+.text
+_start:
+    lui s1, 0x80001
+    slli s1, s1, 32
+    srli s1, s1, 32
+    la t0, trap
+    csrw stvec, t0
+    li s3, 0
+    # Sv39 root at 0x80010000, L1 at 0x80011000, L0 at 0x80012000, Sv48 root at 0x80013000
+    li s4, 0x80010000
+    li t0, 0x200000CF            # root[2]: identity gigapage at 0x80000000
+    sd t0, 16(s4)
+    li t1, 0xff8
+    add t1, t1, s4
+    sd t0, 0(t1)                 # root[511]: 0xffffffffc0000000 -> 0x80000000
+    li t0, 0x8000000000000000 | 0x200000CF
+    sd t0, 24(s4)                # root[3]: reserved bit set
+    li t0, 0x20004401            # root[0] -> L1
+    sd t0, 0(s4)
+    li t1, 0x80011000 + 0x91 * 8
+    li t0, 0x20004801            # L1[0x91] -> L0
+    sd t0, 0(t1)
+    li t1, 0x80012000 + 0x145 * 8
+    li t0, 0x200080CF            # L0[0x145] -> 0x80020000
+    sd t0, 0(t1)
+    li t1, 0x80013000
+    li t0, 0x20004001            # Sv48 root[0] and root[511] -> Sv39 root
+    sd t0, 0(t1)
+    li t2, 0xff8
+    add t1, t1, t2
+    sd t0, 0(t1)
+    li t1, 0x80020000
+    li t0, 0x5566778899aabbcc
+    sd t0, 0(t1)
+    # test 2: Sv39
+    li gp, 2
+    li t0, (8 << 60) | 0x80010
+    csrw satp, t0
+    sfence.vma
+    csrr t1, satp
+    bne t0, t1, fail
+    li a0, 0x12345000
+    ld a1, 0(a0)
+    li t0, 0x5566778899aabbcc
+    bne a1, t0, fail
+    li a0, 0xffffffffc0020000
+    ld a1, 0(a0)
+    bne a1, t0, fail
+    # test 3: non canonical address and reserved PTE bits fault
+    li gp, 3
+    li a0, 0x0000008000000000
+.option push
+.option norvc
+    ld a1, 0(a0)
+.option pop
+    li t0, 1
+    bne s3, t0, fail
+    li t0, 13
+    bne s4, t0, fail
+    li a0, 0xc0000000
+.option push
+.option norvc
+    ld a1, 0(a0)
+.option pop
+    li t0, 2
+    bne s3, t0, fail
+    # misaligned gigapage faults without setting the A bit
+    li t1, 0x80010000 + 4 * 8
+    li t0, 0x8000400F            # root[4]: gigapage at 0x80001000, A clear
+    sd t0, 0(t1)
+    li a0, 0x100000000
+.option push
+.option norvc
+    ld a1, 0(a0)
+.option pop
+    li t0, 3
+    bne s3, t0, fail
+    li t0, 13
+    bne s4, t0, fail
+    li t1, 0x80010000 + 4 * 8
+    ld a1, 0(t1)
+    li t0, 0x8000400F
+    bne a1, t0, fail
+    # test 4: Sv48
+    li gp, 4
+    li t0, (9 << 60) | 0x80013
+    csrw satp, t0
+    sfence.vma
+    li a0, 0x12345000
+    ld a1, 0(a0)
+    li t0, 0x5566778899aabbcc
+    bne a1, t0, fail
+    li a0, 0xffffffffc0020000
+    ld a1, 0(a0)
+    bne a1, t0, fail
+    li a0, 0x0000800000000000
+.option push
+.option norvc
+    ld a1, 0(a0)
+.option pop
+    li t0, 4
+    bne s3, t0, fail
+    # test 5: unsupported modes are ignored
+    li gp, 5
+    li t0, (10 << 60) | 0x80010
+    csrw satp, t0
+    csrr t1, satp
+    li t0, (9 << 60) | 0x80013
+    bne t0, t1, fail
+    csrw satp, zero
+pass:
+    li t0, 1
+    sw t0, 0(s1)
+    j pass
+fail:
+    slli t0, gp, 1
+    ori t0, t0, 1
+    sw t0, 0(s1)
+    j fail
+.balign 4
+trap:
+    addi s3, s3, 1
+    csrr s4, scause
+    csrr t4, sepc
+    addi t4, t4, 4
+    csrw sepc, t4
+    sret
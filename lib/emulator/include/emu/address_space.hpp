@@ -4,11 +4,16 @@
 #include <cstdint>
 #include <expected>
 #include <memory>
+#include <optional>
 #include <span>
 #include <set>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <emu/core.hpp>
+#include <emu/hot_path.hpp>
+#include <emu/state.hpp>
 
 namespace ds::emu {
 
@@ -29,16 +34,30 @@ namespace ds::emu {
         using Offset = T;
 
         constexpr explicit MemoryMappedPeripheral(std::size_t size) : m_size(size) {}
+        constexpr MemoryMappedPeripheral(std::size_t size, bool memory) : m_size(size), m_memory(memory) {}
         virtual ~MemoryMappedPeripheral() = default;
 
         virtual auto read(Offset offset, std::span<std::uint8_t> buffer) -> AccessResult = 0;
         virtual auto write(Offset offset, std::span<const std::uint8_t> buffer) -> AccessResult = 0;
         virtual auto reset() -> void = 0;
 
+        // Called when the machine reboots without losing power. Peripherals that keep
+        // their state across such a reset (e.g. RAM) can override this
+        virtual auto warm_reset() -> void { this->reset(); }
+
+        // Saves and restores the internal state of the peripheral for checkpoints.
+        // Peripherals without any state don't need to override these
+        virtual auto save_state(StateWriter &writer) const -> void { std::ignore = writer; }
+        virtual auto load_state(StateReader &reader) -> void { std::ignore = reader; }
+
         [[nodiscard]] constexpr auto size() const noexcept -> std::size_t { return m_size; }
 
+        // Plain memory as opposed to a device register block, only accesses to the latter count as MMIO
+        [[nodiscard]] constexpr auto is_memory() const noexcept -> bool { return m_memory; }
+
     private:
         std::size_t m_size;
+        bool m_memory = false;
     };
 
     template<typename T>
@@ -51,9 +70,19 @@ namespace ds::emu {
     public:
         virtual ~AddressTranslator() = default;
         constexpr virtual auto translate(Core &core, T virtual_address, AccessType access_type) -> std::expected<T, AccessResult> = 0;
+        // Same result as translate(), but without modifying any state the guest could observe
+        constexpr virtual auto translate_without_side_effects(Core &core, T virtual_address, AccessType access_type) -> std::expected<T, AccessResult> = 0;
         constexpr virtual auto invalidate() -> void = 0;
     };
 
+    // Gets notified about every successful access to a traced region, see AddressSpace::set_traced
+    template<typename T>
+    class AccessTracer {
+    public:
+        virtual ~AccessTracer() = default;
+        virtual auto trace(T address, std::span<const std::uint8_t> data, AccessType access_type) -> void = 0;
+    };
+
     template<typename T>
     class AddressSpace {
     public:
@@ -65,8 +94,26 @@ namespace ds::emu {
             return read_physical(*physical_address, buffer);
         }
 
-        constexpr auto read_physical(T address, std::span<std::uint8_t> buffer) -> AccessResult {
-            if (auto entry = get(address); entry != nullptr)
+        DS_EMU_HOT_PATH constexpr auto read_physical(T address, std::span<std::uint8_t> buffer) -> AccessResult {
+            if (auto entry = get(address); entry != nullptr) {
+                const auto result = entry->peripheral->read(address - entry->base_address, buffer);
+                if (entry->traced || !entry->peripheral->is_memory()) [[unlikely]] {
+                    entry->reads += 1;
+                    if (!entry->peripheral->is_memory())
+                        m_device_accesses += 1;
+                    if (entry->traced)
+                        trace(address, buffer, AccessType::Load, result);
+                }
+
+                return result;
+            }
+
+            return AccessResult::LoadAccessFault;
+        }
+
+        // Reads plain memory without counting or tracing the access. Other peripherals may have side effects on reads and are refused
+        constexpr auto peek_physical(T address, std::span<std::uint8_t> buffer) -> AccessResult {
+            if (auto entry = get(address); entry != nullptr && entry->peripheral->is_memory())
                 return entry->peripheral->read(address - entry->base_address, buffer);
 
             return AccessResult::LoadAccessFault;
@@ -80,9 +127,24 @@ namespace ds::emu {
             return write_physical(*physical_address, buffer);
         }
 
-        constexpr auto write_physical(T address, std::span<const std::uint8_t> buffer) -> AccessResult {
-            if (auto entry = get(address); entry != nullptr)
-                return entry->peripheral->write(address - entry->base_address, buffer);
+        DS_EMU_HOT_PATH constexpr auto write_physical(T address, std::span<const std::uint8_t> buffer) -> AccessResult {
+            if (m_write_watch.has_value()) [[unlikely]] {
+                if (address < m_write_watch->end && address + buffer.size() > m_write_watch->start)
+                    m_write_watch_triggered = true;
+            }
+
+            if (auto entry = get(address); entry != nullptr) {
+                const auto result = entry->peripheral->write(address - entry->base_address, buffer);
+                if (entry->traced || !entry->peripheral->is_memory()) [[unlikely]] {
+                    entry->writes += 1;
+                    if (!entry->peripheral->is_memory())
+                        m_device_accesses += 1;
+                    if (entry->traced)
+                        trace(address, buffer, AccessType::Store, result);
+                }
+
+                return result;
+            }
 
             return AccessResult::StoreAccessFault;
         }
@@ -91,6 +153,12 @@ namespace ds::emu {
             T base_address;
             MemoryMappedPeripheral<T> *peripheral;
 
+            // Not part of the ordering, so these can be changed in place.
+            // Accesses to plain memory are only counted while it's traced, to keep them cheap
+            mutable bool traced = false;
+            mutable std::uint64_t reads = 0;
+            mutable std::uint64_t writes = 0;
+
             auto operator<=>(const PeripheralEntry &other) const noexcept -> auto {
                 return this->base_address <=> other.base_address;
             }
@@ -115,6 +183,34 @@ namespace ds::emu {
             m_peripherals.insert(PeripheralEntry{ base_address, peripheral });
         }
 
+        // Number of accesses made to peripherals that aren't plain memory
+        [[nodiscard]] constexpr auto device_accesses() const -> std::uint64_t {
+            return m_device_accesses;
+        }
+
+        constexpr auto set_access_tracer(AccessTracer<T> *tracer) -> void {
+            m_access_tracer = tracer;
+        }
+
+        // Temporarily stops passing accesses on to the access tracer without detaching it
+        constexpr auto set_tracing_suspended(bool suspended) -> void {
+            m_tracing_suspended = suspended;
+        }
+
+        // Enables or disables tracing of all accesses to the peripheral mapped at the given address
+        constexpr auto set_traced(T address, bool traced) -> bool {
+            const auto entry = get(address);
+            if (entry == nullptr)
+                return false;
+
+            entry->traced = traced;
+            return true;
+        }
+
+        constexpr auto peripherals() const -> const std::set<PeripheralEntry>& {
+            return m_peripherals;
+        }
+
         constexpr auto add_address_translator(AddressTranslator<T> *translator) -> void {
             m_address_translators.emplace_back(translator);
         }
@@ -132,7 +228,42 @@ namespace ds::emu {
             }
         }
 
-        constexpr auto translate_address(Core &core, T virtual_address, AccessType access) -> std::expected<T, AccessResult> {
+        constexpr auto warm_reset() -> void {
+            this->invalidate();
+            for (const auto &entry : m_peripherals) {
+                entry.peripheral->warm_reset();
+            }
+        }
+
+        auto save_state(StateWriter &writer) const -> void {
+            for (const auto &entry : m_peripherals) {
+                entry.peripheral->save_state(writer);
+            }
+        }
+
+        auto load_state(StateReader &reader) -> void {
+            this->invalidate();
+            for (const auto &entry : m_peripherals) {
+                entry.peripheral->load_state(reader);
+            }
+        }
+
+        struct WatchRange {
+            T start, end;
+        };
+
+        // Monitors a range of physical addresses for writes, no matter which core or device they come from
+        constexpr auto set_write_watch(std::optional<WatchRange> range) -> void {
+            m_write_watch = range;
+            m_write_watch_triggered = false;
+        }
+
+        // Returns whether the watched range was written to since the last call
+        constexpr auto write_watch_triggered() -> bool {
+            return std::exchange(m_write_watch_triggered, false);
+        }
+
+        DS_EMU_HOT_PATH constexpr auto translate_address(Core &core, T virtual_address, AccessType access) -> std::expected<T, AccessResult> {
             T physical_address = virtual_address;
             for (const auto &translator : m_address_translators) {
                 const auto result = translator->translate(core, physical_address, access);
@@ -145,9 +276,36 @@ namespace ds::emu {
             return physical_address;
         }
 
+        // Translates an address for tools looking at the guest, like the profiler, without disturbing it
+        constexpr auto translate_address_without_side_effects(Core &core, T virtual_address, AccessType access) -> std::expected<T, AccessResult> {
+            T physical_address = virtual_address;
+            for (const auto &translator : m_address_translators) {
+                const auto result = translator->translate_without_side_effects(core, physical_address, access);
+                if (!result.has_value())
+                    return result;
+
+                physical_address = result.value();
+            }
+
+            return physical_address;
+        }
+
+    private:
+        constexpr auto trace(T address, std::span<const std::uint8_t> data, AccessType access_type, AccessResult result) -> void {
+            if (m_access_tracer != nullptr && !m_tracing_suspended && result == AccessResult::Success)
+                m_access_tracer->trace(address, data, access_type);
+        }
+
     private:
         std::set<PeripheralEntry> m_peripherals;
+        AccessTracer<T> *m_access_tracer = nullptr;
+        bool m_tracing_suspended = false;
         std::vector<AddressTranslator<T>*> m_address_translators;
+
+        std::optional<WatchRange> m_write_watch;
+        bool m_write_watch_triggered = false;
+
+        std::uint64_t m_device_accesses = 0;
     };
 
 }
\ No newline at end of file
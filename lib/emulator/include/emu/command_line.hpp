@@ -0,0 +1,39 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstdio>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+namespace ds::emu {
+
+    // Parses the whole value of a command line argument as a number. Integers may be given in hexadecimal with a 0x prefix.
+    // Reports values that aren't a number or don't fit into T
+    template<typename T>
+    auto parse_number(std::string_view argument, std::string_view value) -> std::optional<T> {
+        std::string_view digits = value;
+        T result = {};
+        std::from_chars_result status;
+        if constexpr (std::integral<T>) {
+            int base = 10;
+            if (digits.starts_with("0x") || digits.starts_with("0X")) {
+                digits.remove_prefix(2);
+                base = 16;
+            }
+
+            status = std::from_chars(digits.data(), digits.data() + digits.size(), result, base);
+        } else {
+            status = std::from_chars(digits.data(), digits.data() + digits.size(), result);
+        }
+
+        if (status.ec != std::errc() || status.ptr != digits.data() + digits.size()) {
+            std::fprintf(stderr, "Invalid value '%.*s' for argument '%.*s'\n", int(value.size()), value.data(), int(argument.size()), argument.data());
+            return std::nullopt;
+        }
+
+        return result;
+    }
+
+}
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <array>
+#include <cstring>
+#include <deque>
+#include <functional>
+
 #include <emu/address_space.hpp>
+#include <emu/register.hpp>
+#include <emu/utils.hpp>
 
 namespace ds::emu::dev {
 
-    class UART8250 : public MemoryMappedPeripheral<std::uint32_t> {
+    template<typename T>
+    class BasicUART8250 : public MemoryMappedPeripheral<T> {
     public:
-        explicit UART8250() : MemoryMappedPeripheral(0x100000) { }
+        using typename MemoryMappedPeripheral<T>::Offset;
+
+        explicit BasicUART8250() : MemoryMappedPeripheral<T>(0x100000) { }
 
         auto read(Offset offset, std::span<std::uint8_t> buffer) -> AccessResult final {
             const auto reg = get_register(offset);
@@ -31,12 +41,45 @@ namespace ds::emu::dev {
 
         auto reset() -> void final {
             m_registers.LSR = util::bit<5>() | util::bit<6>(); // THRE and TSRE bit
+            m_registers.receive_fifo.clear();
+        }
+
+        auto save_state(StateWriter &writer) const -> void final {
+            for (const auto reg : StateRegisters) {
+                writer.write((m_registers.*reg).get());
+            }
+
+            writer.write(m_registers.receive_fifo.size());
+            for (const auto value : m_registers.receive_fifo) {
+                writer.write(value);
+            }
+        }
+
+        auto load_state(StateReader &reader) -> void final {
+            for (const auto reg : StateRegisters) {
+                m_registers.*reg = reader.read<std::uint8_t>();
+            }
+
+            m_registers.receive_fifo.resize(reader.read<std::size_t>());
+            for (auto &value : m_registers.receive_fifo) {
+                value = reader.read<std::uint8_t>();
+            }
         }
 
         void output_callback(std::function<void(std::uint8_t)> callback) {
             m_registers.ReceiveTransmitBuffer.write_callback = std::move(callback);
         }
 
+        // Queues a byte that the guest can then read from the receive buffer register.
+        // Like on real hardware, bytes arriving while the FIFO is full are lost
+        void receive(std::uint8_t value) {
+            if (m_registers.receive_fifo.size() >= ReceiveFifoDepth)
+                return;
+
+            m_registers.receive_fifo.push_back(value);
+            m_registers.LSR |= util::bit<0>(); // DR bit
+        }
+
     private:
         constexpr auto get_register(Offset offset) -> RegisterBase<std::uint8_t>* {
             switch (offset) {
@@ -67,7 +110,7 @@ namespace ds::emu::dev {
 
         struct Registers;
         struct InputOutputRegister : public RegisterBase<std::uint8_t> {
-            InputOutputRegister(Registers *registers){}
+            InputOutputRegister(Registers *registers) : registers(registers) {}
             constexpr auto operator=(Type value) -> InputOutputRegister& final {
                 if (value != '\r') [[likely]]
                     write_callback(value);
@@ -75,11 +118,12 @@ namespace ds::emu::dev {
                 return *this;
             }
 
-            constexpr operator Type() const final {
-                return 0x00;
+            operator Type() const final {
+                return registers->pop_received();
             }
 
             std::function<void(Type)> write_callback;
+            Registers *registers;
         };
 
         struct Registers {
@@ -93,10 +137,35 @@ namespace ds::emu::dev {
             GeneralPurposeRegister<std::uint8_t> DLLS;
             GeneralPurposeRegister<std::uint8_t> DLMS;
 
+            std::deque<std::uint8_t> receive_fifo;
+
             [[nodiscard]] constexpr auto DLAB() const -> bool { return LCR & util::bit<7>(); }
+
+            auto pop_received() -> std::uint8_t {
+                if (receive_fifo.empty())
+                    return 0x00;
+
+                const auto value = receive_fifo.front();
+                receive_fifo.pop_front();
+                if (receive_fifo.empty())
+                    LSR.set_bit(0, false); // DR bit
+
+                return value;
+            }
+        };
+
+        // Size of the 16550 receive FIFO
+        constexpr static std::size_t ReceiveFifoDepth = 16;
+
+        // All registers holding state. The receive/transmit buffer is backed by the FIFO instead
+        constexpr static std::array StateRegisters = {
+            &Registers::IER, &Registers::IIR, &Registers::LCR, &Registers::MCR,
+            &Registers::LSR, &Registers::MSR, &Registers::DLLS, &Registers::DLMS
         };
 
         Registers m_registers;
     };
 
+    using UART8250 = BasicUART8250<std::uint32_t>;
+
 }
\ No newline at end of file
@@ -1,12 +1,41 @@
 #pragma once
 
+#include <atomic>
+#include <bit>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #include <emu/address_space.hpp>
+#include <emu/literals.hpp>
 
 namespace ds::emu::dev {
 
-    class Ram : public MemoryMappedPeripheral<std::uint32_t> {
+    using namespace literals;
+
+    template<typename T>
+    class BasicRam : public MemoryMappedPeripheral<T> {
     public:
-        explicit Ram(std::size_t size) : MemoryMappedPeripheral(size) {
+        using typename MemoryMappedPeripheral<T>::Offset;
+
+        constexpr static auto PageSize = 4_KiB;
+        constexpr static auto PagesPerWord = 64;
+
+        // Original contents of all pages modified since the log was started
+        struct UndoLog {
+            std::vector<std::size_t> pages;
+            std::vector<std::uint8_t> data;
+
+            auto clear() -> void {
+                pages.clear();
+                data.clear();
+            }
+        };
+
+        explicit BasicRam(std::size_t size)
+            : MemoryMappedPeripheral<T>(size, true),
+              m_dirty_pages(((size + PageSize - 1) / PageSize + PagesPerWord - 1) / PagesPerWord),
+              m_undo_saved_pages(m_dirty_pages.size()) {
             m_data.resize(size);
         }
 
@@ -16,16 +45,122 @@ namespace ds::emu::dev {
         }
 
         auto write(Offset offset, std::span<const std::uint8_t> buffer) -> AccessResult final {
+            if (m_undo_log != nullptr)
+                save_undo_pages(offset, buffer.size_bytes());
+
             std::memcpy(m_data.data() + offset, buffer.data(), buffer.size_bytes());
+            mark_dirty(offset, buffer.size_bytes());
+
             return AccessResult::Success;
         }
 
         auto reset() -> void final {
+            // A power cycle discards all history
+            m_undo_log = nullptr;
+
             std::memset(m_data.data(), 0x00, m_data.size());
+            mark_dirty(0, m_data.size());
+        }
+
+        auto warm_reset() -> void final {
+            // Memory contents survive a warm reset, boot images get restored by the emulator
+        }
+
+        [[nodiscard]] auto data() const -> std::span<const std::uint8_t> {
+            return m_data;
+        }
+
+        [[nodiscard]] auto page_count() const -> std::size_t {
+            return (m_data.size() + PageSize - 1) / PageSize;
+        }
+
+        // Number of 64 bit words required to hold the dirty page bitmap
+        [[nodiscard]] auto dirty_page_bitmap_size() const -> std::size_t {
+            return m_dirty_pages.size();
+        }
+
+        // Copies the dirty page bitmap into the given buffer, clearing the copied words if requested.
+        // Each word is swapped out atomically so no write that happens concurrently gets lost.
+        // Bit N of word M corresponds to page M * 64 + N. Returns the number of dirty pages
+        auto get_dirty_pages(std::span<std::uint64_t> bitmap, bool clear) -> std::size_t {
+            const auto count = std::min(bitmap.size(), m_dirty_pages.size());
+
+            std::size_t dirty_page_count = 0;
+            for (std::size_t i = 0; i < count; i += 1) {
+                bitmap[i] = clear ? m_dirty_pages[i].exchange(0, std::memory_order_acq_rel) : m_dirty_pages[i].load(std::memory_order_acquire);
+                dirty_page_count += std::popcount(bitmap[i]);
+            }
+
+            return dirty_page_count;
+        }
+
+        // RAM contents aren't part of the saved peripheral state, copying them for every checkpoint would be far too slow.
+        // Instead, the original contents of every page get saved into the given log right before the page is modified
+        // for the first time. Only one log is active at once, passing nullptr stops logging
+        auto set_undo_log(UndoLog *log) -> void {
+            m_undo_log = log;
+            std::ranges::fill(m_undo_saved_pages, 0);
+        }
+
+        // Restores all pages saved in the log to their original contents
+        auto apply_undo_log(const UndoLog &log) -> void {
+            for (std::size_t i = 0; i < log.pages.size(); i += 1) {
+                const auto offset = log.pages[i] * PageSize;
+                const auto size = std::min<std::size_t>(PageSize, m_data.size() - offset);
+
+                std::memcpy(m_data.data() + offset, log.data.data() + i * PageSize, size);
+                mark_dirty(offset, size);
+            }
+        }
+
+    private:
+        auto save_undo_pages(std::size_t offset, std::size_t size) -> void {
+            if (size == 0) [[unlikely]]
+                return;
+
+            const auto first_page = offset / PageSize;
+            const auto last_page  = (offset + size - 1) / PageSize;
+            for (auto page = first_page; page <= last_page; page += 1) {
+                auto &word = m_undo_saved_pages[page / PagesPerWord];
+                const auto bit = std::uint64_t(1) << (page % PagesPerWord);
+                if (word & bit) [[likely]]
+                    continue;
+
+                word |= bit;
+
+                const auto page_offset = page * PageSize;
+                const auto page_size = std::min<std::size_t>(PageSize, m_data.size() - page_offset);
+                m_undo_log->pages.push_back(page);
+                m_undo_log->data.insert(m_undo_log->data.end(), m_data.begin() + page_offset, m_data.begin() + page_offset + page_size);
+                m_undo_log->data.resize(m_undo_log->pages.size() * PageSize);
+            }
+        }
+
+        auto mark_dirty(std::size_t offset, std::size_t size) -> void {
+            if (size == 0) [[unlikely]]
+                return;
+
+            const auto first_page = offset / PageSize;
+            const auto last_page  = (offset + size - 1) / PageSize;
+            for (auto page = first_page; page <= last_page; page += 1) {
+                auto &word = m_dirty_pages[page / PagesPerWord];
+                const auto bit = std::uint64_t(1) << (page % PagesPerWord);
+
+                // Avoid the locked read-modify-write if the page has already been marked
+                if (!(word.load(std::memory_order_relaxed) & bit)) [[unlikely]]
+                    word.fetch_or(bit, std::memory_order_release);
+            }
         }
 
     private:
         std::vector<std::uint8_t> m_data;
+        std::vector<std::atomic<std::uint64_t>> m_dirty_pages;
+
+        UndoLog *m_undo_log = nullptr;
+        std::vector<std::uint64_t> m_undo_saved_pages;
     };
 
-}
\ No newline at end of file
+    using Ram = BasicRam<std::uint32_t>;
+    using Ram64 = BasicRam<std::uint64_t>;
+
+}
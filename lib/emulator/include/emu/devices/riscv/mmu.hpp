@@ -1,67 +1,133 @@
 #pragma once
 
 #include <emu/address_space.hpp>
+#include <emu/hot_path.hpp>
 #include <emu/riscv/core.hpp>
+#include <array>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 namespace ds::emu::dev::riscv {
 
     using namespace literals;
 
+    // Sv32 on RV32, Sv39 and Sv48 on RV64
     template<typename T>
     class MMU : public AddressTranslator<T> {
     public:
+        using Core = emu::riscv::BasicCore<T>;
+
         constexpr static auto PageSize = 4_KiB;
-        constexpr static uint32_t PteSize = 4;
+        constexpr static uint32_t PteSize = sizeof(T);
+        constexpr static uint32_t VpnBits = sizeof(T) == 4 ? 10 : 9;
 
-        constexpr auto translate(Core &core, T virtual_address, AccessType access) -> std::expected<T, AccessResult> final {
-            auto &r = static_cast<emu::riscv::Core &>(core);
+        constexpr static auto V = 1u << 0;
+        constexpr static auto R = 1u << 1;
+        constexpr static auto W = 1u << 2;
+        constexpr static auto X = 1u << 3;
+        constexpr static auto U = 1u << 4;
+        constexpr static auto G = 1u << 5;
+        constexpr static auto A = 1u << 6;
+        constexpr static auto D = 1u << 7;
 
-            // Check if MMU is enabled
-            const auto mode = r.satp().get_bit(31);
-            if (mode == 0)
-                return virtual_address;
+        // Translation of a single page along with the flags of its leaf PTE, so the permissions can be checked
+        // on every hit instead of flushing the TLB whenever the privilege level changes
+        struct TlbEntry {
+            T physical_page_address;
+            std::uint8_t flags;
+        };
 
-            // Sv32: root PPN is satp.PPN[21:0]
-            const auto root_ppn = util::extract_bits<0,21>(static_cast<uint32_t>(r.satp()));
-            const T root_page_table = root_ppn * PageSize;
+        DS_EMU_HOT_PATH constexpr auto translate(emu::Core &core, T virtual_address, AccessType access) -> std::expected<T, AccessResult> final {
+            auto &r = static_cast<Core &>(core);
 
-            const auto vpn0 = util::extract_bits<12,21>(virtual_address);
-            const auto vpn1 = util::extract_bits<22,31>(virtual_address);
+            // Check if MMU is enabled
+            if (!is_translation_enabled(r))
+                return virtual_address;
 
-            const auto virtual_page_address = virtual_address & ~(PageSize - 1);
+            const auto virtual_page_address = virtual_address & ~T(PageSize - 1);
             const auto offset = virtual_address & (PageSize - 1);
-            if (auto it = m_tlb.find(virtual_page_address); it != m_tlb.end()) {
+            if (auto it = m_tlb.find(virtual_page_address); it != m_tlb.end() && is_access_permitted(r, it->second.flags, access)) [[likely]] {
                 // TLB hit
-                const T physical_page_address = it->second;
+                r.statistics().tlb_hits += 1;
+                const T physical_page_address = it->second.physical_page_address;
                 return physical_page_address | offset;
             } else {
-                // TLB miss
-                auto physical_address = get_physical_address(r, virtual_address, { vpn0, vpn1 }, root_page_table, 1, access);
+                // TLB miss. Cached pages the access isn't permitted on get walked again, which either raises
+                // the fault or sets the D bit for the first store to the page
+                r.statistics().tlb_misses += 1;
+                std::uint8_t flags = 0;
+                auto physical_address = walk<false>(r, virtual_address, access, flags);
                 if (physical_address.has_value())
-                    m_tlb.emplace(virtual_page_address, physical_address.value() & ~(PageSize - 1));
+                    m_tlb.insert_or_assign(virtual_page_address, TlbEntry { physical_address.value() & ~T(PageSize - 1), flags });
                 return physical_address;
             }
         }
 
-        constexpr auto get_physical_address(emu::riscv::Core &core, T va,
-                                           std::array<T,2> vpns, T page_table_addr,
-                                           uint8_t level, AccessType access) -> std::expected<T, AccessResult> {
+        // Walks the page tables without touching the TLB, the statistics or the A and D bits.
+        // Page tables outside of plain memory are treated as a fault instead of being read
+        constexpr auto translate_without_side_effects(emu::Core &core, T virtual_address, AccessType access) -> std::expected<T, AccessResult> final {
+            auto &r = static_cast<Core &>(core);
+            if (!is_translation_enabled(r))
+                return virtual_address;
+
+            std::uint8_t flags = 0;
+            return walk<true>(r, virtual_address, access, flags);
+        }
+
+        template<bool Inspect>
+        constexpr auto walk(Core &r, T virtual_address, AccessType access, std::uint8_t &flags) -> std::expected<T, AccessResult> {
+            T root_ppn;
+            uint8_t levels;
+            if constexpr (sizeof(T) == 4) {
+                // Sv32: root PPN is satp.PPN[21:0]
+                root_ppn = util::extract_bits<0,21>(r.satp().get());
+                levels = 2;
+            } else {
+                // Sv39 and Sv48: root PPN is satp.PPN[43:0]
+                root_ppn = util::extract_bits<0,43>(r.satp().get());
+                levels = (r.satp().get() >> 60) == Core::SatpModeSv39 ? 3 : 4;
+
+                // All bits above the translated ones have to be copies of the top most translated bit
+                const auto upper_bits = static_cast<std::make_signed_t<T>>(virtual_address) >> (12 + levels * VpnBits - 1);
+                if (upper_bits != 0 && upper_bits != -1)
+                    return std::unexpected(page_fault(access));
+            }
+
+            const T root_page_table = root_ppn * PageSize;
+
+            std::array<T, 4> vpns = {};
+            for (uint8_t level = 0; level < levels; level += 1)
+                vpns[level] = (virtual_address >> (12 + level * VpnBits)) & util::mask<VpnBits, T>();
+
+            return get_physical_address<Inspect>(r, virtual_address, vpns, root_page_table, levels - 1, access, flags);
+        }
+
+        template<bool Inspect = false>
+        constexpr auto get_physical_address(Core &core, T va,
+                                           std::array<T,4> vpns, T page_table_addr,
+                                           uint8_t level, AccessType access, std::uint8_t &flags) -> std::expected<T, AccessResult> {
             const auto index = vpns[level];
             const auto entry_addr = page_table_addr + index * PteSize;
 
-            std::uint32_t page_table_entry = 0;
-            if (core.address_space().read_physical(entry_addr, util::to_byte_span(page_table_entry)) != AccessResult::Success)
-                return std::unexpected(AccessResult::LoadPageFault);
+            T page_table_entry = 0;
+            if constexpr (Inspect) {
+                if (core.address_space().peek_physical(entry_addr, util::to_byte_span(page_table_entry)) != AccessResult::Success)
+                    return std::unexpected(AccessResult::LoadPageFault);
+            } else {
+                core.statistics().page_table_reads += 1;
+                if (core.address_space().read_physical(entry_addr, util::to_byte_span(page_table_entry)) != AccessResult::Success)
+                    return std::unexpected(AccessResult::LoadPageFault);
+            }
+
+            // PPN is bits 10..31 on Sv32 and bits 10..53 on Sv39 and Sv48
+            const T ppn = (page_table_entry >> 10) & util::mask<sizeof(T) == 4 ? 22 : 44, T>();
 
-            constexpr auto V = 1u << 0;
-            constexpr auto R = 1u << 1;
-            constexpr auto W = 1u << 2;
-            constexpr auto X = 1u << 3;
-            constexpr auto U = 1u << 4;
-            constexpr auto G = 1u << 5;
-            constexpr auto A = 1u << 6;
-            constexpr auto D = 1u << 7;
+            // Bits 54..63 belong to extensions that aren't supported and have to be zero
+            if constexpr (sizeof(T) == 8) {
+                if (page_table_entry >> 54 != 0)
+                    return std::unexpected(page_fault(access));
+            }
 
             // Check if page table entry is valid
             if (!(page_table_entry & V)) {
@@ -72,17 +138,21 @@ namespace ds::emu::dev::riscv {
 
             // Non-leaf: V=1 and R=W=X=0
             if ((page_table_entry & (R|W|X)) == 0) {
-                // next-level base = PPN (bits 10..31) << 12
-                const uint32_t ppn = util::extract_bits<10,31>(page_table_entry);
-                const T next_base = static_cast<T>(ppn) * PageSize;
+                const T next_base = ppn * PageSize;
                 if (level == 0) {
-                    // shouldn't happen: level 0 non-leaf is invalid in Sv32
+                    // shouldn't happen: level 0 non-leaf is invalid
                     return std::unexpected(AccessResult::LoadPageFault);
                 }
-                return get_physical_address(core, va, vpns, next_base, level - 1, access);
+                return get_physical_address<Inspect>(core, va, vpns, next_base, level - 1, access, flags);
             }
 
-            // Leaf PTE. Check permissions based on access type and current privilege.
+            // Leaf PTE. Superpages have to be aligned to their own size, checked before anything else about the leaf
+            // so a misaligned superpage faults without its A and D bits being updated
+            const T superpage_mask = (T(1) << (level * VpnBits)) - 1;
+            if ((ppn & superpage_mask) != 0)
+                return std::unexpected(page_fault(access));
+
+            // Check permissions based on access type and current privilege.
             const bool is_user_access = (core.privilege_level() == emu::riscv::PrivilegeLevel::User);
             const bool pte_user = page_table_entry & U;
 
@@ -133,25 +203,17 @@ namespace ds::emu::dev::riscv {
                 need_writeback = true;
             }
 
-            if (need_writeback) {
+            if (need_writeback && !Inspect) {
                 // "w"rite the updated PTE back (little endian) — handle error if write fails
                 core.address_space().write_physical(entry_addr, util::to_byte_span(page_table_entry));
             }
 
-            // Build physical address
-            const uint32_t ppn1 = util::extract_bits<20,31>(page_table_entry);
-            const uint32_t ppn0 = util::extract_bits<10,19>(page_table_entry);
-            const T offset = va & (PageSize - 1);
+            flags = static_cast<std::uint8_t>(page_table_entry);
 
-            T physical_page_address;
-            if (level == 1) {
-                // 4 MB superpage
-                physical_page_address = (static_cast<T>(ppn1) << 22) | (static_cast<T>(vpns[0]) << 12);
-            } else {
-                physical_page_address = (static_cast<T>(ppn1) << 22) | (static_cast<T>(ppn0) << 12);
-            }
+            // Build physical address. Superpages take the lower page numbers from the virtual address
+            const T physical_page_address = (ppn | ((va >> 12) & superpage_mask)) * PageSize;
+            const T offset = va & (PageSize - 1);
 
-            m_tlb[entry_addr] = physical_page_address;
             return physical_page_address | offset;
         }
 
@@ -160,7 +222,38 @@ namespace ds::emu::dev::riscv {
         }
 
     private:
-        std::unordered_map<std::uint32_t, std::uint32_t> m_tlb;
+        constexpr static auto is_translation_enabled(Core &core) -> bool {
+            if constexpr (sizeof(T) == 4)
+                return core.satp().get_bit(31);
+            else
+                return (core.satp().get() >> 60) != Core::SatpModeBare;
+        }
+
+        // Same checks the page table walk does for leaf PTEs. A store additionally requires the D bit to already be set
+        constexpr static auto is_access_permitted(Core &core, std::uint8_t flags, AccessType access) -> bool {
+            if (core.privilege_level() == emu::riscv::PrivilegeLevel::User) {
+                if (!(flags & U))
+                    return false;
+            } else if ((flags & U) && !core.sstatus().get_bit(18)) {
+                return false;
+            }
+
+            switch (access) {
+                case AccessType::Instruction:   return flags & X;
+                case AccessType::Load:          return flags & R;
+                case AccessType::Store:         return (flags & W) && (flags & D);
+            }
+
+            std::unreachable();
+        }
+
+        constexpr static auto page_fault(AccessType access) -> AccessResult {
+            return access == AccessType::Store ? AccessResult::StorePageFault :
+                   access == AccessType::Instruction ? AccessResult::FetchPageFault :
+                   AccessResult::LoadPageFault;
+        }
+
+        std::unordered_map<T, TlbEntry> m_tlb;
     };
 
 }
\ No newline at end of file
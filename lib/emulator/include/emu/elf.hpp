@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ds::emu {
+
+    // Minimal reader for little endian 32 and 64 bit ELF files. Only gives access to what's needed to
+    // load an executable into guest memory and to look up its symbols
+    class ElfFile {
+    public:
+        constexpr static std::uint16_t MachineRiscV = 243;
+
+        enum class SymbolType : std::uint8_t {
+            NoType      = 0,
+            Object      = 1,
+            Function    = 2
+        };
+
+        struct Segment {
+            std::uint64_t address;          // Physical load address
+            std::span<const std::uint8_t> data;
+            std::uint64_t memory_size;      // Anything past the file data is zero initialized
+        };
+
+        struct Symbol {
+            std::string name;
+            std::uint64_t value;
+            std::uint64_t size;
+            SymbolType type;
+        };
+
+        // Segments point into the file data, which stays in place when moving but not when copying
+        ElfFile(const ElfFile &) = delete;
+        ElfFile(ElfFile &&) = default;
+        ElfFile &operator=(const ElfFile &) = delete;
+        ElfFile &operator=(ElfFile &&) = default;
+
+        static auto load(const std::string &path) -> std::optional<ElfFile> {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file.is_open())
+                return std::nullopt;
+
+            std::vector<std::uint8_t> data(file.tellg());
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(data.data()), data.size());
+            if (!file)
+                return std::nullopt;
+
+            return parse(std::move(data));
+        }
+
+        static auto is_elf(std::span<const std::uint8_t> data) -> bool {
+            constexpr static std::array Magic = { std::uint8_t(0x7F), std::uint8_t('E'), std::uint8_t('L'), std::uint8_t('F') };
+            return data.size() >= Magic.size() && std::equal(Magic.begin(), Magic.end(), data.begin());
+        }
+
+        static auto parse(std::vector<std::uint8_t> data) -> std::optional<ElfFile> {
+            constexpr static auto ClassOffset = 4;
+            constexpr static auto DataOffset = 5;
+            constexpr static std::uint8_t Class32 = 1, Class64 = 2, LittleEndian = 1;
+
+            if (!is_elf(data) || data.size() <= DataOffset || data[DataOffset] != LittleEndian)
+                return std::nullopt;
+
+            ElfFile elf;
+            elf.m_data = std::move(data);
+
+            bool valid = false;
+            if (elf.m_data[ClassOffset] == Class32)
+                valid = elf.parse_contents<Elf32Header, Elf32ProgramHeader, Elf32SectionHeader, Elf32Symbol>();
+            else if (elf.m_data[ClassOffset] == Class64)
+                valid = elf.parse_contents<Elf64Header, Elf64ProgramHeader, Elf64SectionHeader, Elf64Symbol>();
+            elf.m_is_64bit = elf.m_data[ClassOffset] == Class64;
+
+            if (!valid)
+                return std::nullopt;
+
+            return elf;
+        }
+
+        [[nodiscard]] auto entry() const -> std::uint64_t {
+            return m_entry;
+        }
+
+        [[nodiscard]] auto machine() const -> std::uint16_t {
+            return m_machine;
+        }
+
+        [[nodiscard]] auto is_64bit() const -> bool {
+            return m_is_64bit;
+        }
+
+        [[nodiscard]] auto segments() const -> std::span<const Segment> {
+            return m_segments;
+        }
+
+        [[nodiscard]] auto symbols() const -> std::span<const Symbol> {
+            return m_symbols;
+        }
+
+        [[nodiscard]] auto find_symbol(std::string_view name) const -> const Symbol* {
+            const auto it = std::ranges::find(m_symbols, name, &Symbol::name);
+            return it == m_symbols.end() ? nullptr : &*it;
+        }
+
+    private:
+        ElfFile() = default;
+
+        template<typename T>
+        auto read(std::uint64_t offset, T &value) const -> bool {
+            if (offset > m_data.size() || m_data.size() - offset < sizeof(T))
+                return false;
+
+            std::memcpy(&value, m_data.data() + offset, sizeof(T));
+            return true;
+        }
+
+        template<typename Header, typename ProgramHeader, typename SectionHeader, typename Sym>
+        auto parse_contents() -> bool {
+            constexpr static std::uint32_t Load = 1;
+            constexpr static std::uint32_t SymTab = 2;
+
+            Header header = {};
+            if (!read(0, header))
+                return false;
+
+            m_entry = header.entry;
+            m_machine = header.machine;
+
+            for (std::uint16_t i = 0; i < header.program_header_count; i += 1) {
+                ProgramHeader program_header = {};
+                if (!read(header.program_header_offset + std::uint64_t(i) * header.program_header_size, program_header))
+                    return false;
+                if (program_header.type != Load)
+                    continue;
+                if (program_header.offset > m_data.size() || m_data.size() - program_header.offset < program_header.file_size)
+                    return false;
+
+                m_segments.emplace_back(
+                    program_header.physical_address,
+                    std::span(m_data).subspan(program_header.offset, program_header.file_size),
+                    std::max<std::uint64_t>(program_header.memory_size, program_header.file_size)
+                );
+            }
+
+            for (std::uint16_t i = 0; i < header.section_header_count; i += 1) {
+                SectionHeader section = {}, string_section = {};
+                if (!read(header.section_header_offset + std::uint64_t(i) * header.section_header_size, section))
+                    return false;
+                if (section.type != SymTab)
+                    continue;
+                if (!read(header.section_header_offset + std::uint64_t(section.link) * header.section_header_size, string_section))
+                    return false;
+
+                for (std::uint64_t offset = 0; offset + sizeof(Sym) <= section.size; offset += sizeof(Sym)) {
+                    Sym symbol = {};
+                    if (!read(section.offset + offset, symbol))
+                        return false;
+
+                    const auto name_offset = string_section.offset + symbol.name;
+                    if (symbol.section_index == 0 || symbol.name >= string_section.size || name_offset >= m_data.size())
+                        continue;
+
+                    const auto name_start = m_data.begin() + name_offset;
+                    m_symbols.emplace_back(
+                        std::string(name_start, std::find(name_start, m_data.end(), 0)),
+                        symbol.value, symbol.size, SymbolType(symbol.info & 0x0F)
+                    );
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        struct Elf32Header {
+            std::array<std::uint8_t, 16> identification;
+            std::uint16_t type, machine;
+            std::uint32_t version, entry, program_header_offset, section_header_offset, flags;
+            std::uint16_t header_size, program_header_size, program_header_count, section_header_size, section_header_count, section_name_index;
+        };
+
+        struct Elf32ProgramHeader {
+            std::uint32_t type, offset, virtual_address, physical_address, file_size, memory_size, flags, alignment;
+        };
+
+        struct Elf32SectionHeader {
+            std::uint32_t name, type, flags, address, offset, size, link, info, alignment, entry_size;
+        };
+
+        struct Elf32Symbol {
+            std::uint32_t name, value, size;
+            std::uint8_t info, other;
+            std::uint16_t section_index;
+        };
+
+        struct Elf64Header {
+            std::array<std::uint8_t, 16> identification;
+            std::uint16_t type, machine;
+            std::uint32_t version;
+            std::uint64_t entry, program_header_offset, section_header_offset;
+            std::uint32_t flags;
+            std::uint16_t header_size, program_header_size, program_header_count, section_header_size, section_header_count, section_name_index;
+        };
+
+        struct Elf64ProgramHeader {
+            std::uint32_t type, flags;
+            std::uint64_t offset, virtual_address, physical_address, file_size, memory_size, alignment;
+        };
+
+        struct Elf64SectionHeader {
+            std::uint32_t name, type;
+            std::uint64_t flags, address, offset, size;
+            std::uint32_t link, info;
+            std::uint64_t alignment, entry_size;
+        };
+
+        struct Elf64Symbol {
+            std::uint32_t name;
+            std::uint8_t info, other;
+            std::uint16_t section_index;
+            std::uint64_t value, size;
+        };
+
+        std::vector<std::uint8_t> m_data;
+        std::uint64_t m_entry = 0;
+        std::uint16_t m_machine = 0;
+        bool m_is_64bit = false;
+        std::vector<Segment> m_segments;
+        std::vector<Symbol> m_symbols;
+    };
+
+}
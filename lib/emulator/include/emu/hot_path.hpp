@@ -0,0 +1,11 @@
+#pragma once
+
+// Marks a function on the emulator's hot path as a boundary for host profiling.
+// Normally these functions get inlined into Core::step and vanish from profiles taken with tools like perf.
+// Building with EMULATOR_HOST_PROFILING keeps them out of line, so the time spent in instruction decoding,
+// address translation, physical memory accesses and trap handling shows up under their own names
+#if defined(DS_EMU_HOST_PROFILING)
+    #define DS_EMU_HOT_PATH [[gnu::noinline]]
+#else
+    #define DS_EMU_HOT_PATH
+#endif
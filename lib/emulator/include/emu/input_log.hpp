@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ds::emu {
+
+    // Channels used by every frontend, so recordings made with one of them can be replayed by the others
+    enum InputChannel : std::uint8_t {
+        UartInput = 0
+    };
+
+    struct InputEvent {
+        std::uint64_t tick;
+        std::uint8_t channel;
+        std::uint32_t value;
+    };
+
+    // Funnels all nondeterministic inputs (bytes received by a device, external interrupt lines, ...)
+    // into the emulator at well-defined points in time. Inputs pushed by the host get delivered at the
+    // beginning of the next emulator step and can be recorded together with the tick they were delivered at.
+    // Replaying such a recording delivers the exact same inputs at the exact same ticks again, which makes
+    // the whole run reproducible.
+    class InputLog {
+    public:
+        enum class Mode { Live, Record, Replay };
+
+        constexpr static auto MaxChannels = 32;
+        using Handler = std::function<void(std::uint32_t value)>;
+
+        InputLog() = default;
+        InputLog(const InputLog &) = delete;
+        InputLog &operator=(const InputLog &) = delete;
+
+        ~InputLog() {
+            stop();
+        }
+
+        auto bind(std::uint8_t channel, Handler handler) -> void {
+            m_handlers[channel] = std::move(handler);
+        }
+
+        // Called by the host from any thread. Ignored while a recording is being replayed
+        auto push(std::uint8_t channel, std::uint32_t value) -> void {
+            std::scoped_lock lock(m_pending_mutex);
+            m_pending.emplace_back(0, channel, value);
+            m_next_tick.store(0, std::memory_order_release);
+        }
+
+        // Called by the emulator before each step
+        auto poll(std::uint64_t tick) -> void {
+            if (tick < m_next_tick.load(std::memory_order_relaxed)) [[likely]]
+                return;
+
+            dispatch(tick);
+        }
+
+        auto start_recording(const std::string &path) -> bool {
+            stop();
+
+            m_file.open(path, std::ios::binary | std::ios::trunc);
+            if (!m_file.is_open())
+                return false;
+
+            m_file.write(FileMagic.data(), FileMagic.size());
+            m_file.put(FileVersion);
+
+            m_events.clear();
+            m_replay_index = 0;
+            m_last_tick = 0;
+            m_mode = Mode::Record;
+
+            return true;
+        }
+
+        auto start_replay(const std::string &path) -> bool {
+            stop();
+
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open())
+                return false;
+
+            const std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            auto events = decode(data);
+            if (!events.has_value())
+                return false;
+
+            m_events = std::move(*events);
+            m_replay_index = 0;
+            m_mode = Mode::Replay;
+            m_next_tick = m_events.empty() ? NoEvent : m_events.front().tick;
+
+            return true;
+        }
+
+        auto stop() -> void {
+            if (m_file.is_open()) {
+                m_file.flush();
+                m_file.close();
+            }
+
+            // Let the next poll pick up anything the host pushed in the meantime
+            m_mode = Mode::Live;
+            m_next_tick = 0;
+        }
+
+        // Moves back in time so all events from the given tick onwards get delivered again
+        // the next time the emulator reaches their tick
+        auto seek(std::uint64_t tick) -> void {
+            const auto it = std::ranges::lower_bound(m_events, tick, {}, &InputEvent::tick);
+            m_replay_index = std::distance(m_events.begin(), it);
+            m_next_tick = 0;
+        }
+
+        [[nodiscard]] auto mode() const -> Mode {
+            return m_mode;
+        }
+
+        // All events delivered so far, or the whole recording while replaying
+        [[nodiscard]] auto events() const -> std::span<const InputEvent> {
+            return m_events;
+        }
+
+    private:
+        constexpr static std::uint64_t NoEvent = std::numeric_limits<std::uint64_t>::max();
+        constexpr static std::array FileMagic = { 'D', 'S', 'I', 'L' };
+        constexpr static char FileVersion = 1;
+
+        auto deliver(const InputEvent &event) -> void {
+            if (event.channel < m_handlers.size() && m_handlers[event.channel])
+                m_handlers[event.channel](event.value);
+        }
+
+        auto dispatch(std::uint64_t tick) -> void {
+            // Deliver the events of a replayed recording or events that are executed again after seeking backwards
+            while (m_replay_index < m_events.size() && m_events[m_replay_index].tick <= tick) {
+                deliver(m_events[m_replay_index]);
+                m_replay_index += 1;
+            }
+
+            if (m_mode == Mode::Replay || m_replay_index < m_events.size()) {
+                m_next_tick = m_replay_index < m_events.size() ? m_events[m_replay_index].tick : NoEvent;
+
+                // Drop anything the host tried to inject during a replay, the recording is the only source of inputs.
+                // Otherwise, keep new inputs pending until the known history has been executed again
+                if (m_mode == Mode::Replay) {
+                    std::scoped_lock lock(m_pending_mutex);
+                    m_pending.clear();
+                }
+                return;
+            }
+
+            std::vector<InputEvent> pending;
+            {
+                std::scoped_lock lock(m_pending_mutex);
+                m_next_tick.store(NoEvent, std::memory_order_relaxed);
+                std::swap(pending, m_pending);
+            }
+
+            for (auto &event : pending) {
+                event.tick = tick;
+                if (m_mode == Mode::Record)
+                    record(event);
+
+                m_events.push_back(event);
+                m_replay_index = m_events.size();
+
+                deliver(event);
+            }
+        }
+
+        // Events are stored as a LEB128 encoded tick delta, a channel byte and a LEB128 encoded value
+        auto record(const InputEvent &event) -> void {
+            write_varint(event.tick - m_last_tick);
+            m_file.put(static_cast<char>(event.channel));
+            write_varint(event.value);
+
+            m_last_tick = event.tick;
+        }
+
+        auto write_varint(std::uint64_t value) -> void {
+            do {
+                std::uint8_t byte = value & 0x7F;
+                value >>= 7;
+                if (value != 0)
+                    byte |= 0x80;
+                m_file.put(static_cast<char>(byte));
+            } while (value != 0);
+        }
+
+        static auto decode(std::span<const std::uint8_t> data) -> std::optional<std::vector<InputEvent>> {
+            if (data.size() < FileMagic.size() + 1 || std::memcmp(data.data(), FileMagic.data(), FileMagic.size()) != 0 || data[FileMagic.size()] != FileVersion)
+                return std::nullopt;
+
+            std::size_t offset = FileMagic.size() + 1;
+            const auto read_varint = [&]() -> std::optional<std::uint64_t> {
+                std::uint64_t value = 0;
+                for (std::uint32_t shift = 0; offset < data.size() && shift < 64; shift += 7) {
+                    const auto byte = data[offset++];
+                    value |= std::uint64_t(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        return value;
+                }
+
+                return std::nullopt;
+            };
+
+            std::vector<InputEvent> events;
+            std::uint64_t tick = 0;
+            while (offset < data.size()) {
+                const auto delta = read_varint();
+                if (!delta.has_value() || offset >= data.size())
+                    return std::nullopt;
+
+                const auto channel = data[offset++];
+                const auto value = read_varint();
+                if (!value.has_value())
+                    return std::nullopt;
+
+                tick += *delta;
+                events.emplace_back(tick, channel, static_cast<std::uint32_t>(*value));
+            }
+
+            return events;
+        }
+
+    private:
+        Mode m_mode = Mode::Live;
+        std::array<Handler, MaxChannels> m_handlers;
+
+        std::atomic<std::uint64_t> m_next_tick = NoEvent;
+        std::mutex m_pending_mutex;
+        std::vector<InputEvent> m_pending;
+
+        std::vector<InputEvent> m_events;
+        std::size_t m_replay_index = 0;
+        std::uint64_t m_last_tick = 0;
+        std::ofstream m_file;
+    };
+
+}
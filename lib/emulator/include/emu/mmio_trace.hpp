@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ds::emu {
+
+    enum class MmioDirection : std::uint8_t {
+        Read    = 0,
+        Write   = 1,
+        Fill    = 2     // Write of `size` bytes that all equal the lowest byte of the value, e.g. a cbo.zero
+    };
+
+    // A single access to a memory mapped peripheral as stored in a trace file.
+    // Trace files start with the magic and version followed by nothing but these records
+    struct MmioTraceRecord {
+        std::uint64_t tick;         // Emulator step the access happened in
+        std::uint64_t value;        // Little endian data read or written, zero extended
+        std::uint32_t pc;
+        std::uint32_t address;      // Physical address
+        std::uint16_t hart;
+        std::uint8_t size;          // Bytes accessed, at most the size of the value except for fills
+        MmioDirection direction;
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(MmioTraceRecord) == 32);
+
+    constexpr static std::array MmioTraceFileMagic = { 'D', 'S', 'M', 'T' };
+    constexpr static char MmioTraceFileVersion = 2;
+
+    // Version 1 files only lack fill records, so they can still be read
+    constexpr static char MmioTraceFileMinimumVersion = 1;
+
+    // Loads all records of a trace file written by the MMIO tracer
+    inline auto read_mmio_trace(const std::string &path) -> std::optional<std::vector<MmioTraceRecord>> {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return std::nullopt;
+
+        const std::size_t file_size = file.tellg();
+        constexpr static auto HeaderSize = MmioTraceFileMagic.size() + 1;
+        if (file_size < HeaderSize || (file_size - HeaderSize) % sizeof(MmioTraceRecord) != 0)
+            return std::nullopt;
+
+        file.seekg(0);
+        std::array<char, HeaderSize> header = {};
+        file.read(header.data(), header.size());
+        if (std::memcmp(header.data(), MmioTraceFileMagic.data(), MmioTraceFileMagic.size()) != 0 || header.back() < MmioTraceFileMinimumVersion || header.back() > MmioTraceFileVersion)
+            return std::nullopt;
+
+        std::vector<MmioTraceRecord> records((file_size - HeaderSize) / sizeof(MmioTraceRecord));
+        file.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(MmioTraceRecord));
+        if (!file)
+            return std::nullopt;
+
+        return records;
+    }
+
+}
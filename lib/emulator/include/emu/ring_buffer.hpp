@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace ds::emu {
+
+    // Lock-free ring buffer for exactly one producer and one consumer thread.
+    // The capacity gets rounded up to the next power of two
+    template<typename T>
+    class RingBuffer {
+    public:
+        explicit RingBuffer(std::size_t capacity) : m_buffer(std::bit_ceil(std::max<std::size_t>(capacity, 2))), m_mask(m_buffer.size() - 1) { }
+
+        // Called by the producer. Returns false if the buffer is full
+        auto push(const T &value) -> bool {
+            const auto head = m_head.load(std::memory_order_relaxed);
+            if (head - m_cached_tail >= m_buffer.size()) [[unlikely]] {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+                if (head - m_cached_tail >= m_buffer.size())
+                    return false;
+            }
+
+            m_buffer[head & m_mask] = value;
+            m_head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Called by the consumer. Moves as many values as available into the buffer and returns how many that were
+        auto pop(std::span<T> values) -> std::size_t {
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+            const auto head = m_head.load(std::memory_order_acquire);
+            const auto count = std::min<std::size_t>(head - tail, values.size());
+
+            for (std::size_t i = 0; i < count; i += 1) {
+                values[i] = m_buffer[(tail + i) & m_mask];
+            }
+            m_tail.store(tail + count, std::memory_order_release);
+
+            return count;
+        }
+
+        [[nodiscard]] auto capacity() const -> std::size_t {
+            return m_buffer.size();
+        }
+
+    private:
+        std::vector<T> m_buffer;
+        std::size_t m_mask;
+
+        // Keep producer and consumer indices on separate cache lines so they don't fight over them
+        alignas(std::hardware_destructive_interference_size) std::atomic<std::size_t> m_head = 0;
+        std::size_t m_cached_tail = 0;
+        alignas(std::hardware_destructive_interference_size) std::atomic<std::size_t> m_tail = 0;
+    };
+
+}
@@ -1,15 +1,22 @@
 #pragma once
 
+#include <array>
+#include <concepts>
 #include <cstring>
 #include <expected>
 #include <functional>
+#include <optional>
 #include <span>
+#include <type_traits>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include <emu/core.hpp>
 #include <emu/address_space.hpp>
+#include <emu/hot_path.hpp>
 #include <emu/register.hpp>
+#include <emu/state.hpp>
 #include <emu/riscv/instructions.hpp>
 #include <emu/utils.hpp>
 
@@ -65,21 +72,66 @@ namespace ds::emu::riscv {
         Machine
     };
 
-    using Register = RegisterBase<std::uint32_t>;
+    // Counters describing what the guest executed on a single hart
+    struct CoreStatistics {
+        std::uint64_t cycles;                           // Steps taken by this hart, including idle ones
+        std::uint64_t instructions_retired;
+        std::uint64_t idle_steps;                       // Steps spent waiting for an interrupt after a WFI
+        std::uint64_t taken_branches;                   // Conditional branches that were taken
+        std::uint64_t mmio_accesses;                    // Accesses to peripherals other than memory
 
-    class Core : public emu::Core {
+        std::array<std::uint64_t, 32> opcodes;          // Executed instructions, indexed by their instr::base opcode
+        std::array<std::uint64_t, 32> exceptions;       // Indexed by ExceptionCause
+        std::array<std::uint64_t, 32> interrupts;       // Indexed by interrupt number
+
+        std::uint64_t misaligned_accesses;              // Misaligned loads and stores performed without trapping to the guest
+
+        std::uint64_t tlb_hits;
+        std::uint64_t tlb_misses;
+        std::uint64_t page_table_reads;                 // Page table entries read while walking the page tables
+    };
+
+    // Counters readable by the guest through the cycle, time, instret and hpmcounter CSRs, numbered like those
+    enum class Counter : std::uint8_t {
+        Cycle               = 0,
+        Time                = 1,
+        InstructionsRetired = 2,
+        TlbMisses           = 3,
+        Traps               = 4,
+        MmioAccesses        = 5,
+        TakenBranches       = 6
+    };
+
+    constexpr static std::size_t CounterCount = 7;
+
+    // A RISC-V hart, T being the type of its integer registers. std::uint32_t makes it an RV32 and std::uint64_t an RV64 hart
+    template<std::unsigned_integral T>
+    class BasicCore : public emu::Core {
     public:
-        Core() = default;
-        Core(std::uint16_t hart, AddressSpace<std::uint32_t> *address_space)
+        using Register = RegisterBase<T>;
+        using Signed = std::make_signed_t<T>;
+
+        constexpr static std::uint32_t XLen = sizeof(T) * 8;
+
+        // Translation modes selectable through satp.MODE on RV64, RV32 only knows Bare and Sv32
+        constexpr static T SatpModeBare = 0;
+        constexpr static T SatpModeSv39 = 8;
+        constexpr static T SatpModeSv48 = 9;
+
+        // Size of the blocks operated on by the Zicbom and Zicboz instructions, advertised to the guest through the device tree
+        constexpr static std::uint32_t CacheBlockSize = 64;
+
+        BasicCore() = default;
+        BasicCore(std::uint16_t hart, AddressSpace<T> *address_space)
             : m_hart(hart), m_address_space(address_space) {
             reset();
         }
 
-        Core(const Core &other) = delete;
-        Core(Core &&other) = default;
+        BasicCore(const BasicCore &other) = delete;
+        BasicCore(BasicCore &&other) = default;
 
-        Core &operator=(const Core &other) = delete;
-        Core &operator=(Core &&other) = default;
+        BasicCore &operator=(const BasicCore &other) = delete;
+        BasicCore &operator=(BasicCore &&other) = default;
 
         std::expected<void, ExceptionCause> step();
 
@@ -87,8 +139,28 @@ namespace ds::emu::riscv {
             return m_privilege_level;
         }
 
-        constexpr void set_privilege_level(PrivilegeLevel privilege_level) {
+        void set_privilege_level(PrivilegeLevel privilege_level) {
             m_privilege_level = privilege_level;
+            update_interrupt_pending();
+        }
+
+        // Raises or lowers one of the interrupt lines in sip, e.g. the supervisor timer interrupt
+        auto set_interrupt_pending(std::uint8_t interrupt, bool pending) -> void {
+            if (sip().get_bit(interrupt) == pending)
+                return;
+
+            sip().set_bit(interrupt, pending);
+            update_interrupt_pending();
+        }
+
+        // step() only looks for interrupts while this flag is set. The core updates it itself whenever sip, sie, sstatus.SIE,
+        // mideleg or the privilege level change, anything else writing to these CSRs directly has to call this afterwards
+        auto update_interrupt_pending() -> void {
+            const auto pending = sip() & sie();
+            const bool enabled = m_privilege_level == PrivilegeLevel::User || (m_privilege_level == PrivilegeLevel::Supervisor && sstatus().get_bit(1));
+
+            // A hart waiting in WFI wakes up on any pending interrupt, even while they're globally disabled
+            m_interrupt_pending = pending != 0 && (enabled || !m_powered_up || (pending & ~mideleg()) != 0);
         }
 
         constexpr auto x(std::uint8_t number) -> Register& {
@@ -101,10 +173,21 @@ namespace ds::emu::riscv {
             }
         }
 
-        constexpr auto csr(std::uint16_t number) -> Register& {
+        // Returns the concrete register type so CSR accesses don't need to go through the virtual interface
+        constexpr auto csr(std::uint16_t number) -> GeneralPurposeRegister<T>& {
             return m_csrs[number];
         }
 
+        // Floating point registers. Single precision values are NaN-boxed into the lower half
+        constexpr auto f(std::uint8_t number) -> std::uint64_t& {
+            return m_fp_registers[number];
+        }
+
+        // All CSRs at once, indexed by their number
+        [[nodiscard]] constexpr auto csrs() const -> std::span<const GeneralPurposeRegister<T>, 4096> {
+            return m_csrs;
+        }
+
         auto hart_id() -> std::uint16_t {
             return m_hart;
         }
@@ -144,10 +227,13 @@ namespace ds::emu::riscv {
         auto t5()   -> auto& { return x(30); }
         auto t6()   -> auto& { return x(31); }
 
+        auto fcsr()         -> auto& { return csr(0x003); }
+
         auto sstatus()      -> auto& { return csr(0x100); }
         auto sie()          -> auto& { return csr(0x104); }
         auto stvec()        -> auto& { return csr(0x105); }
         auto scounteren()   -> auto& { return csr(0x106); }
+        auto senvcfg()      -> auto& { return csr(0x10A); }
 
         auto sscratch()     -> auto& { return csr(0x140); }
         auto sepc()         -> auto& { return csr(0x141); }
@@ -160,10 +246,7 @@ namespace ds::emu::riscv {
         auto mip()          -> auto& { return csr(0x344); }
         auto mie()          -> auto& { return csr(0x304); }
 
-        auto cycle()        -> auto& { return csr(0xC00); }
         auto time()         -> auto& { return csr(0xC01); }
-
-        auto cycleh()       -> auto& { return csr(0xC80); }
         auto timeh()        -> auto& { return csr(0xC81); }
 
         auto mideleg()      -> auto& { return csr(0x303); }
@@ -171,25 +254,74 @@ namespace ds::emu::riscv {
 
         auto reset() -> void {
             m_registers    = {};
+            m_fp_registers = {};
             m_csrs         = {};
             m_program_counter = 0x0000'0000;
+            m_lr_reservation = 0x00;
             m_powered_up = true;
+            m_privilege_level = PrivilegeLevel::Supervisor;
+            m_statistics = {};
+            m_counter_offsets = {};
+            m_stopped_counters = 0;
             a0() = m_hart;
 
             mideleg() = 0xFFFF'FFFF;
+            if constexpr (XLen == 64)
+                sstatus() = T(0b10) << 32;      // UXL = 64
+
+            update_interrupt_pending();
+        }
+
+        // Performs misaligned loads and stores directly instead of raising an exception the guest has to emulate them in.
+        // AMOs and LR/SC still require natural alignment
+        constexpr auto set_native_misaligned_access(bool enabled) -> void {
+            m_native_misaligned_access = enabled;
+        }
+
+        [[nodiscard]] constexpr auto native_misaligned_access() const -> bool {
+            return m_native_misaligned_access;
         }
 
-        [[nodiscard]] constexpr auto address_space() const -> AddressSpace<std::uint32_t>& {
+        // Performance counters count the events recorded in the statistics from the moment the core is reset.
+        // Stopping a counter freezes its value, setting it only changes the value it continues counting from
+        [[nodiscard]] auto counter(Counter counter) const -> std::uint64_t;
+        auto set_counter(Counter counter, std::uint64_t value) -> void;
+        auto start_counter(Counter counter) -> void;
+        auto stop_counter(Counter counter) -> void;
+
+        [[nodiscard]] constexpr auto is_counter_running(Counter counter) const -> bool {
+            return (m_stopped_counters & (1U << std::to_underlying(counter))) == 0;
+        }
+
+        [[nodiscard]] constexpr auto statistics() -> CoreStatistics& {
+            return m_statistics;
+        }
+
+        [[nodiscard]] constexpr auto statistics() const -> const CoreStatistics& {
+            return m_statistics;
+        }
+
+        auto save_state(StateWriter &writer) const -> void;
+        auto load_state(StateReader &reader) -> void;
+
+        [[nodiscard]] constexpr auto address_space() const -> AddressSpace<T>& {
             return *m_address_space;
         }
 
-        template<typename T>
-        auto read(std::uint32_t address) -> std::expected<T, ExceptionCause> {
-            if (address % alignof(T) != 0) [[unlikely]] {
-                stval() = address;
-                return std::unexpected(ExceptionCause::LoadMisalign);
+        template<typename Data>
+        auto read(T address) -> std::expected<Data, ExceptionCause> {
+            if (address % alignof(Data) != 0) [[unlikely]] {
+                if (!m_native_misaligned_access) {
+                    stval() = address;
+                    return std::unexpected(ExceptionCause::LoadMisalign);
+                }
+
+                Data data;
+                if (const auto result = read_misaligned(address, util::to_byte_span(data)); !result.has_value())
+                    return std::unexpected(result.error());
+                return data;
             }
-            T data;
+            Data data;
             const auto result = m_address_space->read(*this, address, util::to_byte_span(data));
             switch (result) {
                 using enum AccessResult;
@@ -201,13 +333,13 @@ namespace ds::emu::riscv {
             }
         }
 
-        template<typename T>
-        auto read_physical(std::uint32_t address) -> std::expected<T, ExceptionCause> {
-            if (address % alignof(T) != 0) [[unlikely]] {
+        template<typename Data>
+        auto read_physical(T address) -> std::expected<Data, ExceptionCause> {
+            if (address % alignof(Data) != 0) [[unlikely]] {
                 stval() = address;
                 return std::unexpected(ExceptionCause::LoadMisalign);
             }
-            T data;
+            Data data;
             const auto result = m_address_space->read_physical(address, util::to_byte_span(data));
             switch (result) {
                 using enum AccessResult;
@@ -219,14 +351,14 @@ namespace ds::emu::riscv {
             }
         }
 
-        template<typename T>
-        auto fetch(std::uint32_t address) -> std::expected<T, ExceptionCause> {
-            if (address % alignof(T) != 0) [[unlikely]] {
+        template<typename Data>
+        DS_EMU_HOT_PATH auto fetch(T address) -> std::expected<Data, ExceptionCause> {
+            if (address % alignof(Data) != 0) [[unlikely]] {
                 stval() = address;
                 return std::unexpected(ExceptionCause::PCMisalign);
             }
 
-            T data;
+            Data data;
             const auto result = m_address_space->read(*this, address, util::to_byte_span(data));
             switch (result) {
                 using enum AccessResult;
@@ -238,14 +370,14 @@ namespace ds::emu::riscv {
             }
         }
 
-        template<typename T>
-        auto fetch_physical(std::uint32_t address) -> std::expected<T, ExceptionCause> {
-            if (address % alignof(T) != 0) [[unlikely]] {
+        template<typename Data>
+        auto fetch_physical(T address) -> std::expected<Data, ExceptionCause> {
+            if (address % alignof(Data) != 0) [[unlikely]] {
                 stval() = address;
                 return std::unexpected(ExceptionCause::PCMisalign);
             }
 
-            T data;
+            Data data;
             const auto result = m_address_space->read_physical(address, util::to_byte_span(data));
             switch (result) {
                 using enum AccessResult;
@@ -257,11 +389,15 @@ namespace ds::emu::riscv {
             }
         }
 
-        template<typename T>
-        auto write(std::uint32_t address, T value) -> std::expected<void, ExceptionCause> {
-            if (address % alignof(T) != 0) [[unlikely]] {
-                stval() = address;
-                return std::unexpected(ExceptionCause::StoreMisalign);
+        template<typename Data>
+        auto write(T address, Data value) -> std::expected<void, ExceptionCause> {
+            if (address % alignof(Data) != 0) [[unlikely]] {
+                if (!m_native_misaligned_access) {
+                    stval() = address;
+                    return std::unexpected(ExceptionCause::StoreMisalign);
+                }
+
+                return write_misaligned(address, util::to_byte_span(value));
             }
 
             const auto result = m_address_space->write(*this, address, util::to_byte_span(value));
@@ -275,9 +411,9 @@ namespace ds::emu::riscv {
             }
         }
 
-        template<typename T>
-        auto write_physical(std::uint32_t address, T value) -> std::expected<void, ExceptionCause> {
-            if (address % alignof(T) != 0) [[unlikely]] {
+        template<typename Data>
+        auto write_physical(T address, Data value) -> std::expected<void, ExceptionCause> {
+            if (address % alignof(Data) != 0) [[unlikely]] {
                 stval() = address;
                 return std::unexpected(ExceptionCause::StoreMisalign);
             }
@@ -295,26 +431,60 @@ namespace ds::emu::riscv {
 
     private:
         auto handle_std_instructions(std::uint32_t instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_compressed(std::uint32_t instruction) -> std::expected<void, ExceptionCause>;
 
         auto handle_unimplemented(std::uint32_t instruction) -> std::expected<void, ExceptionCause>;
         auto handle_system(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
         auto handle_jal(const instr::base::type::J &instruction) -> std::expected<void, ExceptionCause>;
         auto handle_jalr(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+        template<std::uint32_t Funct3>
         auto handle_load(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+        template<std::uint32_t Funct3>
         auto handle_store(const instr::base::type::S &instruction) -> std::expected<void, ExceptionCause>;
         auto handle_lui(const instr::base::type::U &instruction) -> std::expected<void, ExceptionCause>;
         auto handle_auipc(const instr::base::type::U &instruction) -> std::expected<void, ExceptionCause>;
+        template<std::uint32_t Funct3>
         auto handle_op_imm(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+        template<std::uint32_t Funct3, std::uint32_t Funct7>
         auto handle_op(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_op_imm_32(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_op_32(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause>;
+        template<std::uint32_t Funct3>
         auto handle_branch(const instr::base::type::B &instruction) -> std::expected<void, ExceptionCause>;
         auto handle_misc_mem(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+        template<std::uint32_t Funct3>
         auto handle_amo(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause>;
+        template<std::unsigned_integral Data>
+        auto handle_atomic(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_cache_block_operation(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_load_fp(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_store_fp(const instr::base::type::S &instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_fused_multiply_add(const instr::base::type::R4 &instruction) -> std::expected<void, ExceptionCause>;
+        auto handle_op_fp(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause>;
+
+        auto read_csr(std::uint16_t number) -> T;
+        auto write_csr(std::uint16_t number, T value) -> void;
+
+        // The FPU is off until the kernel sets sstatus.FS, so it only has to save the FP state of processes that use it
+        [[nodiscard]] auto is_fpu_enabled() -> bool;
+        auto mark_fp_state_dirty() -> void;
+        auto accrue_fp_exceptions(std::uint32_t flags) -> void;
+        [[nodiscard]] auto get_rounding_mode(std::uint8_t rounding_mode) -> std::optional<std::uint8_t>;
+
+        [[nodiscard]] auto count_events(Counter counter) const -> std::uint64_t;
+
+        auto read_misaligned(T address, std::span<std::uint8_t> buffer) -> std::expected<void, ExceptionCause>;
+        auto write_misaligned(T address, std::span<const std::uint8_t> buffer) -> std::expected<void, ExceptionCause>;
 
-        auto handle_interrupts() -> void;
-        auto trap() -> void;
+        DS_EMU_HOT_PATH auto fetch_instruction() -> std::expected<std::uint32_t, ExceptionCause>;
+        DS_EMU_HOT_PATH auto handle_interrupts() -> void;
+        DS_EMU_HOT_PATH auto trap() -> void;
 
     private:
-        using HandlerFunction = std::expected<void, ExceptionCause>(Core::*)(std::uint32_t instruction);
+        // sstatus.SD, summarizes whether the FPU state is dirty
+        constexpr static T StatusStateDirty = T(1) << (XLen - 1);
+
+        using HandlerFunction = std::expected<void, ExceptionCause>(BasicCore::*)(std::uint32_t instruction);
 
         template<typename Instr, auto HandlerFunction>
         struct Entry {
@@ -323,7 +493,7 @@ namespace ds::emu::riscv {
         };
 
         template<typename Entry>
-        auto decode_instruction(std::uint32_t instruction) -> std::expected<void, ExceptionCause> {
+        DS_EMU_HOT_PATH auto decode_instruction(std::uint32_t instruction) -> std::expected<void, ExceptionCause> {
             if constexpr (requires { (this->*Entry::Handler)(typename Entry::Instruction::Type(instruction)); }) {
                 return (this->*Entry::Handler)(typename Entry::Instruction::Type(instruction));
             } else {
@@ -333,7 +503,7 @@ namespace ds::emu::riscv {
 
         template<typename First, typename ... Rest>
         constexpr static auto jumpTableImpl(auto &table) -> void {
-            table[First::Instruction::Value] = &Core::decode_instruction<First>;
+            table[First::Instruction::Value] = &BasicCore::decode_instruction<First>;
             if constexpr (sizeof...(Rest) > 0) {
                 return jumpTableImpl<Rest...>(table);
             }
@@ -344,11 +514,11 @@ namespace ds::emu::riscv {
             constexpr static auto NumBits = (To - From) + 1;
             std::array<HandlerFunction, 1 << NumBits> table = {};
             for (auto &handler : table) {
-                handler = &Core::handle_unimplemented;
+                handler = &BasicCore::handle_unimplemented;
             }
             jumpTableImpl<Entries...>(table);
 
-            return [table](Core *emulator, std::uint32_t instruction) {
+            return [table](BasicCore *emulator, std::uint32_t instruction) {
                 const auto index = (instruction & (util::mask<NumBits>() << From)) >> From;
                 const HandlerFunction handler = table[index];
 
@@ -356,18 +526,85 @@ namespace ds::emu::riscv {
             };
         }
 
+        // funct7 bits that are part of the flat dispatch table index, bit 0 selects the M extension and bit 5 SUB and SRA
+        constexpr static std::uint32_t DispatchFunct7Mask = 0b010'0001;
+
+        // Index into the flat dispatch table, made up of the opcode, funct3 and the funct7 bits in DispatchFunct7Mask
+        constexpr static auto dispatch_index(std::uint32_t instruction) -> std::uint32_t {
+            return util::extract_bits<2, 6>(instruction) |
+                   (util::extract_bits<12, 14>(instruction) << 5) |
+                   (util::extract_bits<25, 25>(instruction) << 8) |
+                   (util::extract_bits<30, 30>(instruction) << 9);
+        }
+
+        // Handler with the operation selected by a dispatch table index baked in, nullptr for opcodes without specialized handlers
+        template<std::size_t Index>
+        constexpr static auto specialized_handler() -> HandlerFunction;
+
+        template<typename First, typename ... Rest>
+        constexpr static auto flatJumpTableImpl(auto &table) -> void {
+            // Handlers that aren't specialized handle every combination of the funct fields
+            for (std::size_t funct = 0; funct < table.size() >> 5; funct += 1) {
+                table[First::Instruction::Value | (funct << 5)] = &BasicCore::decode_instruction<First>;
+            }
+            if constexpr (sizeof...(Rest) > 0) {
+                return flatJumpTableImpl<Rest...>(table);
+            }
+        }
+
+        template<std::size_t ... Indices>
+        constexpr static auto specializeJumpTable(auto &table, std::index_sequence<Indices...>) -> void {
+            ((table[Indices] = specialized_handler<Indices>() != nullptr ? specialized_handler<Indices>() : table[Indices]), ...);
+        }
+
+        // Like jumpTable, but indexed by dispatch_index() so a single lookup already selects the operation.
+        // Specialized handlers replace the entries of their opcode
+        template<typename ... Entries>
+        constexpr static auto flatJumpTable() -> auto {
+            std::array<HandlerFunction, 1 << 10> table = {};
+            for (auto &handler : table) {
+                handler = &BasicCore::handle_unimplemented;
+            }
+            flatJumpTableImpl<Entries...>(table);
+            specializeJumpTable(table, std::make_index_sequence<table.size()>{});
+
+            return [table](BasicCore *emulator, std::uint32_t instruction) {
+                const HandlerFunction handler = table[dispatch_index(instruction)];
+
+                return (emulator->*handler)(instruction);
+            };
+        }
+
     private:
         bool m_powered_up = true;
+        bool m_interrupt_pending = false;
         std::uint16_t m_hart = 0;
-        AddressSpace<std::uint32_t> *m_address_space = nullptr;
+        AddressSpace<T> *m_address_space = nullptr;
+
+        ZeroRegister<T> m_zeroRegister;
+        std::array<GeneralPurposeRegister<T>, 31> m_registers = {};
+        std::array<std::uint64_t, 32> m_fp_registers = {};
+        GeneralPurposeRegister<T> m_program_counter = {};
+        T m_lr_reservation = 0x00;
+        bool m_native_misaligned_access = false;
 
-        ZeroRegister<std::uint32_t> m_zeroRegister;
-        std::array<GeneralPurposeRegister<std::uint32_t>, 31> m_registers = {};
-        GeneralPurposeRegister<std::uint32_t> m_program_counter = {};
-        std::uint32_t m_lr_reservation = 0x00;
+        // Running counters hold the difference between their value and the event count, stopped ones their value
+        std::array<std::uint64_t, CounterCount> m_counter_offsets = {};
+        std::uint32_t m_stopped_counters = 0;
 
-        std::array<GeneralPurposeRegister<std::uint32_t>, 4096> m_csrs;
+        // Size of the instruction currently executing, handlers use it to find the next instruction
+        std::uint32_t m_instruction_length = 4;
+
+        std::array<GeneralPurposeRegister<T>, 4096> m_csrs;
         PrivilegeLevel m_privilege_level = PrivilegeLevel::Supervisor;
+
+        CoreStatistics m_statistics = {};
     };
 
+    extern template class BasicCore<std::uint32_t>;
+    extern template class BasicCore<std::uint64_t>;
+
+    using Core   = BasicCore<std::uint32_t>;
+    using Core64 = BasicCore<std::uint64_t>;
+
 }
\ No newline at end of file
@@ -2,16 +2,23 @@
 
 #include <array>
 #include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
 
+#include <emu/input_log.hpp>
+#include <emu/state.hpp>
 #include <emu/riscv/core.hpp>
 #include <emu/riscv/machine_mode_firmware.hpp>
 #include <emu/riscv/machine_mode_firmware_extensions.hpp>
 
 namespace ds::emu::riscv {
 
-    template<std::size_t NumCores>
+    template<std::size_t NumCores, typename T = std::uint32_t>
     class Emulator {
     public:
+        using Core = BasicCore<T>;
+
         Emulator() {
             for (std::size_t i = 0; i < NumCores; i += 1) {
                 m_cores[i] = Core(i, &m_address_space);
@@ -22,8 +29,13 @@ namespace ds::emu::riscv {
             if (m_in_reset) [[unlikely]]
                 return std::unexpected(ExceptionCause::CoreStopped);
 
+            // Deliver inputs from the outside world at a deterministic point in time
+            if (m_input_log != nullptr)
+                m_input_log->poll(m_ticks);
+            m_ticks += 1;
+
             auto &core = m_cores[m_current_core];
-            const std::uint32_t curr_pc = core.pc();
+            const T curr_pc = core.pc();
 
             // Step the core one instruction forward
             const auto result = core.step();
@@ -36,12 +48,26 @@ namespace ds::emu::riscv {
                     core.a0(), core.a1(), core.a2(), core.a3(), core.a4(), core.a5()
                 );
 
-                core.a0() = static_cast<std::uint32_t>(error);
+                core.a0() = static_cast<T>(error);
                 core.a1() = return_value;
 
                 core.scause() = 0;
                 core.sip() &= ~util::bit<ExceptionCause::ECallSupervisor>();
                 core.set_privilege_level(PrivilegeLevel::Supervisor);
+
+                // Handle shutdown and reboot requests made through the SRST extension
+                auto &rst = m_machine_mode_firmware.template extension<m_mode::ExtensionRst>();
+                if (const auto request = rst.pending_request(); request.has_value()) [[unlikely]] {
+                    if (request->type == m_mode::ResetType::Shutdown) {
+                        m_shutdown_reason = request->reason;
+                        m_in_reset = true;
+
+                        return std::unexpected(ExceptionCause::CoreStopped);
+                    }
+
+                    reboot();
+                    return {};
+                }
             }
             m_machine_mode_firmware.update(core);
 
@@ -51,7 +77,7 @@ namespace ds::emu::riscv {
             return result;
         }
 
-        auto address_space() -> AddressSpace<std::uint32_t>& {
+        auto address_space() -> AddressSpace<T>& {
             return m_address_space;
         }
 
@@ -59,6 +85,40 @@ namespace ds::emu::riscv {
             return m_cores;
         }
 
+        // Core that executes the next step
+        auto current_core() -> Core& {
+            return m_cores[m_current_core];
+        }
+
+        // Saves the state of the cores, the firmware and all peripherals except for RAM contents
+        auto save_state(StateWriter &writer) const -> void {
+            for (const auto &core : m_cores) {
+                core.save_state(writer);
+            }
+
+            m_machine_mode_firmware.save_state(writer);
+            m_address_space.save_state(writer);
+
+            writer.write(m_in_reset);
+            writer.write(m_shutdown_reason);
+            writer.write(m_ticks);
+            writer.write(m_current_core);
+        }
+
+        auto load_state(StateReader &reader) -> void {
+            for (auto &core : m_cores) {
+                core.load_state(reader);
+            }
+
+            m_machine_mode_firmware.load_state(reader);
+            m_address_space.load_state(reader);
+
+            m_in_reset        = reader.read<bool>();
+            m_shutdown_reason = reader.read<std::optional<m_mode::ResetReason>>();
+            m_ticks           = reader.read<std::uint64_t>();
+            m_current_core    = reader.read<std::size_t>();
+        }
+
         auto reset() -> void {
             for (auto &core : m_cores) {
                 core.reset();
@@ -73,13 +133,87 @@ namespace ds::emu::riscv {
         auto power_up() -> void {
             reset();
             m_in_reset = false;
+            m_shutdown_reason.reset();
+            m_ticks = 0;
+
+            load_boot_images();
         }
 
+        // Restarts the machine in place. Contrary to a power cycle, RAM is neither
+        // cleared nor reallocated, only the boot images are copied back into it
+        auto reboot() -> void {
+            for (auto &core : m_cores) {
+                core.reset();
+            }
+
+            m_address_space.warm_reset();
+            m_machine_mode_firmware.reset();
+
+            m_current_core = 0;
+            load_boot_images();
+        }
+
+        // Registers an image that gets loaded into memory whenever the machine is powered up or rebooted.
+        // The data is referenced, not copied, so it needs to stay alive as long as the emulator does
+        auto add_boot_image(T address, std::span<const std::uint8_t> data) -> void {
+            m_boot_images.emplace_back(address, data);
+        }
+
+        auto set_device_tree_address(T address) -> void {
+            m_device_tree_address = address;
+        }
+
+        // Lets all harts perform misaligned loads and stores themselves instead of trapping to the guest
+        auto set_native_misaligned_access(bool enabled) -> void {
+            for (auto &core : m_cores) {
+                core.set_native_misaligned_access(enabled);
+            }
+        }
+
+        auto attach_input_log(InputLog *input_log) -> void {
+            m_input_log = input_log;
+        }
+
+        // Number of steps executed since the machine was powered up
+        [[nodiscard]] auto ticks() const -> std::uint64_t {
+            return m_ticks;
+        }
+
+        [[nodiscard]] auto is_powered_up() const -> bool {
+            return !m_in_reset;
+        }
+
+        [[nodiscard]] auto shutdown_reason() const -> std::optional<m_mode::ResetReason> {
+            return m_shutdown_reason;
+        }
+
+    private:
+        auto load_boot_images() -> void {
+            for (const auto &image : m_boot_images) {
+                m_address_space.write_physical(image.address, image.data);
+            }
+
+            // Boot hart gets the device tree address passed in a1, a0 already contains its hart id
+            m_cores[0].a1() = m_device_tree_address;
+        }
+
+        struct BootImage {
+            T address;
+            std::span<const std::uint8_t> data;
+        };
+
     private:
         bool m_in_reset = true;
-        m_mode::MachineModeFirmware<m_mode::MachineModeFirmwareExtensions> m_machine_mode_firmware;
+        std::optional<m_mode::ResetReason> m_shutdown_reason;
+
+        std::vector<BootImage> m_boot_images;
+        T m_device_tree_address = 0x00;
+
+        InputLog *m_input_log = nullptr;
+        std::uint64_t m_ticks = 0;
+        m_mode::MachineModeFirmware<m_mode::MachineModeFirmwareExtensions<T>, T> m_machine_mode_firmware;
 
-        AddressSpace<std::uint32_t> m_address_space;
+        AddressSpace<T> m_address_space;
         std::array<Core, NumCores> m_cores;
         std::size_t m_current_core = 0;
     };
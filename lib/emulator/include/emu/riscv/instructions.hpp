@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+
 #include <emu/utils.hpp>
 
 namespace ds::emu::riscv::instr {
@@ -159,6 +162,61 @@ namespace ds::emu::riscv::instr {
         using OP_32     = Opcode<type::R,  0b01'110>;
     }
 
+    // RVC instructions. They're expanded into their 32 bit equivalents instead of being executed directly
+    namespace compressed {
+
+        template<std::uint8_t QuadrantBits>
+        struct Quadrant {
+            constexpr static auto Value = QuadrantBits;
+            using Type = std::uint32_t;
+        };
+
+        using C0 = Quadrant<0b00>;
+        using C1 = Quadrant<0b01>;
+        using C2 = Quadrant<0b10>;
+
+        // 32 bit equivalent of every possible compressed instruction, 0 for illegal and reserved encodings.
+        // Some encodings mean different instructions on RV32 and RV64, so each has its own table
+        extern const std::array<std::uint32_t, 1 << 16> ExpansionTable32;
+        extern const std::array<std::uint32_t, 1 << 16> ExpansionTable64;
+
+        template<std::uint32_t XLen>
+        inline auto expand(std::uint16_t instruction) -> std::uint32_t {
+            if constexpr (XLen == 64)
+                return ExpansionTable64[instruction];
+            else
+                return ExpansionTable32[instruction];
+        }
+
+    }
+
+    constexpr static auto get_opcode_name(std::uint8_t opcode) -> const char* {
+        switch (opcode) {
+            case base::LOAD::Value:         return "LOAD";
+            case base::STORE::Value:        return "STORE";
+            case base::MADD::Value:         return "MADD";
+            case base::BRANCH::Value:       return "BRANCH";
+            case base::LOAD_FP::Value:      return "LOAD_FP";
+            case base::STORE_FP::Value:     return "STORE_FP";
+            case base::MSUB::Value:         return "MSUB";
+            case base::JALR::Value:         return "JALR";
+            case base::NMSUB::Value:        return "NMSUB";
+            case base::MISC_MEM::Value:     return "MISC_MEM";
+            case base::AMO::Value:          return "AMO";
+            case base::NMADD::Value:        return "NMADD";
+            case base::JAL::Value:          return "JAL";
+            case base::OP_IMM::Value:       return "OP_IMM";
+            case base::OP::Value:           return "OP";
+            case base::OP_FP::Value:        return "OP_FP";
+            case base::SYSTEM::Value:       return "SYSTEM";
+            case base::AUIPC::Value:        return "AUIPC";
+            case base::LUI::Value:          return "LUI";
+            case base::OP_IMM_32::Value:    return "OP_IMM_32";
+            case base::OP_32::Value:        return "OP_32";
+            default:                        return "";
+        }
+    }
+
 
 
 }
\ No newline at end of file
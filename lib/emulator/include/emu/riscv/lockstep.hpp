@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <expected>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <emu/address_space.hpp>
+#include <emu/state.hpp>
+#include <emu/devices/ram.hpp>
+#include <emu/riscv/emulator.hpp>
+
+namespace ds::emu::riscv {
+
+    // Runs two execution engines side by side on identical copies of the same machine and compares their
+    // architectural state after every step: pc, privilege level, integer and FP registers, CSRs and every write to the address space.
+    // Meant to gain confidence in an optimized engine by checking it against the reference interpreter
+    template<std::size_t NumCores>
+    class Lockstep {
+    public:
+        // Advances the given emulator by one step
+        using Engine = std::function<std::expected<void, ExceptionCause>(Emulator<NumCores> &emulator)>;
+
+        struct Machine {
+            Emulator<NumCores> &emulator;
+            dev::Ram &ram;
+            Engine engine;
+        };
+
+        // Number of differences listed in a divergence before only counting them
+        constexpr static std::size_t MaxReportedDifferences = 32;
+
+        struct Divergence {
+            std::uint64_t tick;
+            std::uint16_t hart;
+            std::uint32_t pc;                           // Address of the instruction both engines started executing
+            PrivilegeLevel privilege_level;
+            std::vector<std::string> differences;       // Reference value first, then the candidate's
+            std::size_t difference_count;
+
+            auto write(std::FILE *file) const -> void {
+                std::fprintf(file, "Engines diverged at tick %llu on hart %u, pc 0x%08X, privilege level %d:\n",
+                    static_cast<unsigned long long>(tick), hart, pc, int(std::to_underlying(privilege_level)));
+                for (const auto &difference : differences) {
+                    std::fprintf(file, "  %s\n", difference.c_str());
+                }
+                if (difference_count > differences.size())
+                    std::fprintf(file, "  ... and %zu more\n", difference_count - differences.size());
+            }
+        };
+
+        Lockstep(Machine reference, Machine candidate)
+            : m_reference(std::move(reference)), m_candidate(std::move(candidate)),
+              m_reference_writes(m_reference.emulator.address_space()), m_candidate_writes(m_candidate.emulator.address_space()) { }
+
+        Lockstep(const Lockstep &) = delete;
+        Lockstep &operator=(const Lockstep &) = delete;
+
+        // Copies the whole state of the reference machine, including RAM, over to the candidate.
+        // Both machines need to have the same peripherals mapped and the same amount of RAM
+        auto synchronize() -> void {
+            std::vector<std::uint8_t> state;
+            StateWriter writer(state);
+            m_reference.emulator.save_state(writer);
+
+            StateReader reader(state);
+            m_candidate.emulator.load_state(reader);
+
+            m_candidate.ram.write(0, m_reference.ram.data());
+        }
+
+        // Steps both engines once. Returns everything that differs afterwards, the machines are left in their diverged state
+        auto step() -> std::optional<Divergence> {
+            auto &core = m_reference.emulator.current_core();
+            Divergence divergence = { m_reference.emulator.ticks(), core.hart_id(), core.pc(), core.privilege_level(), {}, 0 };
+
+            m_reference_writes.clear();
+            m_candidate_writes.clear();
+
+            const auto reference_result = m_reference.engine(m_reference.emulator);
+            const auto candidate_result = m_candidate.engine(m_candidate.emulator);
+
+            const auto report = [&divergence](const char *what, std::uint64_t reference_value, std::uint64_t candidate_value) {
+                if (reference_value == candidate_value) [[likely]]
+                    return;
+
+                divergence.difference_count += 1;
+                if (divergence.differences.size() < MaxReportedDifferences) {
+                    char buffer[128];
+                    std::snprintf(buffer, sizeof(buffer), "%s: 0x%08llX != 0x%08llX", what,
+                        static_cast<unsigned long long>(reference_value), static_cast<unsigned long long>(candidate_value));
+                    divergence.differences.emplace_back(buffer);
+                }
+            };
+
+            report("step result", reference_result.has_value() ? UINT64_MAX : std::to_underlying(reference_result.error()),
+                                  candidate_result.has_value() ? UINT64_MAX : std::to_underlying(candidate_result.error()));
+            report("ticks", m_reference.emulator.ticks(), m_candidate.emulator.ticks());
+            report("powered up", m_reference.emulator.is_powered_up(), m_candidate.emulator.is_powered_up());
+
+            for (std::size_t hart = 0; hart < NumCores; hart += 1) {
+                compare_core(hart, m_reference.emulator.cores()[hart], m_candidate.emulator.cores()[hart], report);
+            }
+
+            compare_writes(report);
+
+            if (divergence.difference_count == 0) [[likely]]
+                return std::nullopt;
+
+            return divergence;
+        }
+
+    private:
+        struct MemoryWrite {
+            std::uint32_t address;
+            std::uint32_t size;
+            std::array<std::uint8_t, 8> data;
+
+            auto operator==(const MemoryWrite &other) const -> bool = default;
+        };
+
+        // Collects every write done to the address space during a single step
+        class WriteRecorder : public AccessTracer<std::uint32_t> {
+        public:
+            explicit WriteRecorder(AddressSpace<std::uint32_t> &address_space) : m_address_space(address_space) {
+                for (const auto &entry : m_address_space.peripherals()) {
+                    entry.traced = true;
+                }
+                m_address_space.set_access_tracer(this);
+            }
+
+            ~WriteRecorder() override {
+                m_address_space.set_access_tracer(nullptr);
+                for (const auto &entry : m_address_space.peripherals()) {
+                    entry.traced = false;
+                }
+            }
+
+            WriteRecorder(const WriteRecorder &) = delete;
+            WriteRecorder &operator=(const WriteRecorder &) = delete;
+
+            auto trace(std::uint32_t address, std::span<const std::uint8_t> data, AccessType access_type) -> void override {
+                if (access_type != AccessType::Store)
+                    return;
+
+                // Larger writes only happen outside of instructions, e.g. when loading boot images
+                for (std::size_t offset = 0; offset < data.size(); offset += sizeof(MemoryWrite::data)) {
+                    auto &write = m_writes.emplace_back(std::uint32_t(address + offset), std::uint32_t(std::min(data.size() - offset, sizeof(MemoryWrite::data))));
+                    std::ranges::copy(data.subspan(offset, write.size), write.data.begin());
+                }
+            }
+
+            auto clear() -> void {
+                m_writes.clear();
+            }
+
+            [[nodiscard]] auto writes() const -> std::span<const MemoryWrite> {
+                return m_writes;
+            }
+
+        private:
+            AddressSpace<std::uint32_t> &m_address_space;
+            std::vector<MemoryWrite> m_writes;
+        };
+
+        static auto compare_core(std::size_t hart, Core &reference, Core &candidate, const auto &report) -> void {
+            char name[32];
+
+            std::snprintf(name, sizeof(name), "hart %zu pc", hart);
+            report(name, reference.pc().get(), candidate.pc().get());
+            std::snprintf(name, sizeof(name), "hart %zu privilege level", hart);
+            report(name, std::to_underlying(reference.privilege_level()), std::to_underlying(candidate.privilege_level()));
+
+            for (std::uint8_t i = 1; i < 32; i += 1) {
+                if (reference.x(i).get() != candidate.x(i).get()) [[unlikely]] {
+                    std::snprintf(name, sizeof(name), "hart %zu x%u", hart, i);
+                    report(name, reference.x(i).get(), candidate.x(i).get());
+                }
+            }
+
+            // Raw bits, so differences in NaN-boxing or NaN payloads show up as well
+            for (std::uint8_t i = 0; i < 32; i += 1) {
+                if (reference.f(i) != candidate.f(i)) [[unlikely]] {
+                    std::snprintf(name, sizeof(name), "hart %zu f%u", hart, i);
+                    report(name, reference.f(i), candidate.f(i));
+                }
+            }
+
+            const auto reference_csrs = reference.csrs();
+            const auto candidate_csrs = candidate.csrs();
+            for (std::size_t i = 0; i < reference_csrs.size(); i += 1) {
+                if (reference_csrs[i] != candidate_csrs[i]) [[unlikely]] {
+                    std::snprintf(name, sizeof(name), "hart %zu csr 0x%03zX", hart, i);
+                    report(name, reference_csrs[i], candidate_csrs[i]);
+                }
+            }
+        }
+
+        auto compare_writes(const auto &report) -> void {
+            const auto reference_writes = m_reference_writes.writes();
+            const auto candidate_writes = m_candidate_writes.writes();
+
+            report("number of memory writes", reference_writes.size(), candidate_writes.size());
+            for (std::size_t i = 0; i < std::min(reference_writes.size(), candidate_writes.size()); i += 1) {
+                const auto &reference_write = reference_writes[i];
+                const auto &candidate_write = candidate_writes[i];
+                if (reference_write == candidate_write) [[likely]]
+                    continue;
+
+                char name[48];
+                std::snprintf(name, sizeof(name), "write %zu address", i);
+                report(name, reference_write.address, candidate_write.address);
+                std::snprintf(name, sizeof(name), "write %zu size", i);
+                report(name, reference_write.size, candidate_write.size);
+
+                std::uint64_t reference_value = 0, candidate_value = 0;
+                std::copy_n(reference_write.data.begin(), reference_write.size, util::to_byte_span(reference_value).begin());
+                std::copy_n(candidate_write.data.begin(), candidate_write.size, util::to_byte_span(candidate_value).begin());
+                std::snprintf(name, sizeof(name), "write %zu to 0x%08X value", i, reference_write.address);
+                report(name, reference_value, candidate_value);
+            }
+        }
+
+    private:
+        Machine m_reference, m_candidate;
+        WriteRecorder m_reference_writes, m_candidate_writes;
+    };
+
+}
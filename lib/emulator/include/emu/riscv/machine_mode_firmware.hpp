@@ -3,7 +3,10 @@
 #include <cstdint>
 #include <cstring>
 #include <bit>
+#include <optional>
+#include <tuple>
 #include <emu/riscv/core.hpp>
+#include <emu/state.hpp>
 
 namespace ds::emu::riscv::m_mode {
 
@@ -43,33 +46,52 @@ namespace ds::emu::riscv::m_mode {
         NoSharedMemory = -9,
     };
 
+    // Return values are register sized. Extensions that aren't specific to the register width return 32 bit values,
+    // those get zero extended on RV64
+    template<typename T = std::uint32_t>
     struct SBICallResult {
         SBICallErrorCode error;
-        std::uint32_t return_value;
+        T return_value;
     };
 
-    template<typename Extensions>
+    // 64 bit SBI arguments are split across two registers on RV32 but fit into a single one on RV64
+    template<typename T>
+    constexpr auto combine_arguments(T low, T high) -> std::uint64_t {
+        if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+            std::ignore = high;
+            return low;
+        } else {
+            return (static_cast<std::uint64_t>(high) << 32) | low;
+        }
+    }
+
+    template<typename Extensions, typename T = std::uint32_t>
     class MachineModeFirmware {
     public:
+        using Core = BasicCore<T>;
+
         auto sbi_call(
             Core &core,
             std::uint32_t extension_id, std::uint32_t function_id,
-            std::uint32_t arg0, std::uint32_t arg1, std::uint32_t arg2, std::uint32_t arg3, std::uint32_t arg4, std::uint32_t arg5
-        ) -> SBICallResult {
+            T arg0, T arg1, T arg2, T arg3, T arg4, T arg5
+        ) -> SBICallResult<T> {
             const auto result = dispatch_call_to_extension(
                 core,
                 extension_id, function_id,
                 { arg0, arg1, arg2, arg3, arg4, arg5 }
             );
 
-            if (result.error == SBICallErrorCode::NotSupported) {
+            // Implemented functions may report that something isn't supported as well, only complain about missing ones
+            if (!result.has_value()) {
                 char extension_string[5] = {};
                 auto swapped = std::byteswap(extension_id);
                 std::memcpy(extension_string, &swapped, sizeof(swapped));
                 printf("Unimplemented SBI Extension Function Call to [0x%08X (%s)](0x%08X)\n", extension_id, extension_string, function_id);
+
+                return { SBICallErrorCode::NotSupported, 0 };
             }
 
-            return result;
+            return *result;
         }
 
         auto update(Core &core) -> void {
@@ -92,6 +114,30 @@ namespace ds::emu::riscv::m_mode {
             );
         }
 
+        auto save_state(StateWriter &writer) const -> void {
+            // Save the state of each extension that has any
+            std::apply(
+                [&](const auto& ...extensions) {
+                    (..., save_extension_state(writer, extensions));
+                },
+                m_extensions
+            );
+        }
+
+        auto load_state(StateReader &reader) -> void {
+            std::apply(
+                [&](auto& ...extensions) {
+                    (..., load_extension_state(reader, extensions));
+                },
+                m_extensions
+            );
+        }
+
+        template<typename Extension>
+        auto extension() -> Extension& {
+            return std::get<Extension>(m_extensions);
+        }
+
     private:
         constexpr static auto update_extension(Core& core, auto &extension) -> void {
             if constexpr (requires { extension.update(core); })
@@ -106,6 +152,18 @@ namespace ds::emu::riscv::m_mode {
             }
         }
 
+        static auto save_extension_state(StateWriter &writer, const auto &extension) -> void {
+            if constexpr (requires { extension.save_state(writer); }) {
+                extension.save_state(writer);
+            }
+        }
+
+        static auto load_extension_state(StateReader &reader, auto &extension) -> void {
+            if constexpr (requires { extension.load_state(reader); }) {
+                extension.load_state(reader);
+            }
+        }
+
         template<typename FunctionSignature>
         constexpr static auto takes_core_parameter() {
             if constexpr (FunctionSignature::ArgumentCount == 0) {
@@ -119,31 +177,34 @@ namespace ds::emu::riscv::m_mode {
         constexpr auto call_sbi_extension_function(
             Core &core,
             Extension &extension,
-            const std::array<std::uint32_t, 6> &args
-        ) -> SBICallResult {
+            const std::array<T, 6> &args
+        ) -> SBICallResult<T> {
             using Signature = util::FunctionSignature<decltype(Function)>;
 
             static_assert(
-                std::same_as<typename Signature::ReturnType, SBICallResult>,
+                std::same_as<typename Signature::ReturnType, SBICallResult<T>> || std::same_as<typename Signature::ReturnType, SBICallResult<>>,
                 "SBI Extension function must return a SBICallResult!"
             );
 
             constexpr auto N = Signature::ArgumentCount;
-            static_assert(N <= args.size(), "SBI Extension Function may not have more than 6 parameters!");
+            constexpr static bool TakesCoreParameter = takes_core_parameter<Signature>();
+            static_assert((TakesCoreParameter ? N - 1 : N) <= std::tuple_size_v<std::remove_cvref_t<decltype(args)>>, "SBI Extension Function may not have more than 6 parameters!");
 
             // Wrapper to uniformly call both a static and non-static member function
-            auto invoke_extension_function = [&]<typename... Ts>(Ts&&... params) -> SBICallResult {
+            auto invoke_extension_function = [&]<typename... Ts>(Ts&&... params) -> SBICallResult<T> {
                 constexpr static bool StaticMemberFunction = std::same_as<typename Signature::Class, void>;
 
+                typename Signature::ReturnType result;
                 if constexpr (StaticMemberFunction)
-                    return Function(std::forward<Ts>(params)...);
+                    result = Function(std::forward<Ts>(params)...);
                 else
-                    return (extension.*Function)(std::forward<Ts>(params)...);
+                    result = (extension.*Function)(std::forward<Ts>(params)...);
+
+                return { result.error, result.return_value };
             };
 
             // Invoke extension function, passing in the requested number of parameters
             // and optionally a reference to the calling core
-            constexpr static bool TakesCoreParameter = takes_core_parameter<Signature>();
             return [&]<std::size_t... I>(std::index_sequence<I...>) {
                 if constexpr (TakesCoreParameter)
                     return invoke_extension_function(core, args[I]...);
@@ -157,13 +218,13 @@ namespace ds::emu::riscv::m_mode {
             Core &core,
             Extension &extension,
             std::uint32_t function_id,
-            const std::array<std::uint32_t, 6> &args
-        ) -> SBICallResult {
+            const std::array<T, 6> &args
+        ) -> std::optional<SBICallResult<T>> {
             using Functions = Extension::Functions;
 
             if constexpr (Index >= std::tuple_size_v<Functions>) {
-                // No extension with the given ID was found in this extension
-                return { SBICallErrorCode::NotSupported, 0 };
+                // No function with the given ID was found in this extension
+                return std::nullopt;
             } else {
                 using Function = std::tuple_element_t<Index, Functions>;
 
@@ -190,11 +251,11 @@ namespace ds::emu::riscv::m_mode {
         constexpr auto dispatch_call_to_extension(
             Core &core,
             std::uint32_t extension_id, std::uint32_t function_id,
-            const std::array<std::uint32_t, 6> &args
-        ) -> SBICallResult {
+            const std::array<T, 6> &args
+        ) -> std::optional<SBICallResult<T>> {
             if constexpr (Index >= std::tuple_size_v<Extensions>) {
                 // No extension with the given ID was found
-                return { SBICallErrorCode::NotSupported, 0 };
+                return std::nullopt;
             } else {
                 using Extension = std::tuple_element_t<Index, Extensions>;
 
@@ -1,60 +1,65 @@
 #pragma once
 
 #include <chrono>
+#include <optional>
+#include <utility>
 #include <emu/riscv/machine_mode_firmware.hpp>
 
 namespace ds::emu::riscv::m_mode {
 
     struct ExtensionBase;
-    struct ExtensionTimer;
+    template<typename T> struct ExtensionTimer;
     struct ExtensionRst;
     struct ExtensionHsm;
     struct ExtensionIpi;
     struct ExtensionRFence;
+    template<typename T> struct ExtensionPmu;
 
+    template<typename T>
     using MachineModeFirmwareExtensions = std::tuple<
         ExtensionBase,
-        ExtensionTimer,
+        ExtensionTimer<T>,
         ExtensionRst,
         ExtensionHsm,
         ExtensionIpi,
-        ExtensionRFence
+        ExtensionRFence,
+        ExtensionPmu<T>
     >;
 
     struct ExtensionBase : Extension<0x0000'0010> {
-        constexpr static auto get_sbi_spec_version() -> SBICallResult {
+        constexpr static auto get_sbi_spec_version() -> SBICallResult<> {
             constexpr static auto SbiSpecVersion = (2 << 24) | 0;
             return { SBICallErrorCode::Success, SbiSpecVersion };
         }
 
-        constexpr static auto get_sbi_impl_id() -> SBICallResult {
+        constexpr static auto get_sbi_impl_id() -> SBICallResult<> {
             constexpr static auto SbiImplId = 0x999;
             return { SBICallErrorCode::Success, SbiImplId };
         }
 
-        constexpr static auto get_sbi_impl_version() -> SBICallResult {
+        constexpr static auto get_sbi_impl_version() -> SBICallResult<> {
             constexpr static auto SbiImplVersion = 1;
             return { SBICallErrorCode::Success, SbiImplVersion };
         }
 
-        constexpr static auto probe_extensions(std::uint32_t extension_id) -> SBICallResult {
+        constexpr static auto probe_extensions(std::uint32_t extension_id) -> SBICallResult<> {
             return {
                 SBICallErrorCode::Success,
-                extension_available<MachineModeFirmwareExtensions>(extension_id)
+                extension_available<MachineModeFirmwareExtensions<std::uint32_t>>(extension_id)
             };
         }
 
-        constexpr static auto get_mvendorid() -> SBICallResult {
+        constexpr static auto get_mvendorid() -> SBICallResult<> {
             constexpr static auto MVendorId = 0x12345678;
             return { SBICallErrorCode::Success, MVendorId };
         }
 
-        constexpr static auto get_marchid() -> SBICallResult {
+        constexpr static auto get_marchid() -> SBICallResult<> {
             constexpr static auto MArchId = (1ULL << 31) | 1;
             return { SBICallErrorCode::Success, MArchId };
         }
 
-        constexpr static auto get_mimpid() -> SBICallResult {
+        constexpr static auto get_mimpid() -> SBICallResult<> {
             constexpr static auto MImpid = 1;
             return { SBICallErrorCode::Success, MImpid };
         }
@@ -85,11 +90,14 @@ namespace ds::emu::riscv::m_mode {
         }
     };
 
+    template<typename T>
     struct ExtensionTimer : Extension<"TIME"> {
-        auto set_timer(Core &core, std::uint32_t low, std::uint32_t high) -> SBICallResult {
-            m_timer_compare_value[core.hart_id()] = (static_cast<std::uint64_t>(high) << 32) | low;
+        using Core = BasicCore<T>;
 
-            core.sip() &= ~util::bit<5>();
+        auto set_timer(Core &core, T low, T high) -> SBICallResult<T> {
+            get_timer_compare_value(core) = combine_arguments(low, high);
+
+            core.set_interrupt_pending(5, false);  // STIP
 
             return { SBICallErrorCode::Success, 0 };
         }
@@ -98,13 +106,15 @@ namespace ds::emu::riscv::m_mode {
             constexpr static auto CycleTime = (1'000'000'000 / 65'000'000) / 2;
             m_timer_value = m_cycle_counter * CycleTime;
 
-            core.time()   = m_timer_value & util::mask<32>();
-            core.timeh()  = m_timer_value >> 32;
-            core.cycle()  = m_cycle_counter & util::mask<32>();
-            core.cycleh() = m_cycle_counter >> 32;
+            if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+                core.time()   = m_timer_value;
+            } else {
+                core.time()   = m_timer_value & util::mask<32>();
+                core.timeh()  = m_timer_value >> 32;
+            }
 
             if (m_timer_value >= get_timer_compare_value(core)) [[unlikely]] {
-                core.sip() |= util::bit<5>();
+                core.set_interrupt_pending(5, true);   // STIP
             }
 
             if (core.hart_id() == 0) {
@@ -116,6 +126,26 @@ namespace ds::emu::riscv::m_mode {
             m_timer_compare_value.clear();
         }
 
+        auto save_state(StateWriter &writer) const -> void {
+            writer.write(m_timer_value);
+            writer.write(m_cycle_counter);
+
+            writer.write(m_timer_compare_value.size());
+            for (const auto value : m_timer_compare_value) {
+                writer.write(value);
+            }
+        }
+
+        auto load_state(StateReader &reader) -> void {
+            m_timer_value   = reader.read<std::uint64_t>();
+            m_cycle_counter = reader.read<std::uint64_t>();
+
+            m_timer_compare_value.resize(reader.read<std::size_t>());
+            for (auto &value : m_timer_compare_value) {
+                value = reader.read<std::uint64_t>();
+            }
+        }
+
         using Functions = std::tuple<
             Function<0, &ExtensionTimer::set_timer>
         >;
@@ -131,12 +161,55 @@ namespace ds::emu::riscv::m_mode {
 
     private:
         std::uint64_t m_timer_value = 0x00;
-        std::uint64_t m_cycle_counter = 0x00;
+        std::uint64_t m_cycle_counter = 0x00;           // Timebase, advances with every step of hart 0
         std::vector<std::uint64_t> m_timer_compare_value;
     };
 
+    enum class ResetType : std::uint32_t {
+        Shutdown    = 0x0000'0000,
+        ColdReboot  = 0x0000'0001,
+        WarmReboot  = 0x0000'0002
+    };
+
+    enum class ResetReason : std::uint32_t {
+        NoReason        = 0x0000'0000,
+        SystemFailure   = 0x0000'0001
+    };
+
+    struct ResetRequest {
+        ResetType type;
+        ResetReason reason;
+    };
+
     struct ExtensionRst : Extension<"SRST"> {
-        using Functions = std::tuple<>;
+        auto system_reset(std::uint32_t reset_type, std::uint32_t reset_reason) -> SBICallResult<> {
+            // 0x0000'0003 - 0xEFFF'FFFF are reserved, 0xF000'0000 - 0xFFFF'FFFF are vendor specific
+            if (reset_type >= 0xF000'0000)
+                return { SBICallErrorCode::NotSupported, 0 };
+            if (reset_type > std::to_underlying(ResetType::WarmReboot))
+                return { SBICallErrorCode::InvalidParam, 0 };
+            if (reset_reason > std::to_underlying(ResetReason::SystemFailure) && reset_reason < 0xF000'0000)
+                return { SBICallErrorCode::InvalidParam, 0 };
+
+            m_pending_request = ResetRequest { static_cast<ResetType>(reset_type), static_cast<ResetReason>(reset_reason) };
+
+            return { SBICallErrorCode::Success, 0 };
+        }
+
+        [[nodiscard]] auto pending_request() -> std::optional<ResetRequest> {
+            return std::exchange(m_pending_request, std::nullopt);
+        }
+
+        auto reset() -> void {
+            m_pending_request.reset();
+        }
+
+        using Functions = std::tuple<
+            Function<0, &ExtensionRst::system_reset>
+        >;
+
+    private:
+        std::optional<ResetRequest> m_pending_request;
     };
 
     struct ExtensionHsm : Extension<"\x00HSM"> {
@@ -151,4 +224,206 @@ namespace ds::emu::riscv::m_mode {
         using Functions = std::tuple<>;
     };
 
-}
\ No newline at end of file
+    // Gives the kernel control over the performance counters, which is what perf inside the guest builds upon.
+    // All counters are fixed function hardware counters, so matching an event just means finding the counter that counts it
+    template<typename T>
+    struct ExtensionPmu : Extension<"\x00PMU"> {
+        using Core = BasicCore<T>;
+
+        constexpr static std::uint32_t ConfigSkipMatch    = 1 << 0;
+        constexpr static std::uint32_t ConfigClearValue   = 1 << 1;
+        constexpr static std::uint32_t ConfigAutoStart    = 1 << 2;
+        constexpr static std::uint32_t StartSetInitValue  = 1 << 0;
+        constexpr static std::uint32_t StopReset          = 1 << 0;
+
+        constexpr static auto num_counters() -> SBICallResult<T> {
+            return { SBICallErrorCode::Success, CounterCount };
+        }
+
+        constexpr static auto counter_get_info(std::uint32_t counter_index) -> SBICallResult<T> {
+            // The time CSR isn't a performance counter, the kernel must not configure, start or stop it
+            if (counter_index >= CounterCount || counter_index == std::to_underlying(Counter::Time))
+                return { SBICallErrorCode::InvalidParam, 0 };
+
+            // Hardware counter, 64 bits wide, read through the CSR of the same number
+            constexpr std::uint32_t Width = 64;
+            return { SBICallErrorCode::Success, ((Width - 1) << 12) | (0xC00 + counter_index) };
+        }
+
+        auto counter_config_matching(Core &core, std::uint32_t counter_index_base, std::uint32_t counter_index_mask, std::uint32_t config_flags,
+                                     std::uint32_t event_index, std::uint32_t event_data_low, std::uint32_t event_data_high) -> SBICallResult<T> {
+            std::ignore = event_data_high;
+
+            const auto event_counter = get_event_counter(event_index, event_data_low);
+            if (!event_counter.has_value())
+                return { SBICallErrorCode::NotSupported, 0 };
+
+            auto &in_use = get_counters_in_use(core);
+            std::optional<std::uint32_t> counter_index;
+            if (config_flags & ConfigSkipMatch) {
+                if (counter_index_mask != 0)
+                    counter_index = counter_index_base + std::countr_zero(counter_index_mask);
+            } else {
+                for (auto mask = counter_index_mask; mask != 0; mask &= mask - 1) {
+                    const auto index = counter_index_base + std::countr_zero(mask);
+                    if (index == std::to_underlying(*event_counter) && (in_use & (1U << index)) == 0) {
+                        counter_index = index;
+                        break;
+                    }
+                }
+            }
+
+            if (!counter_index.has_value() || *counter_index != std::to_underlying(*event_counter))
+                return { SBICallErrorCode::NotSupported, 0 };
+
+            const auto counter = Counter(*counter_index);
+            in_use |= 1U << *counter_index;
+            if (config_flags & ConfigClearValue)
+                core.set_counter(counter, 0);
+            if (config_flags & ConfigAutoStart)
+                core.start_counter(counter);
+
+            return { SBICallErrorCode::Success, *counter_index };
+        }
+
+        auto counter_start(Core &core, std::uint32_t counter_index_base, std::uint32_t counter_index_mask, std::uint32_t start_flags,
+                           T initial_value_low, T initial_value_high) -> SBICallResult<T> {
+            if (!valid_counters(get_counters_in_use(core), counter_index_base, counter_index_mask))
+                return { SBICallErrorCode::InvalidParam, 0 };
+
+            auto result = SBICallErrorCode::Success;
+            for (auto mask = counter_index_mask; mask != 0; mask &= mask - 1) {
+                const auto counter = Counter(counter_index_base + std::countr_zero(mask));
+                if (core.is_counter_running(counter)) {
+                    result = SBICallErrorCode::AlreadyStarted;
+                    continue;
+                }
+
+                if (start_flags & StartSetInitValue)
+                    core.set_counter(counter, combine_arguments(initial_value_low, initial_value_high));
+                core.start_counter(counter);
+            }
+
+            return { result, 0 };
+        }
+
+        auto counter_stop(Core &core, std::uint32_t counter_index_base, std::uint32_t counter_index_mask, std::uint32_t stop_flags) -> SBICallResult<T> {
+            auto &in_use = get_counters_in_use(core);
+            if (!valid_counters(in_use, counter_index_base, counter_index_mask))
+                return { SBICallErrorCode::InvalidParam, 0 };
+
+            auto result = SBICallErrorCode::Success;
+            for (auto mask = counter_index_mask; mask != 0; mask &= mask - 1) {
+                const auto index = counter_index_base + std::countr_zero(mask);
+                if (stop_flags & StopReset)
+                    in_use &= ~(1U << index);
+
+                if (!core.is_counter_running(Counter(index))) {
+                    result = SBICallErrorCode::AlreadyStopped;
+                    continue;
+                }
+
+                core.stop_counter(Counter(index));
+            }
+
+            return { result, 0 };
+        }
+
+        // There are no firmware counters
+        constexpr static auto counter_fw_read(std::uint32_t counter_index) -> SBICallResult<T> {
+            std::ignore = counter_index;
+            return { SBICallErrorCode::InvalidParam, 0 };
+        }
+
+        constexpr static auto counter_fw_read_hi(std::uint32_t counter_index) -> SBICallResult<T> {
+            std::ignore = counter_index;
+            return { SBICallErrorCode::InvalidParam, 0 };
+        }
+
+        constexpr static auto snapshot_set_shmem() -> SBICallResult<T> {
+            return { SBICallErrorCode::NotSupported, 0 };
+        }
+
+        auto reset() -> void {
+            m_counters_in_use.clear();
+        }
+
+        auto save_state(StateWriter &writer) const -> void {
+            writer.write(m_counters_in_use.size());
+            for (const auto counters : m_counters_in_use) {
+                writer.write(counters);
+            }
+        }
+
+        auto load_state(StateReader &reader) -> void {
+            m_counters_in_use.resize(reader.read<std::size_t>());
+            for (auto &counters : m_counters_in_use) {
+                counters = reader.read<std::uint32_t>();
+            }
+        }
+
+        using Functions = std::tuple<
+            Function<0, &ExtensionPmu::num_counters>,
+            Function<1, &ExtensionPmu::counter_get_info>,
+            Function<2, &ExtensionPmu::counter_config_matching>,
+            Function<3, &ExtensionPmu::counter_start>,
+            Function<4, &ExtensionPmu::counter_stop>,
+            Function<5, &ExtensionPmu::counter_fw_read>,
+            Function<6, &ExtensionPmu::counter_fw_read_hi>,
+            Function<7, &ExtensionPmu::snapshot_set_shmem>
+        >;
+
+    private:
+        // Maps an SBI event to the counter counting it. Raw events use the number of their counter as event data
+        constexpr static auto get_event_counter(std::uint32_t event_index, std::uint32_t event_data) -> std::optional<Counter> {
+            constexpr std::uint32_t HardwareGeneral = 0, HardwareCache = 1, HardwareRaw = 2;
+            constexpr std::uint32_t CpuCycles = 1, Instructions = 2;
+            constexpr std::uint32_t DataTlb = 3, InstructionTlb = 4, ResultMiss = 1;
+
+            const auto type = util::extract_bits<16, 19>(event_index);
+            const auto code = util::extract_bits<0, 15>(event_index);
+            switch (type) {
+                case HardwareGeneral:
+                    if (code == CpuCycles)      return Counter::Cycle;
+                    if (code == Instructions)   return Counter::InstructionsRetired;
+                    return std::nullopt;
+                case HardwareCache: {
+                    // There's a single TLB for instructions and data
+                    const auto cache = code >> 3;
+                    const auto result = code & 1;
+                    if ((cache == DataTlb || cache == InstructionTlb) && result == ResultMiss)
+                        return Counter::TlbMisses;
+                    return std::nullopt;
+                }
+                case HardwareRaw:
+                    if (event_data >= std::to_underlying(Counter::TlbMisses) && event_data < CounterCount)
+                        return Counter(event_data);
+                    return std::nullopt;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        // Like OpenSBI, only counters configured through counter_config_matching can be started or stopped.
+        // Otherwise the kernel stopping all counters at boot would freeze cycle, instret and the time CSR its clocksource reads
+        constexpr static auto valid_counters(std::uint32_t in_use, std::uint32_t counter_index_base, std::uint32_t counter_index_mask) -> bool {
+            if (counter_index_mask == 0 || counter_index_base + (32 - std::countl_zero(counter_index_mask)) > CounterCount)
+                return false;
+
+            const auto counters = counter_index_mask << counter_index_base;
+            return (counters & ~in_use) == 0 && (counters & (1U << std::to_underlying(Counter::Time))) == 0;
+        }
+
+        constexpr auto get_counters_in_use(Core &core) -> std::uint32_t& {
+            const auto hart = core.hart_id();
+            if (m_counters_in_use.size() <= hart) [[unlikely]]
+                m_counters_in_use.resize(hart + 1);
+
+            return m_counters_in_use[hart];
+        }
+
+    private:
+        std::vector<std::uint32_t> m_counters_in_use;       // Counters configured by the kernel, per hart
+    };
+
+}
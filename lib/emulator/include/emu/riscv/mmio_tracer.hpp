@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <emu/address_space.hpp>
+#include <emu/mmio_trace.hpp>
+#include <emu/ring_buffer.hpp>
+#include <emu/riscv/emulator.hpp>
+
+namespace ds::emu::riscv {
+
+    // Records every access to the traced regions of the emulator's address space into a binary trace file.
+    // Records are queued up in a ring buffer per hart and written to disk by a background thread,
+    // so tracing never blocks the emulator. If the writer can't keep up, records are dropped and counted
+    template<std::size_t NumCores>
+    class MmioTracer : public AccessTracer<std::uint32_t> {
+    public:
+        constexpr static std::size_t DefaultBufferCapacity = 64 * 1024;
+
+        explicit MmioTracer(Emulator<NumCores> &emulator, std::size_t buffer_capacity = DefaultBufferCapacity) : m_emulator(emulator) {
+            for (auto &buffer : m_buffers) {
+                buffer = std::make_unique<RingBuffer<MmioTraceRecord>>(buffer_capacity);
+            }
+        }
+
+        MmioTracer(const MmioTracer &) = delete;
+        MmioTracer &operator=(const MmioTracer &) = delete;
+
+        ~MmioTracer() override {
+            stop();
+        }
+
+        auto start(const std::string &path) -> bool {
+            stop();
+
+            m_file = std::fopen(path.c_str(), "wb");
+            if (m_file == nullptr)
+                return false;
+
+            std::fwrite(MmioTraceFileMagic.data(), 1, MmioTraceFileMagic.size(), m_file);
+            std::fputc(MmioTraceFileVersion, m_file);
+
+            m_dropped_records = 0;
+            m_writer_thread = std::jthread([this](const std::stop_token &stop_token) {
+                write_records(stop_token);
+            });
+            m_emulator.address_space().set_access_tracer(this);
+
+            return true;
+        }
+
+        auto stop() -> void {
+            if (m_file == nullptr)
+                return;
+
+            m_emulator.address_space().set_access_tracer(nullptr);
+
+            m_writer_thread.request_stop();
+            m_writer_thread.join();
+
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+
+        // Traces all peripherals except for the ones in the given list, usually RAM
+        auto trace_all_peripherals_except(std::span<const MemoryMappedPeripheral<std::uint32_t>* const> excluded) -> void {
+            for (const auto &entry : m_emulator.address_space().peripherals()) {
+                entry.traced = std::ranges::find(excluded, entry.peripheral) == excluded.end();
+            }
+        }
+
+        [[nodiscard]] auto dropped_records() const -> std::uint64_t {
+            return m_dropped_records.load(std::memory_order_relaxed);
+        }
+
+        auto trace(std::uint32_t address, std::span<const std::uint8_t> data, AccessType access_type) -> void final {
+            auto &core = m_emulator.current_core();
+
+            MmioTraceRecord record = {};
+            record.tick      = m_emulator.ticks() - 1;
+            record.pc        = core.pc();
+            record.hart      = core.hart_id();
+            record.direction = access_type == AccessType::Store ? MmioDirection::Write : MmioDirection::Read;
+
+            // Cache block operations write a whole block at once, which is logged as a single fill if all its bytes are equal
+            if (data.size() > sizeof(record.value) && access_type == AccessType::Store) [[unlikely]] {
+                if (data.size() <= std::numeric_limits<decltype(record.size)>::max() && std::ranges::all_of(data, [&](std::uint8_t byte) { return byte == data[0]; })) {
+                    record.address   = address;
+                    record.size      = std::uint8_t(data.size());
+                    record.direction = MmioDirection::Fill;
+                    record.value     = data[0];
+                    push(record);
+
+                    return;
+                }
+            }
+
+            // Anything else larger than a record's value gets split up into multiple accesses
+            for (std::size_t offset = 0; offset < data.size(); offset += sizeof(record.value)) {
+                const auto chunk = data.subspan(offset, std::min(data.size() - offset, sizeof(record.value)));
+
+                record.address = address + std::uint32_t(offset);
+                record.size    = std::uint8_t(chunk.size());
+                record.value   = 0;
+                std::memcpy(&record.value, chunk.data(), chunk.size());
+                push(record);
+            }
+        }
+
+    private:
+        auto push(const MmioTraceRecord &record) -> void {
+            if (!m_buffers[record.hart % NumCores]->push(record)) [[unlikely]]
+                m_dropped_records.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto write_records(const std::stop_token &stop_token) -> void {
+            constexpr static auto IdleInterval = std::chrono::milliseconds(1);
+
+            std::vector<MmioTraceRecord> records(4096);
+            const auto drain = [&] {
+                std::size_t total = 0;
+                for (auto &buffer : m_buffers) {
+                    while (const auto count = buffer->pop(records)) {
+                        std::fwrite(records.data(), sizeof(MmioTraceRecord), count, m_file);
+                        total += count;
+                    }
+                }
+
+                return total;
+            };
+
+            while (!stop_token.stop_requested()) {
+                if (drain() == 0)
+                    std::this_thread::sleep_for(IdleInterval);
+            }
+
+            // Write out whatever got queued up before tracing was stopped
+            drain();
+            std::fflush(m_file);
+        }
+
+    private:
+        Emulator<NumCores> &m_emulator;
+
+        std::array<std::unique_ptr<RingBuffer<MmioTraceRecord>>, NumCores> m_buffers;
+        std::atomic<std::uint64_t> m_dropped_records = 0;
+
+        std::FILE *m_file = nullptr;
+        std::jthread m_writer_thread;
+    };
+
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <emu/symbol_table.hpp>
+#include <emu/utils.hpp>
+#include <emu/devices/ram.hpp>
+#include <emu/riscv/emulator.hpp>
+
+namespace ds::emu::riscv {
+
+    // Statistical profiler that periodically samples where the guest is executing.
+    // Samples are taken either every N steps, which is deterministic, or whenever a host timer fires.
+    // Each sample records the PC and privilege level and walks the frame pointer chain to collect the call stack,
+    // which requires the guest kernel to be built with frame pointers for anything deeper than the current function
+    template<std::size_t NumCores>
+    class Profiler {
+    public:
+        constexpr static std::size_t MaxStackDepth = 64;
+        constexpr static std::uint64_t TimerCheckInterval = 256;
+
+        Profiler(Emulator<NumCores> &emulator, dev::Ram &ram) : m_emulator(emulator), m_ram(ram) { }
+
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+
+        // Takes a sample every `interval` steps
+        auto start(std::uint64_t interval) -> void {
+            stop();
+
+            m_interval = std::max<std::uint64_t>(interval, 1);
+            m_steps_until_sample = m_interval;
+        }
+
+        // Takes a sample whenever the given amount of wall time has passed
+        auto start(std::chrono::microseconds period) -> void {
+            stop();
+
+            // Looking at the timer every step would be needlessly expensive, a few hundred instructions later is just as good
+            m_interval = TimerCheckInterval;
+            m_steps_until_sample = m_interval;
+            m_timer_thread = std::jthread([this, period](const std::stop_token &stop_token) {
+                while (!stop_token.stop_requested()) {
+                    std::this_thread::sleep_for(period);
+                    m_sample_requested.store(true, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        auto stop() -> void {
+            m_interval = 0;
+            if (m_timer_thread.joinable()) {
+                m_timer_thread.request_stop();
+                m_timer_thread.join();
+            }
+        }
+
+        // Needs to be called after every step of the emulator
+        auto step() -> void {
+            if (m_interval == 0 || --m_steps_until_sample != 0) [[likely]]
+                return;
+
+            m_steps_until_sample = m_interval;
+            if (m_timer_thread.joinable()) {
+                // Only do the more expensive exchange once the timer actually fired
+                if (!m_sample_requested.load(std::memory_order_relaxed) || !m_sample_requested.exchange(false, std::memory_order_relaxed))
+                    return;
+            }
+
+            for (auto &core : m_emulator.cores()) {
+                sample(core);
+            }
+        }
+
+        [[nodiscard]] auto sample_count() const -> std::uint64_t {
+            return m_sample_count;
+        }
+
+        // Writes the number of samples per function, most frequently hit first
+        auto write_flat_profile(std::FILE *file, const SymbolTable &symbols) const -> void {
+            std::map<std::pair<PrivilegeLevel, std::string>, std::uint64_t> functions;
+            for (const auto &[key, count] : m_pc_histogram) {
+                const auto privilege = PrivilegeLevel(key >> 32);
+                functions[{ privilege, symbolize(privilege, std::uint32_t(key), symbols) }] += count;
+            }
+
+            std::vector<std::pair<std::uint64_t, const std::pair<PrivilegeLevel, std::string>*>> sorted;
+            for (const auto &[function, count] : functions)
+                sorted.emplace_back(count, &function);
+            std::ranges::sort(sorted, std::greater{}, &decltype(sorted)::value_type::first);
+
+            std::fprintf(file, "%12s %8s  %-10s  %s\n", "Samples", "Percent", "Privilege", "Function");
+            for (const auto &[count, function] : sorted) {
+                std::fprintf(file, "%12llu %7.2f%%  %-10s  %s\n",
+                    static_cast<unsigned long long>(count), double(count) * 100.0 / double(std::max<std::uint64_t>(m_sample_count, 1)),
+                    get_privilege_level_name(function->first), function->second.c_str());
+            }
+        }
+
+        // Writes one line per distinct call stack in the folded format understood by flamegraph.pl and speedscope
+        auto write_folded_stacks(std::FILE *file, const SymbolTable &symbols) const -> void {
+            std::map<std::string, std::uint64_t> folded;
+            for (const auto &[stack, count] : m_stacks) {
+                std::string line = get_privilege_level_name(stack.privilege);
+                for (auto it = stack.frames.rbegin(); it != stack.frames.rend(); ++it) {
+                    line += ';';
+                    line += symbolize(stack.privilege, *it, symbols);
+                }
+
+                folded[line] += count;
+            }
+
+            for (const auto &[line, count] : folded) {
+                std::fprintf(file, "%s %llu\n", line.c_str(), static_cast<unsigned long long>(count));
+            }
+        }
+
+    private:
+        struct Stack {
+            PrivilegeLevel privilege;
+            std::vector<std::uint32_t> frames;     // Innermost frame first
+
+            auto operator<=>(const Stack &other) const = default;
+        };
+
+        auto sample(Core &core) -> void {
+            const auto privilege = core.privilege_level();
+            const std::uint32_t pc = core.pc();
+
+            m_sample_count += 1;
+            m_pc_histogram[(std::uint64_t(std::to_underlying(privilege)) << 32) | pc] += 1;
+
+            Stack stack = { privilege, { pc } };
+            if (privilege != PrivilegeLevel::User)
+                walk_frame_pointers(core, stack.frames);
+
+            m_stacks[std::move(stack)] += 1;
+        }
+
+        // Follows the frame records the RISC-V calling convention places right below the frame pointer:
+        // the return address at fp - 4 and the caller's frame pointer at fp - 8
+        auto walk_frame_pointers(Core &core, std::vector<std::uint32_t> &frames) -> void {
+            std::uint32_t frame_pointer = core.fp();
+            while (frames.size() < MaxStackDepth && frame_pointer != 0 && frame_pointer % 4 == 0) {
+                std::uint32_t return_address = 0, previous_frame_pointer = 0;
+                if (!read_stack(core, frame_pointer - 4, return_address) || !read_stack(core, frame_pointer - 8, previous_frame_pointer))
+                    break;
+
+                if (return_address == 0)
+                    break;
+
+                // The return address points after the call, the call itself is one instruction earlier
+                frames.push_back(return_address - 4);
+
+                // Stacks grow downwards, so anything else is either the end of the chain or garbage
+                if (previous_frame_pointer <= frame_pointer)
+                    break;
+                frame_pointer = previous_frame_pointer;
+            }
+        }
+
+        // A garbage frame pointer may well point at a peripheral, so only ever read from RAM. The translation must not
+        // set A bits, fill the TLB or count statistics either, sampling would otherwise change what the guest observes
+        auto read_stack(Core &core, std::uint32_t virtual_address, std::uint32_t &value) -> bool {
+            auto &address_space = m_emulator.address_space();
+
+            const auto physical_address = address_space.translate_address_without_side_effects(core, virtual_address, AccessType::Load);
+            if (!physical_address.has_value())
+                return false;
+
+            const auto &peripherals = address_space.peripherals();
+            const auto entry = std::ranges::find(peripherals, &m_ram, &AddressSpace<std::uint32_t>::PeripheralEntry::peripheral);
+            if (entry == peripherals.end() || *physical_address < entry->base_address || *physical_address - entry->base_address + sizeof(value) > m_ram.size())
+                return false;
+
+            return m_ram.read(*physical_address - entry->base_address, util::to_byte_span(value)) == AccessResult::Success;
+        }
+
+        static auto symbolize(PrivilegeLevel privilege, std::uint32_t address, const SymbolTable &symbols) -> std::string {
+            // The symbol table only describes the kernel
+            if (privilege == PrivilegeLevel::User)
+                return "[user]";
+
+            if (const auto location = symbols.lookup(address); location.has_value())
+                return location->symbol->name;
+
+            char buffer[16];
+            std::snprintf(buffer, sizeof(buffer), "0x%08X", address);
+            return buffer;
+        }
+
+        static auto get_privilege_level_name(PrivilegeLevel privilege) -> const char* {
+            switch (privilege) {
+                case PrivilegeLevel::User:          return "user";
+                case PrivilegeLevel::Supervisor:    return "supervisor";
+                case PrivilegeLevel::Machine:       return "machine";
+                default:                            return "unknown";
+            }
+        }
+
+    private:
+        Emulator<NumCores> &m_emulator;
+        dev::Ram &m_ram;
+
+        std::uint64_t m_interval = 0;
+        std::uint64_t m_steps_until_sample = 0;
+        std::jthread m_timer_thread;
+        std::atomic<bool> m_sample_requested = false;
+
+        std::uint64_t m_sample_count = 0;
+        std::unordered_map<std::uint64_t, std::uint64_t> m_pc_histogram;
+        std::map<Stack, std::uint64_t> m_stacks;
+    };
+
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <optional>
+#include <vector>
+
+#include <emu/input_log.hpp>
+#include <emu/state.hpp>
+#include <emu/devices/ram.hpp>
+#include <emu/riscv/emulator.hpp>
+
+namespace ds::emu::riscv {
+
+    // Adds reverse execution on top of an emulator. While running forward, a checkpoint of the machine state
+    // is taken periodically. Going backwards restores the closest checkpoint before the target and then
+    // deterministically executes forward again until the target is reached.
+    // RAM is restored through undo logs, so a checkpoint only costs a copy of every page written during its interval
+    template<std::size_t NumCores>
+    class TimeTravel {
+    public:
+        constexpr static std::uint64_t DefaultCheckpointInterval = 10'000'000;
+        constexpr static std::size_t DefaultMaxCheckpoints = 32;
+
+        struct WriteLocation {
+            std::uint64_t tick;
+            std::uint16_t hart;
+            std::uint32_t pc;
+        };
+
+        TimeTravel(Emulator<NumCores> &emulator, dev::Ram &ram, InputLog &input_log)
+            : m_emulator(emulator), m_ram(ram), m_input_log(input_log) { }
+
+        TimeTravel(const TimeTravel &) = delete;
+        TimeTravel &operator=(const TimeTravel &) = delete;
+
+        ~TimeTravel() {
+            m_ram.set_undo_log(nullptr);
+        }
+
+        auto power_up() -> void {
+            m_ram.set_undo_log(nullptr);
+            m_checkpoints.clear();
+
+            m_emulator.power_up();
+            m_history_end = m_emulator.ticks();
+            set_reexecuting(false);
+            take_checkpoint();
+        }
+
+        auto step() -> std::expected<void, ExceptionCause> {
+            if (m_emulator.ticks() >= m_next_checkpoint_tick) [[unlikely]]
+                take_checkpoint();
+
+            // Steps before the end of the history have been executed before, either while going backwards
+            // or because the emulation was resumed after going backwards
+            const bool reexecuting = m_emulator.ticks() < m_history_end;
+            if (reexecuting != m_reexecuting) [[unlikely]]
+                set_reexecuting(reexecuting);
+
+            const auto result = m_emulator.step();
+            m_history_end = std::max(m_history_end, m_emulator.ticks());
+
+            return result;
+        }
+
+        // Larger intervals make forward execution cheaper but going backwards more expensive.
+        // Going backwards can reach up to interval * max_checkpoints steps into the past
+        auto set_checkpoint_interval(std::uint64_t interval, std::size_t max_checkpoints = DefaultMaxCheckpoints) -> void {
+            m_checkpoint_interval = std::max<std::uint64_t>(interval, 1);
+            m_max_checkpoints = std::max<std::size_t>(max_checkpoints, 1);
+
+            while (m_checkpoints.size() > m_max_checkpoints)
+                m_checkpoints.pop_front();
+
+            if (!m_checkpoints.empty())
+                m_next_checkpoint_tick = m_checkpoints.back().tick + m_checkpoint_interval;
+        }
+
+        // Goes back the given number of steps, or as far back as possible. Returns the tick that was reached
+        auto step_back(std::uint64_t count) -> std::uint64_t {
+            if (m_checkpoints.empty())
+                return m_emulator.ticks();
+
+            const auto oldest_tick = m_checkpoints.front().tick;
+            const auto current_tick = m_emulator.ticks();
+            const auto target_tick = current_tick - std::min(count, current_tick - oldest_tick);
+
+            restore_checkpoint(find_checkpoint(target_tick));
+            execute_until(target_tick);
+
+            return m_emulator.ticks();
+        }
+
+        // Goes back to the instruction that last wrote to the given physical address range, right before it executes.
+        // Nothing changes if no such write happened within the reachable history
+        auto step_back_to_write(std::uint32_t address, std::uint32_t size = 1) -> std::optional<WriteLocation> {
+            if (m_checkpoints.empty())
+                return std::nullopt;
+
+            auto &address_space = m_emulator.address_space();
+            const auto current_tick = m_emulator.ticks();
+
+            // Search the checkpoint intervals from newest to oldest, executing each one again while watching for writes
+            std::optional<WriteLocation> location;
+            for (auto index = m_checkpoints.size(); index > 0 && !location.has_value(); index -= 1) {
+                const auto end_tick = index == m_checkpoints.size() ? current_tick : m_checkpoints[index].tick;
+
+                restore_checkpoint(index - 1);
+                address_space.set_write_watch({{ address, address + size }});
+                while (m_emulator.ticks() < end_tick && m_emulator.is_powered_up()) {
+                    auto &core = m_emulator.current_core();
+                    const WriteLocation step_location = { m_emulator.ticks(), core.hart_id(), core.pc() };
+
+                    step();
+                    if (address_space.write_watch_triggered()) [[unlikely]]
+                        location = step_location;
+                }
+                address_space.set_write_watch(std::nullopt);
+            }
+
+            if (location.has_value()) {
+                restore_checkpoint(find_checkpoint(location->tick));
+                execute_until(location->tick);
+            } else {
+                // We're now at the start of the history, go back to where we were
+                execute_until(current_tick);
+            }
+
+            return location;
+        }
+
+        // Whether execution is currently repeating steps that already happened before.
+        // Output to the outside world should be suppressed during that time, MMIO tracing is suspended automatically
+        [[nodiscard]] auto is_reexecuting() const -> bool {
+            return m_reexecuting;
+        }
+
+        [[nodiscard]] auto oldest_reachable_tick() const -> std::uint64_t {
+            return m_checkpoints.empty() ? m_emulator.ticks() : m_checkpoints.front().tick;
+        }
+
+    private:
+        struct Checkpoint {
+            std::uint64_t tick;
+            std::vector<std::uint8_t> state;
+            dev::Ram::UndoLog undo_log;
+        };
+
+        auto take_checkpoint() -> void {
+            if (m_checkpoints.size() >= m_max_checkpoints)
+                m_checkpoints.pop_front();
+
+            auto &checkpoint = m_checkpoints.emplace_back();
+            checkpoint.tick = m_emulator.ticks();
+
+            StateWriter writer(checkpoint.state);
+            m_emulator.save_state(writer);
+
+            m_ram.set_undo_log(&checkpoint.undo_log);
+            m_next_checkpoint_tick = checkpoint.tick + m_checkpoint_interval;
+        }
+
+        // Index of the newest checkpoint taken at or before the given tick
+        auto find_checkpoint(std::uint64_t tick) const -> std::size_t {
+            auto index = m_checkpoints.size() - 1;
+            while (index > 0 && m_checkpoints[index].tick > tick)
+                index -= 1;
+
+            return index;
+        }
+
+        auto restore_checkpoint(std::size_t index) -> void {
+            // Undo all memory modifications from newest to oldest until we reach the state of the checkpoint
+            for (auto i = m_checkpoints.size(); i > index; i -= 1) {
+                m_ram.apply_undo_log(m_checkpoints[i - 1].undo_log);
+            }
+            m_checkpoints.resize(index + 1);
+
+            auto &checkpoint = m_checkpoints.back();
+            checkpoint.undo_log.clear();
+            m_ram.set_undo_log(&checkpoint.undo_log);
+
+            StateReader reader(checkpoint.state);
+            m_emulator.load_state(reader);
+
+            m_input_log.seek(checkpoint.tick);
+            m_next_checkpoint_tick = checkpoint.tick + m_checkpoint_interval;
+        }
+
+        auto execute_until(std::uint64_t tick) -> void {
+            while (m_emulator.ticks() < tick && m_emulator.is_powered_up()) {
+                step();
+            }
+        }
+
+        auto set_reexecuting(bool reexecuting) -> void {
+            m_reexecuting = reexecuting;
+
+            // Accesses made again have already been traced the first time around
+            m_emulator.address_space().set_tracing_suspended(reexecuting);
+        }
+
+    private:
+        Emulator<NumCores> &m_emulator;
+        dev::Ram &m_ram;
+        InputLog &m_input_log;
+
+        std::deque<Checkpoint> m_checkpoints;
+        std::uint64_t m_checkpoint_interval = DefaultCheckpointInterval;
+        std::size_t m_max_checkpoints = DefaultMaxCheckpoints;
+        std::uint64_t m_next_checkpoint_tick = 0;
+
+        // Tick right after the newest step that was ever executed
+        std::uint64_t m_history_end = 0;
+        bool m_reexecuting = false;
+    };
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <emu/utils.hpp>
+
+namespace ds::emu {
+
+    // Serializes the internal state of the machine's components into a flat byte buffer.
+    // The layout is only meant to be read back by the same build, it's not a stable file format
+    class StateWriter {
+    public:
+        explicit StateWriter(std::vector<std::uint8_t> &buffer) : m_buffer(buffer) { }
+
+        template<typename T> requires std::is_trivially_copyable_v<T>
+        auto write(const T &value) -> void {
+            write(util::to_byte_span(value));
+        }
+
+        auto write(std::span<const std::uint8_t> data) -> void {
+            m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+        }
+
+    private:
+        std::vector<std::uint8_t> &m_buffer;
+    };
+
+    class StateReader {
+    public:
+        explicit StateReader(std::span<const std::uint8_t> buffer) : m_buffer(buffer) { }
+
+        template<typename T> requires std::is_trivially_copyable_v<T>
+        auto read() -> T {
+            T value;
+            read(util::to_byte_span(value));
+
+            return value;
+        }
+
+        auto read(std::span<std::uint8_t> data) -> void {
+            if (m_offset + data.size() > m_buffer.size())
+                throw std::out_of_range("Machine state buffer is truncated");
+
+            std::memcpy(data.data(), m_buffer.data() + m_offset, data.size());
+            m_offset += data.size();
+        }
+
+    private:
+        std::span<const std::uint8_t> m_buffer;
+        std::size_t m_offset = 0;
+    };
+
+}
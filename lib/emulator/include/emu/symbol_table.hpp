@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <emu/elf.hpp>
+
+namespace ds::emu {
+
+    // Maps guest addresses back to function names, loaded from either a System.map or the symbol table of an ELF file
+    class SymbolTable {
+    public:
+        struct Symbol {
+            std::uint64_t address;
+            std::uint64_t size;         // Zero if unknown, the symbol then extends up to the next one
+            std::string name;
+        };
+
+        struct Location {
+            const Symbol *symbol;
+            std::uint64_t offset;
+        };
+
+        auto load(const std::string &path) -> bool {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file.is_open())
+                return false;
+
+            std::vector<std::uint8_t> data(file.tellg());
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(data.data()), data.size());
+            if (!file)
+                return false;
+
+            const bool loaded = ElfFile::is_elf(data)
+                ? load_elf(std::move(data))
+                : load_system_map({ reinterpret_cast<const char *>(data.data()), data.size() });
+            if (!loaded)
+                return false;
+
+            std::ranges::sort(m_symbols, {}, &Symbol::address);
+            return true;
+        }
+
+        [[nodiscard]] auto lookup(std::uint64_t address) const -> std::optional<Location> {
+            const auto it = std::ranges::upper_bound(m_symbols, address, {}, &Symbol::address);
+            if (it == m_symbols.begin())
+                return std::nullopt;
+
+            const auto &symbol = *std::prev(it);
+            const auto offset = address - symbol.address;
+            if (symbol.size != 0 && offset >= symbol.size)
+                return std::nullopt;
+
+            return Location { &symbol, offset };
+        }
+
+        [[nodiscard]] auto symbols() const -> std::span<const Symbol> {
+            return m_symbols;
+        }
+
+        [[nodiscard]] auto empty() const -> bool {
+            return m_symbols.empty();
+        }
+
+    private:
+        // Lines look like "c0001000 T _start". Only code symbols are of interest
+        auto load_system_map(std::string_view text) -> bool {
+            std::istringstream stream{ std::string(text) };
+            std::string line;
+            while (std::getline(stream, line)) {
+                char *end = nullptr;
+                const auto address = std::strtoull(line.c_str(), &end, 16);
+                if (end == line.c_str() || line.size() < std::size_t(end - line.c_str()) + 4)
+                    continue;
+
+                const auto type = end[1];
+                if (type != 't' && type != 'T' && type != 'w' && type != 'W')
+                    continue;
+
+                m_symbols.emplace_back(address, 0, std::string(end + 3));
+            }
+
+            return !m_symbols.empty();
+        }
+
+        auto load_elf(std::vector<std::uint8_t> data) -> bool {
+            const auto elf = ElfFile::parse(std::move(data));
+            if (!elf.has_value())
+                return false;
+
+            for (const auto &symbol : elf->symbols()) {
+                if (symbol.type == ElfFile::SymbolType::Function)
+                    m_symbols.emplace_back(symbol.value, symbol.size, symbol.name);
+            }
+
+            return !m_symbols.empty();
+        }
+
+    private:
+        std::vector<Symbol> m_symbols;
+    };
+
+}
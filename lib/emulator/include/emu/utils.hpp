@@ -4,6 +4,7 @@
 #include <limits>
 #include <concepts>
 #include <span>
+#include <type_traits>
 
 namespace ds::emu::util {
 
@@ -32,7 +33,8 @@ namespace ds::emu::util {
     constexpr auto extract_bits(auto value) -> std::remove_cvref_t<decltype(value)> {
         static_assert(From <= To, "To > From");
 
-        constexpr static auto Mask = mask<(To - From) + 1>() << From;
+        using MaskType = std::conditional_t<(sizeof(value) > sizeof(std::uint32_t)), std::uint64_t, std::uint32_t>;
+        constexpr static auto Mask = mask<(To - From) + 1, MaskType>() << From;
         return (value & Mask) >> From;
     }
 
@@ -55,13 +57,17 @@ namespace ds::emu::util {
         static_assert(N <= std::numeric_limits<T>::digits, "Bit width N exceeds type width");
 
         using SignedT = std::make_signed_t<T>;
-        constexpr T sign_bit = T(1) << (N - 1);
-
-        if (value & sign_bit) {
-            constexpr T mask = (~T(0)) << N;
-            return static_cast<SignedT>(value | mask);
-        } else {
+        if constexpr (N == std::numeric_limits<T>::digits) {
             return static_cast<SignedT>(value);
+        } else {
+            constexpr T sign_bit = T(1) << (N - 1);
+
+            if (value & sign_bit) {
+                constexpr T mask = (~T(0)) << N;
+                return static_cast<SignedT>(value | mask);
+            } else {
+                return static_cast<SignedT>(value);
+            }
         }
     }
 
@@ -0,0 +1,258 @@
+#include <emu/riscv/instructions.hpp>
+
+namespace ds::emu::riscv::instr::compressed {
+
+    namespace {
+
+        using util::extract_bits;
+
+        // Encoders for the 32 bit instruction formats. Immediates are passed as they'd be after decoding
+        constexpr auto encode_r(std::uint32_t opcode, std::uint32_t rd, std::uint32_t funct3, std::uint32_t rs1, std::uint32_t rs2, std::uint32_t funct7) -> std::uint32_t {
+            return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | (opcode << 2) | 0b11;
+        }
+
+        constexpr auto encode_i(std::uint32_t opcode, std::uint32_t rd, std::uint32_t funct3, std::uint32_t rs1, std::int32_t imm) -> std::uint32_t {
+            return (std::uint32_t(imm) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | (opcode << 2) | 0b11;
+        }
+
+        constexpr auto encode_s(std::uint32_t opcode, std::uint32_t funct3, std::uint32_t rs1, std::uint32_t rs2, std::int32_t imm) -> std::uint32_t {
+            const auto value = std::uint32_t(imm);
+            return (extract_bits<5, 11>(value) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (extract_bits<0, 4>(value) << 7) | (opcode << 2) | 0b11;
+        }
+
+        constexpr auto encode_b(std::uint32_t funct3, std::uint32_t rs1, std::uint32_t rs2, std::int32_t imm) -> std::uint32_t {
+            const auto value = std::uint32_t(imm);
+            return (extract_bits<12, 12>(value) << 31) | (extract_bits<5, 10>(value) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+                   (extract_bits<1, 4>(value) << 8) | (extract_bits<11, 11>(value) << 7) | (base::BRANCH::Value << 2) | 0b11;
+        }
+
+        constexpr auto encode_u(std::uint32_t opcode, std::uint32_t rd, std::int32_t imm) -> std::uint32_t {
+            return (std::uint32_t(imm) & 0xFFFF'F000) | (rd << 7) | (opcode << 2) | 0b11;
+        }
+
+        constexpr auto encode_j(std::uint32_t rd, std::int32_t imm) -> std::uint32_t {
+            const auto value = std::uint32_t(imm);
+            return (extract_bits<20, 20>(value) << 31) | (extract_bits<1, 10>(value) << 21) | (extract_bits<11, 11>(value) << 20) |
+                   (extract_bits<12, 19>(value) << 12) | (rd << 7) | (base::JAL::Value << 2) | 0b11;
+        }
+
+        constexpr auto sign_extend(std::uint32_t value, std::uint32_t bits) -> std::int32_t {
+            const auto shift = 32 - bits;
+            return std::int32_t(value << shift) >> shift;
+        }
+
+        // Registers x8 - x15 encoded in 3 bits
+        constexpr auto compact_register(std::uint32_t value) -> std::uint32_t {
+            return value + 8;
+        }
+
+        constexpr std::uint32_t Illegal = 0;
+
+        constexpr auto expand_quadrant0(std::uint32_t c, std::uint32_t xlen) -> std::uint32_t {
+            const auto rd  = compact_register(extract_bits<2, 4>(c));
+            const auto rs1 = compact_register(extract_bits<7, 9>(c));
+
+            // Offsets of C.LW/C.SW and C.FLW/C.FSW, then C.FLD/C.FSD and C.LD/C.SD
+            const auto word_offset   = (extract_bits<10, 12>(c) << 3) | (extract_bits<6, 6>(c) << 2) | (extract_bits<5, 5>(c) << 6);
+            const auto double_offset = (extract_bits<10, 12>(c) << 3) | (extract_bits<5, 6>(c) << 6);
+
+            switch (extract_bits<13, 15>(c)) {
+                case 0b000: { // C.ADDI4SPN
+                    const auto imm = (extract_bits<11, 12>(c) << 4) | (extract_bits<7, 10>(c) << 6) | (extract_bits<6, 6>(c) << 2) | (extract_bits<5, 5>(c) << 3);
+                    if (imm == 0)
+                        return Illegal;
+                    return encode_i(base::OP_IMM::Value, rd, 0b000, 2, imm);
+                }
+                case 0b001: // C.FLD
+                    return encode_i(base::LOAD_FP::Value, rd, 0b011, rs1, double_offset);
+                case 0b010: // C.LW
+                    return encode_i(base::LOAD::Value, rd, 0b010, rs1, word_offset);
+                case 0b011: // C.FLW, C.LD on RV64
+                    if (xlen == 64)
+                        return encode_i(base::LOAD::Value, rd, 0b011, rs1, double_offset);
+                    return encode_i(base::LOAD_FP::Value, rd, 0b010, rs1, word_offset);
+                case 0b101: // C.FSD
+                    return encode_s(base::STORE_FP::Value, 0b011, rs1, rd, double_offset);
+                case 0b110: // C.SW
+                    return encode_s(base::STORE::Value, 0b010, rs1, rd, word_offset);
+                case 0b111: // C.FSW, C.SD on RV64
+                    if (xlen == 64)
+                        return encode_s(base::STORE::Value, 0b011, rs1, rd, double_offset);
+                    return encode_s(base::STORE_FP::Value, 0b010, rs1, rd, word_offset);
+                default:
+                    return Illegal;
+            }
+        }
+
+        constexpr auto expand_quadrant1(std::uint32_t c, std::uint32_t xlen) -> std::uint32_t {
+            const auto rd = extract_bits<7, 11>(c);
+            const auto rd_compact = compact_register(extract_bits<7, 9>(c));
+            const auto rs2_compact = compact_register(extract_bits<2, 4>(c));
+            const auto imm = sign_extend((extract_bits<12, 12>(c) << 5) | extract_bits<2, 6>(c), 6);
+
+            // Shift amounts are 6 bits wide on RV64, the upper bit has to be zero on RV32
+            const auto shamt = (extract_bits<12, 12>(c) << 5) | extract_bits<2, 6>(c);
+            const bool valid_shamt = xlen == 64 || extract_bits<12, 12>(c) == 0;
+
+            const auto jump_offset = sign_extend(
+                (extract_bits<12, 12>(c) << 11) | (extract_bits<11, 11>(c) << 4) | (extract_bits<9, 10>(c) << 8) | (extract_bits<8, 8>(c) << 10) |
+                (extract_bits<7, 7>(c) << 6) | (extract_bits<6, 6>(c) << 7) | (extract_bits<3, 5>(c) << 1) | (extract_bits<2, 2>(c) << 5), 12);
+            const auto branch_offset = sign_extend(
+                (extract_bits<12, 12>(c) << 8) | (extract_bits<10, 11>(c) << 3) | (extract_bits<5, 6>(c) << 6) |
+                (extract_bits<3, 4>(c) << 1) | (extract_bits<2, 2>(c) << 5), 9);
+
+            switch (extract_bits<13, 15>(c)) {
+                case 0b000: // C.ADDI / C.NOP
+                    return encode_i(base::OP_IMM::Value, rd, 0b000, rd, imm);
+                case 0b001: // C.JAL, C.ADDIW on RV64
+                    if (xlen == 64) {
+                        if (rd == 0)
+                            return Illegal;
+                        return encode_i(base::OP_IMM_32::Value, rd, 0b000, rd, imm);
+                    }
+                    return encode_j(1, jump_offset);
+                case 0b010: // C.LI
+                    return encode_i(base::OP_IMM::Value, rd, 0b000, 0, imm);
+                case 0b011: {
+                    if (rd == 2) { // C.ADDI16SP
+                        const auto sp_imm = sign_extend(
+                            (extract_bits<12, 12>(c) << 9) | (extract_bits<6, 6>(c) << 4) | (extract_bits<5, 5>(c) << 6) |
+                            (extract_bits<3, 4>(c) << 7) | (extract_bits<2, 2>(c) << 5), 10);
+                        if (sp_imm == 0)
+                            return Illegal;
+                        return encode_i(base::OP_IMM::Value, 2, 0b000, 2, sp_imm);
+                    }
+
+                    // C.LUI
+                    if (imm == 0)
+                        return Illegal;
+                    return encode_u(base::LUI::Value, rd, imm << 12);
+                }
+                case 0b100: {
+                    switch (extract_bits<10, 11>(c)) {
+                        case 0b00: // C.SRLI
+                            if (!valid_shamt)
+                                return Illegal;
+                            return encode_i(base::OP_IMM::Value, rd_compact, 0b101, rd_compact, shamt);
+                        case 0b01: // C.SRAI
+                            if (!valid_shamt)
+                                return Illegal;
+                            return encode_i(base::OP_IMM::Value, rd_compact, 0b101, rd_compact, 0b0100000'00000 | shamt);
+                        case 0b10: // C.ANDI
+                            return encode_i(base::OP_IMM::Value, rd_compact, 0b111, rd_compact, imm);
+                        default: {
+                            // C.SUBW and C.ADDW only exist on RV64
+                            if (extract_bits<12, 12>(c) != 0) {
+                                if (xlen != 64)
+                                    return Illegal;
+
+                                switch (extract_bits<5, 6>(c)) {
+                                    case 0b00: return encode_r(base::OP_32::Value, rd_compact, 0b000, rd_compact, rs2_compact, 0b0100000); // C.SUBW
+                                    case 0b01: return encode_r(base::OP_32::Value, rd_compact, 0b000, rd_compact, rs2_compact, 0b0000000); // C.ADDW
+                                    default:   return Illegal;
+                                }
+                            }
+
+                            switch (extract_bits<5, 6>(c)) {
+                                case 0b00: return encode_r(base::OP::Value, rd_compact, 0b000, rd_compact, rs2_compact, 0b0100000); // C.SUB
+                                case 0b01: return encode_r(base::OP::Value, rd_compact, 0b100, rd_compact, rs2_compact, 0b0000000); // C.XOR
+                                case 0b10: return encode_r(base::OP::Value, rd_compact, 0b110, rd_compact, rs2_compact, 0b0000000); // C.OR
+                                default:   return encode_r(base::OP::Value, rd_compact, 0b111, rd_compact, rs2_compact, 0b0000000); // C.AND
+                            }
+                        }
+                    }
+                }
+                case 0b101: // C.J
+                    return encode_j(0, jump_offset);
+                case 0b110: // C.BEQZ
+                    return encode_b(0b000, rd_compact, 0, branch_offset);
+                case 0b111: // C.BNEZ
+                    return encode_b(0b001, rd_compact, 0, branch_offset);
+                default:
+                    return Illegal;
+            }
+        }
+
+        constexpr auto expand_quadrant2(std::uint32_t c, std::uint32_t xlen) -> std::uint32_t {
+            const auto rd  = extract_bits<7, 11>(c);
+            const auto rs2 = extract_bits<2, 6>(c);
+
+            const auto load_word_offset   = (extract_bits<12, 12>(c) << 5) | (extract_bits<4, 6>(c) << 2) | (extract_bits<2, 3>(c) << 6);
+            const auto load_double_offset = (extract_bits<12, 12>(c) << 5) | (extract_bits<5, 6>(c) << 3) | (extract_bits<2, 4>(c) << 6);
+            const auto store_word_offset   = (extract_bits<9, 12>(c) << 2) | (extract_bits<7, 8>(c) << 6);
+            const auto store_double_offset = (extract_bits<10, 12>(c) << 3) | (extract_bits<7, 9>(c) << 6);
+
+            switch (extract_bits<13, 15>(c)) {
+                case 0b000: // C.SLLI
+                    if (xlen != 64 && extract_bits<12, 12>(c) != 0)
+                        return Illegal;
+                    return encode_i(base::OP_IMM::Value, rd, 0b001, rd, (extract_bits<12, 12>(c) << 5) | rs2);
+                case 0b001: // C.FLDSP
+                    return encode_i(base::LOAD_FP::Value, rd, 0b011, 2, load_double_offset);
+                case 0b010: // C.LWSP
+                    if (rd == 0)
+                        return Illegal;
+                    return encode_i(base::LOAD::Value, rd, 0b010, 2, load_word_offset);
+                case 0b011: // C.FLWSP, C.LDSP on RV64
+                    if (xlen == 64) {
+                        if (rd == 0)
+                            return Illegal;
+                        return encode_i(base::LOAD::Value, rd, 0b011, 2, load_double_offset);
+                    }
+                    return encode_i(base::LOAD_FP::Value, rd, 0b010, 2, load_word_offset);
+                case 0b100: {
+                    if (extract_bits<12, 12>(c) == 0) {
+                        if (rs2 != 0) // C.MV
+                            return encode_r(base::OP::Value, rd, 0b000, 0, rs2, 0b0000000);
+
+                        // C.JR
+                        if (rd == 0)
+                            return Illegal;
+                        return encode_i(base::JALR::Value, 0, 0b000, rd, 0);
+                    }
+
+                    if (rs2 != 0) // C.ADD
+                        return encode_r(base::OP::Value, rd, 0b000, rd, rs2, 0b0000000);
+                    if (rd == 0) // C.EBREAK
+                        return encode_i(base::SYSTEM::Value, 0, 0b000, 0, 1);
+
+                    // C.JALR
+                    return encode_i(base::JALR::Value, 1, 0b000, rd, 0);
+                }
+                case 0b101: // C.FSDSP
+                    return encode_s(base::STORE_FP::Value, 0b011, 2, rs2, store_double_offset);
+                case 0b110: // C.SWSP
+                    return encode_s(base::STORE::Value, 0b010, 2, rs2, store_word_offset);
+                case 0b111: // C.FSWSP, C.SDSP on RV64
+                    if (xlen == 64)
+                        return encode_s(base::STORE::Value, 0b011, 2, rs2, store_double_offset);
+                    return encode_s(base::STORE_FP::Value, 0b010, 2, rs2, store_word_offset);
+                default:
+                    return Illegal;
+            }
+        }
+
+        auto build_expansion_table(std::uint32_t xlen) -> std::array<std::uint32_t, 1 << 16> {
+            std::array<std::uint32_t, 1 << 16> table = {};
+            for (std::uint32_t instruction = 0; instruction < table.size(); instruction += 1) {
+                // All zeros is defined to be illegal
+                if (instruction == 0)
+                    continue;
+
+                switch (extract_bits<0, 1>(instruction)) {
+                    case 0b00: table[instruction] = expand_quadrant0(instruction, xlen); break;
+                    case 0b01: table[instruction] = expand_quadrant1(instruction, xlen); break;
+                    case 0b10: table[instruction] = expand_quadrant2(instruction, xlen); break;
+                    default:   break;
+                }
+            }
+
+            return table;
+        }
+
+    }
+
+    const std::array<std::uint32_t, 1 << 16> ExpansionTable32 = build_expansion_table(32);
+    const std::array<std::uint32_t, 1 << 16> ExpansionTable64 = build_expansion_table(64);
+
+}
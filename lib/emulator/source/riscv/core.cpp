@@ -1,13 +1,169 @@
 #include <emu/riscv/core.hpp>
 #include <emu/riscv/instructions.hpp>
 
+#include <algorithm>
+#include <bit>
 #include <cstdio>
+#include <limits>
+#include <type_traits>
+#include <utility>
 
 namespace ds::emu::riscv {
 
-    auto Core::handle_system(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
-        const std::uint32_t old       = csr(instruction.imm);
-        std::uint32_t write_val = x(instruction.rs1);
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::read_csr(std::uint16_t number) -> T {
+        switch (number) {
+            case 0x001: return util::extract_bits<0, 4>(fcsr().get());     // fflags
+            case 0x002: return util::extract_bits<5, 7>(fcsr().get());     // frm
+            case 0xC00 ... 0xC00 + CounterCount - 1:                        // cycle, time, instret, hpmcounter3...
+                return T(counter(Counter(number - 0xC00)));
+            case 0xC80 ... 0xC80 + CounterCount - 1:                        // cycleh, timeh, instreth, hpmcounter3h...
+                return T(counter(Counter(number - 0xC80)) >> 32);
+            default:    return csr(number);
+        }
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::write_csr(std::uint16_t number, T value) -> void {
+        switch (number) {
+            case 0x001: // fflags
+                fcsr() = (fcsr() & ~0x1FU) | (value & 0x1F);
+                mark_fp_state_dirty();
+                break;
+            case 0x002: // frm
+                fcsr() = (fcsr() & 0x1F) | ((value & 0b111) << 5);
+                mark_fp_state_dirty();
+                break;
+            case 0x003: // fcsr
+                fcsr() = value & 0xFF;
+                mark_fp_state_dirty();
+                break;
+            case 0x100: { // sstatus
+                // SD is read-only and summarizes whether FS is dirty
+                const bool fp_state_dirty = util::extract_bits<13, 14>(value) == 0b11;
+                sstatus() = (value & ~StatusStateDirty) | (fp_state_dirty ? StatusStateDirty : 0);
+
+                // UXL is read-only as well, user mode always uses the full register width
+                if constexpr (XLen == 64)
+                    sstatus() = (sstatus() & ~(T(0b11) << 32)) | (T(0b10) << 32);
+                break;
+            }
+            case 0x180: { // satp
+                // ASIDs aren't implemented, so the ASID field is read-only zero
+                if constexpr (XLen == 32) {
+                    satp() = value & ~(util::mask<9>() << 22);
+                } else {
+                    // Writes selecting an unsupported translation mode have no effect, which is how the guest finds out what's supported
+                    const auto mode = value >> 60;
+                    if (mode != SatpModeBare && mode != SatpModeSv39 && mode != SatpModeSv48)
+                        break;
+
+                    satp() = value & ~(util::mask<16, T>() << 44);
+                }
+
+                // Cached translations aren't tagged with an address space, so they're only valid for the current one
+                m_address_space->invalidate();
+                break;
+            }
+            default:
+                csr(number) = value;
+                break;
+        }
+
+        switch (number) {
+            case 0x100: // sstatus
+            case 0x104: // sie
+            case 0x144: // sip
+            case 0x303: // mideleg
+                update_interrupt_pending();
+                break;
+            default:
+                break;
+        }
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::count_events(Counter counter) const -> std::uint64_t {
+        switch (counter) {
+            using enum Counter;
+            case Cycle:                 return m_statistics.cycles;
+            case Time:
+                if constexpr (XLen == 64)
+                    return m_csrs[0xC01].get();
+                else
+                    return (std::uint64_t(m_csrs[0xC81].get()) << 32) | m_csrs[0xC01].get();
+            case InstructionsRetired:   return m_statistics.instructions_retired;
+            case TlbMisses:             return m_statistics.tlb_misses;
+            case MmioAccesses:          return m_statistics.mmio_accesses;
+            case TakenBranches:         return m_statistics.taken_branches;
+            case Traps: {
+                std::uint64_t traps = 0;
+                for (const auto count : m_statistics.exceptions) traps += count;
+                for (const auto count : m_statistics.interrupts) traps += count;
+                return traps;
+            }
+        }
+
+        std::unreachable();
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::counter(Counter counter) const -> std::uint64_t {
+        const auto offset = m_counter_offsets[std::to_underlying(counter)];
+        return is_counter_running(counter) ? count_events(counter) + offset : offset;
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::set_counter(Counter counter, std::uint64_t value) -> void {
+        m_counter_offsets[std::to_underlying(counter)] = is_counter_running(counter) ? value - count_events(counter) : value;
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::start_counter(Counter counter) -> void {
+        if (is_counter_running(counter))
+            return;
+
+        const auto value = this->counter(counter);
+        m_stopped_counters &= ~(1U << std::to_underlying(counter));
+        set_counter(counter, value);
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::stop_counter(Counter counter) -> void {
+        if (!is_counter_running(counter))
+            return;
+
+        const auto value = this->counter(counter);
+        m_stopped_counters |= 1U << std::to_underlying(counter);
+        set_counter(counter, value);
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_system(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+        if (instruction.funct3 != 0b000) {
+            const bool writes = instruction.funct3 == 0b001 || instruction.funct3 == 0b101 || instruction.rs1 != 0;
+            const bool counter_high = instruction.imm >= 0xC80 && instruction.imm <= 0xC9F;
+            const bool counter = (instruction.imm >= 0xC00 && instruction.imm <= 0xC1F) || counter_high;
+
+            // CSRs with the top two address bits set are read-only
+            if (writes && (instruction.imm >> 10) == 0b11)
+                return std::unexpected(ExceptionCause::IllegalInstruction);
+
+            // The upper halves of the counters only exist on RV32
+            if (XLen == 64 && counter_high)
+                return std::unexpected(ExceptionCause::IllegalInstruction);
+
+            // Supervisor mode decides which counters user mode may read
+            if (counter && m_privilege_level == PrivilegeLevel::User && !scounteren().get_bit(instruction.imm & 0x1F))
+                return std::unexpected(ExceptionCause::IllegalInstruction);
+        }
+
+        // The floating point CSRs can only be accessed while the FPU is enabled
+        if (instruction.funct3 != 0b000 && instruction.imm >= 0x001 && instruction.imm <= 0x003 && !is_fpu_enabled())
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        const T old       = read_csr(instruction.imm);
+        const T write_val = x(instruction.rs1);
 
         switch (instruction.funct3) {
             case 0b000: // PRIV
@@ -30,8 +186,7 @@ namespace ds::emu::riscv {
                         m_address_space->invalidate();
                         return {};
                     case 0b000100000010: { // SRET
-                        pc() = sepc() - 4;
-                        m_address_space->invalidate();
+                        pc() = sepc() - m_instruction_length;
 
                         const auto spp  = sstatus().get_bit(8);
                         const auto spie = sstatus().get_bit(5);
@@ -41,44 +196,44 @@ namespace ds::emu::riscv {
                         sstatus().set_bit(1, spie);         // SIE = SPIE
                         sstatus().set_bit(8, false);   // SPP = 0
                         sstatus().set_bit(5, true);    // SPIE = 1
+
+                        update_interrupt_pending();
                         return {};
                     }
                     case 0b000100000101: { // WFI
                         m_powered_up = false;
+                        update_interrupt_pending();
                         return {};
                     }
                     default:
                         return std::unexpected(ExceptionCause::IllegalInstruction);
                 }
             case 0b001: // CSRRW
-                if (instruction.imm == 0x180) {
-                    write_val &= ~(util::mask<9>() << 22);
-                }
-                csr(instruction.imm) = write_val;
+                write_csr(instruction.imm, write_val);
                 x(instruction.rd) = old;
                 return {};
             case 0b101: // CSRRWI
-                csr(instruction.imm) = instruction.rs1;
+                write_csr(instruction.imm, instruction.rs1);
                 x(instruction.rd) = old;
                 return {};
             case 0b010: // CSRRS
                 if (instruction.rs1 != 0)
-                    csr(instruction.imm) = old | write_val;
+                    write_csr(instruction.imm, old | write_val);
                 x(instruction.rd) = old;
                 return {};
             case 0b110: // CSRRSI
                 if (instruction.rs1 != 0)
-                    csr(instruction.imm) = old | instruction.rs1;
+                    write_csr(instruction.imm, old | instruction.rs1);
                 x(instruction.rd) = old;
                 return {};
             case 0b011: // CSRRC
                 if (instruction.rs1 != 0)
-                    csr(instruction.imm) = old & ~write_val;
+                    write_csr(instruction.imm, old & ~write_val);
                 x(instruction.rd) = old;
                 return {};
             case 0b111: // CSRRCI
                 if (instruction.rs1 != 0)
-                    csr(instruction.imm) = old & ~instruction.rs1;
+                    write_csr(instruction.imm, old & ~instruction.rs1);
                 x(instruction.rd) = old;
                 return {};
             default:
@@ -86,34 +241,134 @@ namespace ds::emu::riscv {
         }
     }
 
-    auto Core::handle_load(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
-        const auto offset = util::sign_extend<std::uint32_t, 12>(instruction.imm);
-        const auto address = x(instruction.rs1) + offset;
-        const bool sign_extend = util::extract_bits<2, 2>(instruction.funct3) == 0b0;
-        const auto width = 1U << util::extract_bits<0, 1>(instruction.funct3);
+    namespace {
+
+        // Part of a misaligned access that lies within a single page and peripheral
+        template<typename T>
+        struct AccessChunk {
+            T physical_address;
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        // Accesses are at most 8 bytes, so even splitting them into single bytes can't produce more chunks
+        template<typename T>
+        using AccessChunks = std::array<AccessChunk<T>, 8>;
+
+        // Translates all parts of a misaligned access up front, so a fault on the second page doesn't leave a store half done
+        template<typename T>
+        auto split_misaligned_access(BasicCore<T> &core, T address, std::size_t size, AccessType access_type, AccessChunks<T> &chunks) -> std::expected<std::size_t, ExceptionCause> {
+            constexpr static T PageSize = 4096;
+
+            const bool store = access_type == AccessType::Store;
+            auto &address_space = core.address_space();
+
+            std::size_t count = 0;
+            for (std::uint32_t offset = 0; offset < size; ) {
+                const T virtual_address = address + offset;
+                const auto physical_address = address_space.translate_address(core, virtual_address, access_type);
+                if (!physical_address.has_value()) [[unlikely]] {
+                    core.stval() = virtual_address;
+                    return std::unexpected(store ? ExceptionCause::StorePageFault : ExceptionCause::LoadPageFault);
+                }
+
+                const auto entry = address_space.get(*physical_address);
+                if (entry == nullptr) [[unlikely]] {
+                    core.stval() = virtual_address;
+                    return std::unexpected(store ? ExceptionCause::StoreFault : ExceptionCause::LoadFault);
+                }
+
+                const auto page_remaining       = PageSize - (virtual_address % PageSize);
+                const auto peripheral_remaining = entry->peripheral->size() - (*physical_address - entry->base_address);
+                const auto chunk_size = std::min<std::size_t>({ size - offset, page_remaining, peripheral_remaining });
+
+                chunks[count++] = { *physical_address, offset, std::uint32_t(chunk_size) };
+                offset += chunk_size;
+            }
+
+            return count;
+        }
+
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::read_misaligned(T address, std::span<std::uint8_t> buffer) -> std::expected<void, ExceptionCause> {
+        AccessChunks<T> chunks;
+        const auto count = split_misaligned_access(*this, address, buffer.size(), AccessType::Load, chunks);
+        if (!count.has_value()) [[unlikely]]
+            return std::unexpected(count.error());
+
+        for (const auto &chunk : std::span(chunks).first(*count)) {
+            if (m_address_space->read_physical(chunk.physical_address, buffer.subspan(chunk.offset, chunk.size)) != AccessResult::Success) [[unlikely]] {
+                stval() = address + chunk.offset;
+                return std::unexpected(ExceptionCause::LoadFault);
+            }
+        }
 
-        std::expected<std::uint32_t, ExceptionCause> value;
+        m_statistics.misaligned_accesses += 1;
+        return {};
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::write_misaligned(T address, std::span<const std::uint8_t> buffer) -> std::expected<void, ExceptionCause> {
+        AccessChunks<T> chunks;
+        const auto count = split_misaligned_access(*this, address, buffer.size(), AccessType::Store, chunks);
+        if (!count.has_value()) [[unlikely]]
+            return std::unexpected(count.error());
+
+        for (const auto &chunk : std::span(chunks).first(*count)) {
+            if (m_address_space->write_physical(chunk.physical_address, buffer.subspan(chunk.offset, chunk.size)) != AccessResult::Success) [[unlikely]] {
+                stval() = address + chunk.offset;
+                return std::unexpected(ExceptionCause::StoreFault);
+            }
+        }
+
+        m_statistics.misaligned_accesses += 1;
+        return {};
+    }
+
+    template<std::unsigned_integral T>
+    template<std::uint32_t Funct3>
+    auto BasicCore<T>::handle_load(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+        const auto offset = util::sign_extend<T, 12>(instruction.imm);
+        const T address = x(instruction.rs1) + offset;
+        const bool sign_extend = util::extract_bits<2, 2>(Funct3) == 0b0;
+        const auto width = 1U << util::extract_bits<0, 1>(Funct3);
+
+        std::expected<T, ExceptionCause> value;
         switch (width) {
             case 1: // LB
                 value = read<std::uint8_t>(address);
                 if (!value.has_value()) [[unlikely]]
                     return std::unexpected(value.error());
                 if (sign_extend)
-                    value = util::sign_extend<std::uint32_t, 8>(*value);
+                    value = util::sign_extend<T, 8>(*value);
                 break;
             case 2: // LH
                 value = read<std::uint16_t>(address);
                 if (!value.has_value()) [[unlikely]]
                     return std::unexpected(value.error());
                 if (sign_extend)
-                    value = util::sign_extend<std::uint32_t, 16>(*value);
+                    value = util::sign_extend<T, 16>(*value);
                 break;
-            case 4: // LW
+            case 4: // LW / LWU
+                // LWU only exists on RV64
+                if (XLen == 32 && !sign_extend) [[unlikely]]
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
+
                 value = read<std::uint32_t>(address);
                 if (!value.has_value()) [[unlikely]]
                     return std::unexpected(value.error());
-                if (!sign_extend) [[unlikely]]
+                if (sign_extend)
+                    value = util::sign_extend<T, 32>(*value);
+                break;
+            case 8: // LD
+                if (XLen == 32 || !sign_extend) [[unlikely]]
                     return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                value = read<T>(address);
+                if (!value.has_value()) [[unlikely]]
+                    return std::unexpected(value.error());
                 break;
             default:
                 return std::unexpected(ExceptionCause::IllegalInstruction);
@@ -123,10 +378,12 @@ namespace ds::emu::riscv {
         return {};
     }
 
-    auto Core::handle_store(const instr::base::type::S &instruction) -> std::expected<void, ExceptionCause> {
-        const auto offset = util::sign_extend<std::uint32_t, 12>(instruction.imm);
-        const std::uint32_t base = x(instruction.rs1);
-        const auto width = 1U << util::extract_bits<0, 1>(instruction.funct3);
+    template<std::unsigned_integral T>
+    template<std::uint32_t Funct3>
+    auto BasicCore<T>::handle_store(const instr::base::type::S &instruction) -> std::expected<void, ExceptionCause> {
+        const auto offset = util::sign_extend<T, 12>(instruction.imm);
+        const T base = x(instruction.rs1);
+        const auto width = 1U << util::extract_bits<0, 1>(Funct3);
 
         switch (width) {
             case 1: // SB
@@ -141,6 +398,13 @@ namespace ds::emu::riscv {
                 if (auto result = write<std::uint32_t>(base + offset, x(instruction.rs2)); !result.has_value())
                     return std::unexpected(result.error());
                 break;
+            case 8: // SD
+                if (XLen == 32 || util::extract_bits<2, 2>(Funct3) != 0) [[unlikely]]
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                if (auto result = write<T>(base + offset, x(instruction.rs2)); !result.has_value())
+                    return std::unexpected(result.error());
+                break;
             default:
                 return std::unexpected(ExceptionCause::IllegalInstruction);
         }
@@ -148,103 +412,207 @@ namespace ds::emu::riscv {
         return {};
     }
 
-    auto Core::handle_lui(const instr::base::type::U &instruction) -> std::expected<void, ExceptionCause> {
-        x(instruction.rd) = instruction.imm;
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_lui(const instr::base::type::U &instruction) -> std::expected<void, ExceptionCause> {
+        x(instruction.rd) = util::sign_extend<T, 32>(instruction.imm);
         return {};
     }
 
-    auto Core::handle_auipc(const instr::base::type::U &instruction) -> std::expected<void, ExceptionCause> {
-        x(instruction.rd) = instruction.imm + pc();
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_auipc(const instr::base::type::U &instruction) -> std::expected<void, ExceptionCause> {
+        x(instruction.rd) = util::sign_extend<T, 32>(instruction.imm) + pc();
         return {};
     }
 
-    auto Core::handle_jal(const instr::base::type::J &instruction) -> std::expected<void, ExceptionCause> {
-        const auto offset = util::sign_extend<std::uint32_t, 21>(instruction.imm);
-        const auto destination = pc() + offset;
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_jal(const instr::base::type::J &instruction) -> std::expected<void, ExceptionCause> {
+        const auto offset = util::sign_extend<T, 21>(instruction.imm);
+        const T destination = pc() + offset;
 
-        x(instruction.rd) = pc() + 4;
-        pc() = destination - 4;
+        x(instruction.rd) = pc() + m_instruction_length;
+        pc() = destination - m_instruction_length;
 
         return {};
     }
 
-    auto Core::handle_jalr(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
-        const auto offset = util::sign_extend<std::uint32_t, 12>(instruction.imm);
-        const auto destination = (x(instruction.rs1) + offset) & ~0x0000'0001;
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_jalr(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+        const auto offset = util::sign_extend<T, 12>(instruction.imm);
+        const T destination = (x(instruction.rs1) + offset) & ~T(0x0000'0001);
 
-        x(instruction.rd) = pc() + 4;
-        pc() = destination - 4;
+        x(instruction.rd) = pc() + m_instruction_length;
+        pc() = destination - m_instruction_length;
 
         return {};
     }
 
-    auto Core::handle_op_imm(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
-        const bool alternative = (instruction.imm >> 5) == 0b010'0000;
-        const auto shamt = instruction.imm & 0b11111;
-        switch (instruction.funct3) {
+    template<std::unsigned_integral T>
+    template<std::uint32_t Funct3>
+    auto BasicCore<T>::handle_op_imm(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+        // Shift amounts on RV64 take up the lowest bit of what's funct7 on RV32
+        const auto shamt = instruction.imm & (XLen - 1);
+        const auto funct7 = (instruction.imm >> 5) & ~(XLen == 64 ? 1U : 0U);
+        switch (Funct3) {
             case 0b000: { // ADDI
                 x(instruction.rd) =
                     x(instruction.rs1) +
-                    util::sign_extend<std::uint32_t, 12>(instruction.imm);
+                    util::sign_extend<T, 12>(instruction.imm);
                 return {};
             }
             case 0b111: { // ANDI
                 x(instruction.rd) =
                     x(instruction.rs1) &
-                    util::sign_extend<std::uint32_t, 12>(instruction.imm);
+                    util::sign_extend<T, 12>(instruction.imm);
                 return {};
             }
             case 0b110: { // ORI
                 x(instruction.rd) =
                     x(instruction.rs1) |
-                    util::sign_extend<std::uint32_t, 12>(instruction.imm);
+                    util::sign_extend<T, 12>(instruction.imm);
                 return {};
             }
             case 0b100: { // XORI
                 x(instruction.rd) =
                     x(instruction.rs1) ^
-                    util::sign_extend<std::uint32_t, 12>(instruction.imm);
+                    util::sign_extend<T, 12>(instruction.imm);
                 return {};
             }
-            case 0b001: { // SLLI
-                x(instruction.rd) =
-                    x(instruction.rs1) <<
-                    shamt;
-                return {};
+            case 0b001: {
+                switch (funct7) {
+                    case 0b000'0000: // SLLI
+                        x(instruction.rd) =
+                            x(instruction.rs1) <<
+                            shamt;
+                        return {};
+                    case 0b011'0000: { // Zbb unary operations
+                        const T value = x(instruction.rs1);
+                        switch (shamt) {
+                            case 0b00000: x(instruction.rd) = std::countl_zero(value); return {};                   // CLZ
+                            case 0b00001: x(instruction.rd) = std::countr_zero(value); return {};                   // CTZ
+                            case 0b00010: x(instruction.rd) = std::popcount(value); return {};                      // CPOP
+                            case 0b00100: x(instruction.rd) = util::sign_extend<T, 8>(value & 0xFF); return {};     // SEXT.B
+                            case 0b00101: x(instruction.rd) = util::sign_extend<T, 16>(value & 0xFFFF); return {};  // SEXT.H
+                            default:      return std::unexpected(ExceptionCause::IllegalInstruction);
+                        }
+                    }
+                    case 0b001'0100: // BSETI
+                        x(instruction.rd) = x(instruction.rs1) | (T(1) << shamt);
+                        return {};
+                    case 0b010'0100: // BCLRI
+                        x(instruction.rd) = x(instruction.rs1) & ~(T(1) << shamt);
+                        return {};
+                    case 0b011'0100: // BINVI
+                        x(instruction.rd) = x(instruction.rs1) ^ (T(1) << shamt);
+                        return {};
+                    default:
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+                }
             }
             case 0b010: { // SLTI
                 x(instruction.rd) =
-                    static_cast<std::int32_t>(x(instruction.rs1)) <
-                    util::sign_extend<std::uint32_t, 12>(instruction.imm);
+                    static_cast<Signed>(x(instruction.rs1)) <
+                    util::sign_extend<T, 12>(instruction.imm);
                 return {};
             }
             case 0b011: { // SLTIU
+                // The immediate is sign extended first and then compared as unsigned
                 x(instruction.rd) =
                     x(instruction.rs1) <
-                    instruction.imm;
+                    static_cast<T>(util::sign_extend<T, 12>(instruction.imm));
                 return {};
             }
-            case 0b101: { // SRLI / SRAI
-                if (!alternative) {
-                    x(instruction.rd) =
-                        x(instruction.rs1) >>
-                        shamt;
-                } else {
-                    x(instruction.rd) =
-                        static_cast<std::int32_t>(x(instruction.rs1)) >>
-                        shamt;
+            case 0b101: {
+                switch (funct7) {
+                    case 0b000'0000: // SRLI
+                        x(instruction.rd) =
+                            x(instruction.rs1) >>
+                            shamt;
+                        return {};
+                    case 0b010'0000: // SRAI
+                        x(instruction.rd) =
+                            static_cast<Signed>(x(instruction.rs1)) >>
+                            shamt;
+                        return {};
+                    case 0b011'0000: // RORI
+                        x(instruction.rd) = std::rotr(T(x(instruction.rs1)), shamt);
+                        return {};
+                    case 0b010'0100: // BEXTI
+                        x(instruction.rd) = (x(instruction.rs1) >> shamt) & 1;
+                        return {};
+                    default:
+                        break;
+                }
+
+                switch (instruction.imm) {
+                    case 0b0010'1000'0111: { // ORC.B
+                        const T value = x(instruction.rs1);
+                        T result = 0;
+                        for (std::uint32_t byte = 0; byte < sizeof(T); byte += 1) {
+                            if (((value >> (byte * 8)) & 0xFF) != 0)
+                                result |= T(0xFF) << (byte * 8);
+                        }
+                        x(instruction.rd) = result;
+                        return {};
+                    }
+                    case XLen == 32 ? 0b0110'1001'1000 : 0b0110'1011'1000: // REV8
+                        x(instruction.rd) = std::byteswap(T(x(instruction.rs1)));
+                        return {};
+                    default:
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
                 }
-                return {};
             }
             default:
                 return std::unexpected(ExceptionCause::IllegalInstruction);
         }
     }
 
-    auto Core::handle_op(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause> {
-        switch (instruction.funct7) {
+    namespace {
+
+        // Upper half of the full width product of two registers
+        template<typename T, bool SignedLeft, bool SignedRight>
+        constexpr auto multiply_high(T left, T right) -> T {
+            using Wide       = std::conditional_t<sizeof(T) == 4, std::uint64_t, unsigned __int128>;
+            using SignedWide = std::conditional_t<sizeof(T) == 4, std::int64_t, __int128>;
+            using Signed = std::make_signed_t<T>;
+
+            // Sign extending the operands first makes the lower half of the wide product come out right for all signedness combinations
+            const Wide wide_left  = SignedLeft  ? Wide(SignedWide(Signed(left)))  : Wide(left);
+            const Wide wide_right = SignedRight ? Wide(SignedWide(Signed(right))) : Wide(right);
+
+            return T((wide_left * wide_right) >> (sizeof(T) * 8));
+        }
+
+        // Division and remainder as defined by the M extension, which never traps
+        template<typename T>
+        constexpr auto divide(T left, T right, bool is_signed, bool remainder) -> T {
+            using Signed = std::make_signed_t<T>;
+
+            if (right == 0)
+                return remainder ? left : std::numeric_limits<T>::max();
+
+            if (!is_signed)
+                return remainder ? left % right : left / right;
+
+            // The one signed division that overflows
+            if (Signed(left) == std::numeric_limits<Signed>::min() && Signed(right) == -1)
+                return remainder ? 0 : left;
+
+            return remainder ? T(Signed(left) % Signed(right)) : T(Signed(left) / Signed(right));
+        }
+
+    }
+
+    template<std::unsigned_integral T>
+    template<std::uint32_t Funct3, std::uint32_t Funct7>
+    auto BasicCore<T>::handle_op(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause> {
+        // Register shift amounts only use as many bits as needed to shift by up to XLEN - 1
+        const auto shift_amount = x(instruction.rs2) & (XLen - 1);
+
+        // The funct7 bits that are part of the dispatch table index are known at compile time
+        const auto funct7 = (instruction.funct7 & ~DispatchFunct7Mask) | Funct7;
+        switch (funct7) {
             case 0b000'0000: {
-                switch (instruction.funct3) {
+                switch (Funct3) {
                     case 0b000: // ADD
                         x(instruction.rd) =
                            x(instruction.rs1) +
@@ -253,17 +621,17 @@ namespace ds::emu::riscv {
                     case 0b001: // SLL
                         x(instruction.rd) =
                             x(instruction.rs1) <<
-                            x(instruction.rs2);
+                            shift_amount;
                         return {};
                     case 0b101: // SRL
                         x(instruction.rd) =
                             x(instruction.rs1) >>
-                            x(instruction.rs2);
+                            shift_amount;
                         return {};
                     case 0b010: // SLT
                         x(instruction.rd) =
-                            static_cast<std::int32_t>(x(instruction.rs1)) <
-                            static_cast<std::int32_t>(x(instruction.rs2));
+                            static_cast<Signed>(x(instruction.rs1)) <
+                            static_cast<Signed>(x(instruction.rs2));
                         return {};
                     case 0b011: // SLTU
                         x(instruction.rd) =
@@ -290,98 +658,121 @@ namespace ds::emu::riscv {
                 }
             }
             case 0b000'0001: { // MULDIV
-                switch (instruction.funct3) {
-                    case 0b000: { // MUL
-                        const std::int64_t left  = static_cast<std::int32_t>(x(instruction.rs1));
-                        const std::int64_t right = static_cast<std::int32_t>(x(instruction.rs2));
-                        x(instruction.rd) = static_cast<std::uint64_t>(left * right) & util::mask<32>();
+                const T left  = x(instruction.rs1);
+                const T right = x(instruction.rs2);
+                switch (Funct3) {
+                    case 0b000: x(instruction.rd) = T(left * right); return {};                                // MUL
+                    case 0b001: x(instruction.rd) = multiply_high<T, true, true>(left, right); return {};      // MULH
+                    case 0b010: x(instruction.rd) = multiply_high<T, true, false>(left, right); return {};     // MULHSU
+                    case 0b011: x(instruction.rd) = multiply_high<T, false, false>(left, right); return {};    // MULHU
+                    case 0b100: x(instruction.rd) = divide(left, right, true, false); return {};               // DIV
+                    case 0b101: x(instruction.rd) = divide(left, right, false, false); return {};              // DIVU
+                    case 0b110: x(instruction.rd) = divide(left, right, true, true); return {};                // REM
+                    case 0b111: x(instruction.rd) = divide(left, right, false, true); return {};               // REMU
+                    default:    return std::unexpected(ExceptionCause::IllegalInstruction);
+                }
+            }
+            case 0b010'0000: {
+                switch (Funct3) {
+                    case 0b000: // SUB
+                        x(instruction.rd) =
+                           x(instruction.rs1) -
+                           x(instruction.rs2);
                         return {};
-                    }
-                    case 0b001: { // MULH
-                        const std::int64_t left  = static_cast<std::int32_t>(x(instruction.rs1));
-                        const std::int64_t right = static_cast<std::int32_t>(x(instruction.rs2));
-                        x(instruction.rd) = static_cast<std::uint64_t>(left * right) >> 32;
+                    case 0b101: // SRA
+                        x(instruction.rd) =
+                           static_cast<Signed>(x(instruction.rs1)) >>
+                           shift_amount;
                         return {};
-                    }
-                    case 0b010: { // MULHSU
-                        const std::int64_t  left  = static_cast<std::int32_t>(x(instruction.rs1));
-                        const std::uint64_t right = static_cast<std::uint32_t>(x(instruction.rs2));
-                        x(instruction.rd) = static_cast<std::uint64_t>(left * right) >> 32;
+                    case 0b111: // ANDN
+                        x(instruction.rd) =
+                           x(instruction.rs1) &
+                           ~x(instruction.rs2);
                         return {};
-                    }
-                    case 0b011: { // MULHU
-                        const std::uint64_t left  = static_cast<std::uint32_t>(x(instruction.rs1));
-                        const std::uint64_t right = static_cast<std::uint32_t>(x(instruction.rs2));
-                        x(instruction.rd) = static_cast<std::uint64_t>(left * right) >> 32;
+                    case 0b110: // ORN
+                        x(instruction.rd) =
+                           x(instruction.rs1) |
+                           ~x(instruction.rs2);
                         return {};
-                    }
-                    case 0b100: { // DIV
-                        const std::uint32_t left  = x(instruction.rs1);
-                        const std::uint32_t right = x(instruction.rs2);
-
-                        if (right == 0) {
-                            x(instruction.rd) = std::numeric_limits<std::uint32_t>::max();
-                        } else if (left == 0x8000'0000 and static_cast<std::int32_t>(right) == -1) {
-                            x(instruction.rd) = 0x80000000;
-                        } else {
-                            x(instruction.rd) = static_cast<std::int32_t>(left) / static_cast<std::int32_t>(right);
-                        }
-
+                    case 0b100: // XNOR
+                        x(instruction.rd) =
+                           ~(x(instruction.rs1) ^
+                             x(instruction.rs2));
                         return {};
-                    }
-                    case 0b101: { // DIVU
-                        const std::uint32_t left  = x(instruction.rs1);
-                        const std::uint32_t right = x(instruction.rs2);
-
-                        if (right == 0) {
-                            x(instruction.rd) = std::numeric_limits<std::uint32_t>::max();
-                        } else {
-                            x(instruction.rd) = left / right;
-                        }
-
+                    default:
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+                }
+            }
+            case 0b001'0000: { // Zba
+                switch (Funct3) {
+                    case 0b010: // SH1ADD
+                        x(instruction.rd) = (x(instruction.rs1) << 1) + x(instruction.rs2);
                         return {};
-                    }
-                    case 0b110: { // REM
-                        const std::uint32_t left  = x(instruction.rs1);
-                        const std::uint32_t right = x(instruction.rs2);
-
-                        if (right == 0) {
-                            x(instruction.rd) = left;
-                        } else if (left == 0x8000'0000 and static_cast<std::int32_t>(right) == -1) {
-                            x(instruction.rd) = 0;
-                        } else {
-                            x(instruction.rd) = static_cast<std::int32_t>(left) % static_cast<std::int32_t>(right);
-                        }
-
+                    case 0b100: // SH2ADD
+                        x(instruction.rd) = (x(instruction.rs1) << 2) + x(instruction.rs2);
                         return {};
-                    }
-                    case 0b111: { // REMU
-                        const std::uint32_t left  = x(instruction.rs1);
-                        const std::uint32_t right = x(instruction.rs2);
-
-                        if (right == 0) {
-                            x(instruction.rd) = left;
-                        } else {
-                            x(instruction.rd) = left % right;
-                        }
+                    case 0b110: // SH3ADD
+                        x(instruction.rd) = (x(instruction.rs1) << 3) + x(instruction.rs2);
+                        return {};
+                    default:
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+                }
+            }
+            case 0b000'0101: { // Zbb minimum / maximum
+                const T left  = x(instruction.rs1);
+                const T right = x(instruction.rs2);
+                switch (Funct3) {
+                    case 0b100: // MIN
+                        x(instruction.rd) = std::min(static_cast<Signed>(left), static_cast<Signed>(right));
+                        return {};
+                    case 0b101: // MINU
+                        x(instruction.rd) = std::min(left, right);
+                        return {};
+                    case 0b110: // MAX
+                        x(instruction.rd) = std::max(static_cast<Signed>(left), static_cast<Signed>(right));
+                        return {};
+                    case 0b111: // MAXU
+                        x(instruction.rd) = std::max(left, right);
+                        return {};
+                    default:
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+                }
+            }
+            case 0b000'0100: { // ZEXT.H, which is encoded as an OP_32 instruction on RV64
+                if (XLen == 64 || Funct3 != 0b100 || instruction.rs2 != 0)
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
 
+                x(instruction.rd) = x(instruction.rs1) & 0xFFFF;
+                return {};
+            }
+            case 0b011'0000: { // Zbb rotates
+                const T value = x(instruction.rs1);
+                const auto amount = int(shift_amount);
+                switch (Funct3) {
+                    case 0b001: // ROL
+                        x(instruction.rd) = std::rotl(value, amount);
+                        return {};
+                    case 0b101: // ROR
+                        x(instruction.rd) = std::rotr(value, amount);
                         return {};
-                    }
                     default:
                         return std::unexpected(ExceptionCause::IllegalInstruction);
                 }
             }
-            case 0b010'0000: {
-                switch (instruction.funct3) {
-                    case 0b000: // SUB
-                        x(instruction.rd) =
-                           x(instruction.rs1) -
-                           x(instruction.rs2);
+            case 0b001'0100: case 0b010'0100: case 0b011'0100: { // Zbs
+                const auto mask = T(1) << shift_amount;
+                switch (funct7 | (Funct3 << 7)) {
+                    case 0b001'001'0100: // BSET
+                        x(instruction.rd) = x(instruction.rs1) | mask;
                         return {};
-                    case 0b101: // SRA
-                        x(instruction.rd) =
-                           static_cast<std::int32_t>(x(instruction.rs1)) >>
-                           x(instruction.rs2);
+                    case 0b001'010'0100: // BCLR
+                        x(instruction.rd) = x(instruction.rs1) & ~mask;
+                        return {};
+                    case 0b101'010'0100: // BEXT
+                        x(instruction.rd) = (x(instruction.rs1) & mask) != 0;
+                        return {};
+                    case 0b001'011'0100: // BINV
+                        x(instruction.rd) = x(instruction.rs1) ^ mask;
                         return {};
                     default:
                         return std::unexpected(ExceptionCause::IllegalInstruction);
@@ -392,265 +783,439 @@ namespace ds::emu::riscv {
         }
     }
 
-    auto Core::handle_branch(const instr::base::type::B &instruction) -> std::expected<void, ExceptionCause> {
-        const auto branch_address = pc() + util::sign_extend<std::uint32_t, 13>(instruction.imm) - 4;
-        const bool unsigned_compare = util::extract_bits<1, 1>(instruction.funct3) == 0b1;
-        switch (instruction.funct3 & 0b101) {
+    // RV64 instructions operating on the lower 32 bits of their operands. Their results get sign extended to 64 bits
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_op_imm_32(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+        if constexpr (XLen == 32) {
+            return std::unexpected(ExceptionCause::UnimplementedInstruction);
+        } else {
+            const auto value = std::uint32_t(x(instruction.rs1));
+            const auto shamt = instruction.imm & 0b11111;
+            const auto funct7 = instruction.imm >> 5;
+
+            switch (instruction.funct3) {
+                case 0b000: // ADDIW
+                    x(instruction.rd) = util::sign_extend<T, 32>(value + std::uint32_t(util::sign_extend<std::uint32_t, 12>(instruction.imm)));
+                    return {};
+                case 0b001:
+                    switch (funct7) {
+                        case 0b000'0000: // SLLIW
+                            x(instruction.rd) = util::sign_extend<T, 32>(value << shamt);
+                            return {};
+                        case 0b000'0100: case 0b000'0101: // SLLI.UW, whose shift amount is 6 bits wide
+                            x(instruction.rd) = T(value) << (instruction.imm & 0b111111);
+                            return {};
+                        case 0b011'0000:
+                            switch (shamt) {
+                                case 0b00000: x(instruction.rd) = std::countl_zero(value); return {};  // CLZW
+                                case 0b00001: x(instruction.rd) = std::countr_zero(value); return {};  // CTZW
+                                case 0b00010: x(instruction.rd) = std::popcount(value); return {};     // CPOPW
+                                default:      return std::unexpected(ExceptionCause::IllegalInstruction);
+                            }
+                        default:
+                            return std::unexpected(ExceptionCause::IllegalInstruction);
+                    }
+                case 0b101:
+                    switch (funct7) {
+                        case 0b000'0000: // SRLIW
+                            x(instruction.rd) = util::sign_extend<T, 32>(value >> shamt);
+                            return {};
+                        case 0b010'0000: // SRAIW
+                            x(instruction.rd) = T(std::int32_t(value) >> shamt);
+                            return {};
+                        case 0b011'0000: // RORIW
+                            x(instruction.rd) = util::sign_extend<T, 32>(std::rotr(value, int(shamt)));
+                            return {};
+                        default:
+                            return std::unexpected(ExceptionCause::IllegalInstruction);
+                    }
+                default:
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
+            }
+        }
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_op_32(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause> {
+        if constexpr (XLen == 32) {
+            return std::unexpected(ExceptionCause::UnimplementedInstruction);
+        } else {
+            const auto left  = std::uint32_t(x(instruction.rs1));
+            const auto right = std::uint32_t(x(instruction.rs2));
+            const auto shift_amount = right & 0b11111;
+
+            std::uint32_t result;
+            switch (instruction.funct7 | (instruction.funct3 << 7)) {
+                case 0b000'000'0000: result = left + right; break;                                      // ADDW
+                case 0b000'010'0000: result = left - right; break;                                      // SUBW
+                case 0b001'000'0000: result = left << shift_amount; break;                              // SLLW
+                case 0b101'000'0000: result = left >> shift_amount; break;                              // SRLW
+                case 0b101'010'0000: result = std::uint32_t(std::int32_t(left) >> shift_amount); break; // SRAW
+                case 0b000'000'0001: result = left * right; break;                                      // MULW
+                case 0b100'000'0001: result = divide(left, right, true, false); break;                  // DIVW
+                case 0b101'000'0001: result = divide(left, right, false, false); break;                 // DIVUW
+                case 0b110'000'0001: result = divide(left, right, true, true); break;                   // REMW
+                case 0b111'000'0001: result = divide(left, right, false, true); break;                  // REMUW
+                case 0b001'011'0000: result = std::rotl(left, int(shift_amount)); break;                // ROLW
+                case 0b101'011'0000: result = std::rotr(left, int(shift_amount)); break;                // RORW
+
+                // Zba instructions on unsigned words, which zero extend rs1 and produce full width results
+                case 0b000'000'0100: x(instruction.rd) = T(left) + x(instruction.rs2); return {};         // ADD.UW
+                case 0b010'001'0000: x(instruction.rd) = (T(left) << 1) + x(instruction.rs2); return {};  // SH1ADD.UW
+                case 0b100'001'0000: x(instruction.rd) = (T(left) << 2) + x(instruction.rs2); return {};  // SH2ADD.UW
+                case 0b110'001'0000: x(instruction.rd) = (T(left) << 3) + x(instruction.rs2); return {};  // SH3ADD.UW
+
+                case 0b100'000'0100: // ZEXT.H
+                    if (instruction.rs2 != 0)
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    x(instruction.rd) = left & 0xFFFF;
+                    return {};
+                default:
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
+            }
+
+            x(instruction.rd) = util::sign_extend<T, 32>(result);
+            return {};
+        }
+    }
+
+    template<std::unsigned_integral T>
+    template<std::uint32_t Funct3>
+    auto BasicCore<T>::handle_branch(const instr::base::type::B &instruction) -> std::expected<void, ExceptionCause> {
+        const T branch_address = pc() + util::sign_extend<T, 13>(instruction.imm) - m_instruction_length;
+        const bool unsigned_compare = util::extract_bits<1, 1>(Funct3) == 0b1;
+
+        bool taken;
+        switch (Funct3 & 0b101) {
             case 0b000: // BEQ
-                if (x(instruction.rs1) == x(instruction.rs2))
-                    pc() = branch_address;
-                return {};
+                taken = x(instruction.rs1) == x(instruction.rs2);
+                break;
             case 0b001: // BNE
-                if (x(instruction.rs1) != x(instruction.rs2))
-                    pc() = branch_address;
-                return {};
+                taken = x(instruction.rs1) != x(instruction.rs2);
+                break;
             case 0b100: // BLT / BLTU
-                if (unsigned_compare) {
-                    if (x(instruction.rs1) < x(instruction.rs2))
-                        pc() = branch_address;
-                } else {
-                    if (static_cast<std::int32_t>(x(instruction.rs1)) < static_cast<std::int32_t>(x(instruction.rs2)))
-                        pc() = branch_address;
-                }
-
-                return {};
+                if (unsigned_compare)
+                    taken = x(instruction.rs1) < x(instruction.rs2);
+                else
+                    taken = static_cast<Signed>(x(instruction.rs1)) < static_cast<Signed>(x(instruction.rs2));
+                break;
             case 0b101: // BGE / BGEU
-                if (unsigned_compare) {
-                    if (x(instruction.rs1) >= x(instruction.rs2))
-                        pc() = branch_address;
-                } else {
-                    if (static_cast<std::int32_t>(x(instruction.rs1)) >= static_cast<std::int32_t>(x(instruction.rs2)))
-                        pc() = branch_address;
-                }
-
-                return {};
+                if (unsigned_compare)
+                    taken = x(instruction.rs1) >= x(instruction.rs2);
+                else
+                    taken = static_cast<Signed>(x(instruction.rs1)) >= static_cast<Signed>(x(instruction.rs2));
+                break;
             default:
                 return std::unexpected(ExceptionCause::IllegalInstruction);
         }
+
+        if (taken) {
+            pc() = branch_address;
+            m_statistics.taken_branches += 1;
+        }
+
+        return {};
     }
 
-    auto Core::handle_misc_mem(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_misc_mem(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
         switch (instruction.funct3) {
             case 0b000: // FENCE
             case 0b001: // FENCE.I
                 // Nothing to do here
                 return {};
+            case 0b010: // CBO
+                return handle_cache_block_operation(instruction);
             default:
                 return std::unexpected(ExceptionCause::IllegalInstruction);
         }
     }
 
-    auto Core::handle_amo(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause> {
-        switch (instruction.funct3) {
-            case 0b010: { // RV32A
-                const auto rl    = util::extract_bits<0, 0>(instruction.funct7);
-                const auto aq    = util::extract_bits<1, 1>(instruction.funct7);
-                const auto funct5 = util::extract_bits<2, 5>(instruction.funct7);
-
-                std::ignore = rl;
-                std::ignore = aq;
-
-                const std::uint32_t address = x(instruction.rs1);
-                const std::uint32_t value   = x(instruction.rs2);
-                switch (funct5) {
-                    case 0b00010: { // LR.W
-                        if (address % 4 != 0)
-                            return std::unexpected(ExceptionCause::LoadMisalign);
-
-                        const auto result = read<std::uint32_t>(address);
-                        if (!result.has_value())
-                            return std::unexpected(result.error());
-
-                        const auto physical_address = m_address_space->translate_address(*this, address, AccessType::Load);
-                        if (!physical_address.has_value()) {
-                            switch (physical_address.error()) {
-                                using enum AccessResult;
-                                default:
-                                case LoadAccessFault: return std::unexpected(ExceptionCause::LoadFault);
-                                case LoadPageFault: return std::unexpected(ExceptionCause::LoadPageFault);
-                            }
-                        }
-
-                        this->m_lr_reservation = *physical_address | 0b1;
-                        x(instruction.rd) = *result;
-
-                        return {};
-                    }
-                    case 0b00011: { // SC.W
-                        if (address % 4 != 0)
-                            return std::unexpected(ExceptionCause::StoreMisalign);
-
-                        x(instruction.rd) = 1;
-
-                        const auto physical_address = m_address_space->translate_address(*this, address, AccessType::Store);
-                        if (!physical_address.has_value()) {
-                            switch (physical_address.error()) {
-                                using enum AccessResult;
-                                default:
-                                case LoadAccessFault: return std::unexpected(ExceptionCause::StoreFault);
-                                case LoadPageFault: return std::unexpected(ExceptionCause::StorePageFault);
-                            }
-                        }
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_cache_block_operation(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+        constexpr static std::array<std::uint8_t, CacheBlockSize> ZeroBlock = { };
+
+        if (instruction.rd != 0)
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        // senvcfg decides which operations user mode may execute
+        const auto allowed = [this](std::uint32_t enable_mask) {
+            return m_privilege_level != PrivilegeLevel::User || (senvcfg() & enable_mask) != 0;
+        };
+
+        const T address = x(instruction.rs1) & ~T(CacheBlockSize - 1);
+        switch (instruction.imm) {
+            case 0b000: // CBO.INVAL
+            case 0b001: // CBO.CLEAN
+            case 0b010: { // CBO.FLUSH
+                const auto enable_mask = instruction.imm == 0b000 ? util::mask<2>() << 4 : util::bit<6>();
+                if (!allowed(enable_mask))
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
 
-                        if (m_lr_reservation != (*physical_address | 0b1))
-                            return {};
+                // There are no caches to manage, the block only needs to be accessible
+                if (!m_address_space->translate_address(*this, address, AccessType::Load).has_value()) [[unlikely]] {
+                    stval() = x(instruction.rs1);
+                    return std::unexpected(ExceptionCause::StorePageFault);
+                }
 
-                        const auto result = write<std::uint32_t>(address, value);
-                        if (!result.has_value())
-                            return std::unexpected(result.error());
+                return {};
+            }
+            case 0b100: { // CBO.ZERO
+                if (!allowed(util::bit<7>()))
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
 
-                        // TODO: Needs to be cleared on all harts that match the address
-                        if ((m_lr_reservation & 0b1) and (m_lr_reservation & ~0b11) == (*physical_address & ~0b11))
-                            m_lr_reservation = 0;
-                        x(instruction.rd) = 0;
+                // Blocks are aligned to their size so they never cross a page and can be cleared with a single write
+                const auto physical_address = m_address_space->translate_address(*this, address, AccessType::Store);
+                if (!physical_address.has_value()) [[unlikely]] {
+                    stval() = x(instruction.rs1);
+                    return std::unexpected(ExceptionCause::StorePageFault);
+                }
 
-                        return {};
-                    }
-                    case 0b00001: { // AMOSWAP.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+                const auto entry = m_address_space->get(*physical_address);
+                if (entry == nullptr || *physical_address - entry->base_address + CacheBlockSize > entry->peripheral->size()) [[unlikely]] {
+                    stval() = x(instruction.rs1);
+                    return std::unexpected(ExceptionCause::StoreFault);
+                }
 
-                        if (const auto write_result = write<std::uint32_t>(address, value); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+                if (m_address_space->write_physical(*physical_address, ZeroBlock) != AccessResult::Success) [[unlikely]] {
+                    stval() = x(instruction.rs1);
+                    return std::unexpected(ExceptionCause::StoreFault);
+                }
 
-                        x(instruction.rd) = *read_result;
-                        return {};
-                    }
-                    case 0b00000: { // AMOADD.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+                return {};
+            }
+            default:
+                return std::unexpected(ExceptionCause::IllegalInstruction);
+        }
+    }
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, *read_result +value); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+    template<std::unsigned_integral T>
+    template<std::uint32_t Funct3>
+    auto BasicCore<T>::handle_amo(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause> {
+        switch (Funct3) {
+            case 0b010: // RV32A
+                return handle_atomic<std::uint32_t>(instruction);
+            case 0b011: // RV64A
+                if constexpr (XLen == 64)
+                    return handle_atomic<std::uint64_t>(instruction);
+                else
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
+            default:
+                return std::unexpected(ExceptionCause::IllegalInstruction);
+        }
+    }
 
-                        return {};
-                    }
-                    case 0b00100: { // AMOXOR.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+    template<std::unsigned_integral T>
+    template<std::unsigned_integral Data>
+    auto BasicCore<T>::handle_atomic(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause> {
+        using SignedData = std::make_signed_t<Data>;
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, *read_result ^ value); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+        const auto rl    = util::extract_bits<0, 0>(instruction.funct7);
+        const auto aq    = util::extract_bits<1, 1>(instruction.funct7);
+        const auto funct5 = util::extract_bits<2, 6>(instruction.funct7);
 
-                        return {};
-                    }
-                    case 0b01100: { // AMOAND.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+        std::ignore = rl;
+        std::ignore = aq;
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, *read_result & value); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+        const T address     = x(instruction.rs1);
+        const Data value    = x(instruction.rs2);
 
-                        return {};
-                    }
-                    case 0b01000: { // AMOOR.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+        // Words loaded on RV64 get sign extended
+        const auto result_value = [](Data data) -> T {
+            return static_cast<T>(static_cast<SignedData>(data));
+        };
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, *read_result | value); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+        // LR, SC and AMOs always need to be aligned, even when other accesses may be misaligned
+        if (address % sizeof(Data) != 0) [[unlikely]] {
+            stval() = address;
+            return std::unexpected(funct5 == 0b00010 ? ExceptionCause::LoadMisalign : ExceptionCause::StoreMisalign);
+        }
 
-                        return {};
+        switch (funct5) {
+            case 0b00010: { // LR
+                // Translated once, the reservation is taken on the same physical address that gets read
+                const auto physical_address = m_address_space->translate_address(*this, address, AccessType::Load);
+                if (!physical_address.has_value()) {
+                    stval() = address;
+                    switch (physical_address.error()) {
+                        using enum AccessResult;
+                        default:
+                        case LoadAccessFault: return std::unexpected(ExceptionCause::LoadFault);
+                        case LoadPageFault: return std::unexpected(ExceptionCause::LoadPageFault);
                     }
-                    case 0b10000: { // AMOMIN.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+                }
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, std::min<std::int32_t>(*read_result, value)); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+                Data data;
+                switch (m_address_space->read_physical(*physical_address, util::to_byte_span(data))) {
+                    using enum AccessResult;
+                    case Success: break;
 
-                        return {};
-                    }
-                    case 0b10100: { // AMOMAX.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+                    default:
+                    case LoadAccessFault: stval() = address; return std::unexpected(ExceptionCause::LoadFault);
+                    case LoadPageFault:   stval() = address; return std::unexpected(ExceptionCause::LoadPageFault);
+                }
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, std::max<std::int32_t>(*read_result, value)); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+                this->m_lr_reservation = *physical_address | 0b1;
+                x(instruction.rd) = result_value(data);
 
-                        return {};
+                return {};
+            }
+            case 0b00011: { // SC
+                x(instruction.rd) = 1;
+
+                const auto physical_address = m_address_space->translate_address(*this, address, AccessType::Store);
+                if (!physical_address.has_value()) {
+                    stval() = address;
+                    switch (physical_address.error()) {
+                        using enum AccessResult;
+                        default:
+                        case LoadAccessFault: return std::unexpected(ExceptionCause::StoreFault);
+                        case LoadPageFault: return std::unexpected(ExceptionCause::StorePageFault);
                     }
-                    case 0b11000: { // AMOMINU.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+                }
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, std::min<std::uint32_t>(*read_result, value)); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+                if (m_lr_reservation != (*physical_address | 0b1))
+                    return {};
 
-                        return {};
-                    }
-                    case 0b11100: { // AMOMAXU.W
-                        const auto read_result = read<std::uint32_t>(address);
-                        if (!read_result.has_value())
-                            return std::unexpected(read_result.error());
+                const auto result = write<Data>(address, value);
+                if (!result.has_value())
+                    return std::unexpected(result.error());
 
-                        x(instruction.rd) = *read_result;
-                        if (const auto write_result = write<std::uint32_t>(address, std::max<std::uint32_t>(*read_result, value)); !write_result.has_value())
-                            return std::unexpected(write_result.error());
+                // TODO: Needs to be cleared on all harts that match the address
+                if ((m_lr_reservation & 0b1) and (m_lr_reservation & ~T(0b11)) == (*physical_address & ~T(0b11)))
+                    m_lr_reservation = 0;
+                x(instruction.rd) = 0;
 
-                        return {};
-                    }
-                    default:
-                        return std::unexpected(ExceptionCause::IllegalInstruction);
-                }
+                return {};
             }
+            case 0b00001: case 0b00000: case 0b00100: case 0b01100: case 0b01000:     // Read-modify-write operations
+            case 0b10000: case 0b10100: case 0b11000: case 0b11100:
+                break;
             default:
                 return std::unexpected(ExceptionCause::IllegalInstruction);
         }
+
+        const auto read_result = read<Data>(address);
+        if (!read_result.has_value())
+            return std::unexpected(read_result.error());
+
+        const Data old_value = *read_result;
+        Data new_value;
+        switch (funct5) {
+            case 0b00001: new_value = value; break;                                                                 // AMOSWAP
+            case 0b00000: new_value = old_value + value; break;                                                     // AMOADD
+            case 0b00100: new_value = old_value ^ value; break;                                                     // AMOXOR
+            case 0b01100: new_value = old_value & value; break;                                                     // AMOAND
+            case 0b01000: new_value = old_value | value; break;                                                     // AMOOR
+            case 0b10000: new_value = std::min<SignedData>(old_value, value); break;                                // AMOMIN
+            case 0b10100: new_value = std::max<SignedData>(old_value, value); break;                                // AMOMAX
+            case 0b11000: new_value = std::min(old_value, value); break;                                            // AMOMINU
+            case 0b11100: new_value = std::max(old_value, value); break;                                            // AMOMAXU
+            default:      std::unreachable();
+        }
+
+        if (const auto write_result = write<Data>(address, new_value); !write_result.has_value())
+            return std::unexpected(write_result.error());
+
+        x(instruction.rd) = result_value(old_value);
+        return {};
     }
 
-    auto Core::handle_unimplemented(std::uint32_t instruction) -> std::expected<void, ExceptionCause> {
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_unimplemented(std::uint32_t instruction) -> std::expected<void, ExceptionCause> {
         std::ignore = instruction;
         return std::unexpected(ExceptionCause::UnimplementedInstruction);
     }
 
-    auto Core::handle_std_instructions(std::uint32_t instruction) -> std::expected<void, ExceptionCause> {
-        constexpr static auto Instructions = jumpTable<2, 6,
-            Entry<instr::base::LOAD,        &Core::handle_load>,
-            Entry<instr::base::STORE,       &Core::handle_store>,
-            Entry<instr::base::MADD,        &Core::handle_unimplemented>,
-            Entry<instr::base::BRANCH,      &Core::handle_branch>,
-            Entry<instr::base::LOAD_FP,     &Core::handle_unimplemented>,
-            Entry<instr::base::STORE_FP,    &Core::handle_unimplemented>,
-            Entry<instr::base::MSUB,        &Core::handle_unimplemented>,
-            Entry<instr::base::JALR,        &Core::handle_jalr>,
-            Entry<instr::base::NMSUB,       &Core::handle_unimplemented>,
-            Entry<instr::base::MISC_MEM,    &Core::handle_misc_mem>,
-            Entry<instr::base::AMO,         &Core::handle_amo>,
-            Entry<instr::base::NMADD,       &Core::handle_unimplemented>,
-            Entry<instr::base::JAL,         &Core::handle_jal>,
-            Entry<instr::base::OP_IMM,      &Core::handle_op_imm>,
-            Entry<instr::base::OP,          &Core::handle_op>,
-            Entry<instr::base::OP_FP,       &Core::handle_unimplemented>,
-            Entry<instr::base::SYSTEM,      &Core::handle_system>,
-            Entry<instr::base::AUIPC,       &Core::handle_auipc>,
-            Entry<instr::base::LUI,         &Core::handle_lui>,
-            Entry<instr::base::OP_IMM_32,   &Core::handle_unimplemented>,
-            Entry<instr::base::OP_32,       &Core::handle_unimplemented>
+    template<std::unsigned_integral T>
+    template<std::size_t Index>
+    constexpr auto BasicCore<T>::specialized_handler() -> HandlerFunction {
+        constexpr auto Opcode = std::uint32_t(Index & 0b1'1111);
+        constexpr auto Funct3 = std::uint32_t((Index >> 5) & 0b111);
+        constexpr auto Funct7 = std::uint32_t(((Index >> 8) & 0b1) | (((Index >> 9) & 0b1) << 5));
+
+        if constexpr (Opcode == instr::base::LOAD::Value)
+            return &BasicCore::decode_instruction<Entry<instr::base::LOAD, &BasicCore::handle_load<Funct3>>>;
+        else if constexpr (Opcode == instr::base::STORE::Value)
+            return &BasicCore::decode_instruction<Entry<instr::base::STORE, &BasicCore::handle_store<Funct3>>>;
+        else if constexpr (Opcode == instr::base::BRANCH::Value)
+            return &BasicCore::decode_instruction<Entry<instr::base::BRANCH, &BasicCore::handle_branch<Funct3>>>;
+        else if constexpr (Opcode == instr::base::AMO::Value)
+            return &BasicCore::decode_instruction<Entry<instr::base::AMO, &BasicCore::handle_amo<Funct3>>>;
+        else if constexpr (Opcode == instr::base::OP_IMM::Value)
+            return &BasicCore::decode_instruction<Entry<instr::base::OP_IMM, &BasicCore::handle_op_imm<Funct3>>>;
+        else if constexpr (Opcode == instr::base::OP::Value)
+            return &BasicCore::decode_instruction<Entry<instr::base::OP, &BasicCore::handle_op<Funct3, Funct7>>>;
+        else
+            return nullptr;
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_std_instructions(std::uint32_t instruction) -> std::expected<void, ExceptionCause> {
+        // LOAD, STORE, BRANCH, AMO, OP_IMM and OP are dispatched to their specialized handlers
+        constexpr static auto Instructions = flatJumpTable<
+            Entry<instr::base::MADD,        &BasicCore::handle_fused_multiply_add>,
+            Entry<instr::base::LOAD_FP,     &BasicCore::handle_load_fp>,
+            Entry<instr::base::STORE_FP,    &BasicCore::handle_store_fp>,
+            Entry<instr::base::MSUB,        &BasicCore::handle_fused_multiply_add>,
+            Entry<instr::base::JALR,        &BasicCore::handle_jalr>,
+            Entry<instr::base::NMSUB,       &BasicCore::handle_fused_multiply_add>,
+            Entry<instr::base::MISC_MEM,    &BasicCore::handle_misc_mem>,
+            Entry<instr::base::NMADD,       &BasicCore::handle_fused_multiply_add>,
+            Entry<instr::base::JAL,         &BasicCore::handle_jal>,
+            Entry<instr::base::OP_FP,       &BasicCore::handle_op_fp>,
+            Entry<instr::base::SYSTEM,      &BasicCore::handle_system>,
+            Entry<instr::base::AUIPC,       &BasicCore::handle_auipc>,
+            Entry<instr::base::LUI,         &BasicCore::handle_lui>,
+            Entry<instr::base::OP_IMM_32,   &BasicCore::handle_op_imm_32>,
+            Entry<instr::base::OP_32,       &BasicCore::handle_op_32>
         >();
 
+        m_statistics.opcodes[util::extract_bits<2, 6>(instruction)] += 1;
         const auto result = Instructions(this, instruction);
 
-        pc() += 4;
+        pc() += m_instruction_length;
+
+        return result;
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_compressed(std::uint32_t instruction) -> std::expected<void, ExceptionCause> {
+        const auto expanded = instr::compressed::expand<XLen>(std::uint16_t(instruction));
+        if (expanded == 0) [[unlikely]]
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        // The expanded instruction behaves exactly like the compressed one, except for the pc being only 2 bytes ahead
+        m_instruction_length = 2;
+        const auto result = handle_std_instructions(expanded);
+        m_instruction_length = 4;
 
         return result;
     }
 
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::fetch_instruction() -> std::expected<std::uint32_t, ExceptionCause> {
+        const T address = pc();
+
+        // An aligned word never crosses a page, compressed instructions just ignore the upper half
+        if (address % 4 == 0) [[likely]]
+            return fetch<std::uint32_t>(address);
+
+        // Otherwise a full size instruction may straddle two pages, so fetch both halves separately
+        const auto low = fetch<std::uint16_t>(address);
+        if (!low.has_value()) [[unlikely]]
+            return std::unexpected(low.error());
+        if ((*low & 0b11) != 0b11)
+            return *low;
+
+        const auto high = fetch<std::uint16_t>(address + 2);
+        if (!high.has_value()) [[unlikely]]
+            return std::unexpected(high.error());
+
+        return *low | (std::uint32_t(*high) << 16);
+    }
+
     constexpr auto highest_priority_supervisor_interrupt(uint64_t pending_mask) -> std::optional<std::uint32_t> {
         constexpr uint64_t SSIP = util::bit<1>();
         constexpr uint64_t STIP = util::bit<5>();
@@ -665,7 +1230,8 @@ namespace ds::emu::riscv {
         return -1;
     }
 
-    auto Core::handle_interrupts() -> void {
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_interrupts() -> void {
         const auto pending = sip() & sie();
         if (!pending) [[likely]]
             return;
@@ -673,11 +1239,15 @@ namespace ds::emu::riscv {
         const auto delegated = pending & mideleg(); // interrupts delegated to Supervisor by Machine
         const auto not_delegated = pending & ~mideleg();
 
-        m_powered_up = true;
+        if (!m_powered_up) {
+            // Waking up from WFI doesn't require the interrupt to be taken
+            m_powered_up = true;
+            update_interrupt_pending();
+        }
 
         if (delegated) {
-            // Check S-mode global interrupt enable (sstatus.SIE)
-            if (!sstatus().get_bit(1)) {
+            // Check S-mode global interrupt enable (sstatus.SIE), which only applies while running in S-mode
+            if (m_privilege_level == PrivilegeLevel::Supervisor && !sstatus().get_bit(1)) {
                 // Supervisor interrupts are globally disabled; do nothing.
                 return;
             }
@@ -690,10 +1260,12 @@ namespace ds::emu::riscv {
             const auto interrupt_index = std::countr_zero(pending);
 
             // Set interrupt bit
-            scause() = util::bit<31>() | interrupt_index;
+            scause() = util::bit<XLen - 1, T>() | interrupt_index;
             stval() = 0;
             trap();
 
+            m_statistics.interrupts[interrupt_index] += 1;
+
             return;
         }
 
@@ -702,7 +1274,8 @@ namespace ds::emu::riscv {
         }
     }
 
-    auto Core::trap() -> void {
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::trap() -> void {
         // Set SSTATUS.SPIE to SSTATUS.SIE
         sstatus().set_bit(5, sstatus().get_bit(1));
 
@@ -715,11 +1288,9 @@ namespace ds::emu::riscv {
         // Disable interrupts
         sstatus().set_bit(1, false);
 
-        // Invalidate MMU
-        m_address_space->invalidate();
-
         // Enter supervisor mode
         m_privilege_level = PrivilegeLevel::Supervisor;
+        update_interrupt_pending();
 
         // Jump to the supervisor interrupt vector address
         {
@@ -728,33 +1299,50 @@ namespace ds::emu::riscv {
 
             pc() = base;
             if (mode == 0b01) {
-                pc() += (scause() & util::mask<31>()) * 4;
+                pc() += (scause() & util::mask<XLen - 1, T>()) * 4;
             }
         }
     }
 
-    auto Core::step() -> std::expected<void, ExceptionCause> {
-        const std::uint32_t start_pc = pc();
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::step() -> std::expected<void, ExceptionCause> {
+        const T start_pc = pc();
         constexpr static auto Instructions = jumpTable<0, 1,
-            Entry<instr::base::Quadrant, &Core::handle_std_instructions>
+            Entry<instr::compressed::C0,    &BasicCore::handle_compressed>,
+            Entry<instr::compressed::C1,    &BasicCore::handle_compressed>,
+            Entry<instr::compressed::C2,    &BasicCore::handle_compressed>,
+            Entry<instr::base::Quadrant,    &BasicCore::handle_std_instructions>
         >();
 
-        handle_interrupts();
+        m_statistics.cycles += 1;
+        if (m_interrupt_pending) [[unlikely]]
+            handle_interrupts();
 
-        if (!m_powered_up)
+        if (!m_powered_up) {
+            m_statistics.idle_steps += 1;
             return {};
+        }
+
+        // Only one hart accesses the address space at a time, so all device accesses made during this step are its own
+        const auto device_accesses = m_address_space->device_accesses();
 
         std::expected<void, ExceptionCause> result;
-        const auto instruction = fetch<std::uint32_t>(pc());
+        const auto instruction = fetch_instruction();
         if (instruction.has_value()) [[likely]] {
             result = Instructions(this, *instruction);
         } else {
             result = std::unexpected(instruction.error());
         }
 
-        if (!result.has_value()) {
+        m_statistics.mmio_accesses += m_address_space->device_accesses() - device_accesses;
+
+        if (result.has_value()) [[likely]] {
+            m_statistics.instructions_retired += 1;
+        } else {
             const auto exception = result.error();
-            scause() = static_cast<std::uint32_t>(exception);
+            m_statistics.exceptions[std::to_underlying(exception)] += 1;
+
+            scause() = static_cast<T>(exception);
             switch (exception) {
                 using enum ExceptionCause;
                 case ECallSupervisor: // ECALL from Supervisor mode, delegate it to machine mode
@@ -765,7 +1353,7 @@ namespace ds::emu::riscv {
 
                     break;
                 case UnimplementedInstruction: // Treat unimplemented instructions the same as illegal instructions
-                    scause() = static_cast<std::uint32_t>(IllegalInstruction);
+                    scause() = static_cast<T>(IllegalInstruction);
                     break;
                 case Breakpoint:
                     scause() = 0;
@@ -793,4 +1381,51 @@ namespace ds::emu::riscv {
         return result;
     }
 
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::save_state(StateWriter &writer) const -> void {
+        for (const auto &reg : m_registers) {
+            writer.write(reg.get());
+        }
+        writer.write(m_fp_registers);
+        for (const auto &csr : m_csrs) {
+            writer.write(csr.get());
+        }
+
+        writer.write(m_program_counter.get());
+        writer.write(m_lr_reservation);
+        writer.write(m_privilege_level);
+        writer.write(m_powered_up);
+
+        // The statistics counters are based on aren't part of the state, only their current values are
+        writer.write(m_stopped_counters);
+        for (std::size_t i = 0; i < CounterCount; i += 1) {
+            writer.write(counter(Counter(i)));
+        }
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::load_state(StateReader &reader) -> void {
+        for (auto &reg : m_registers) {
+            reg = reader.read<T>();
+        }
+        m_fp_registers = reader.read<decltype(m_fp_registers)>();
+        for (auto &csr : m_csrs) {
+            csr = reader.read<T>();
+        }
+
+        m_program_counter = reader.read<T>();
+        m_lr_reservation  = reader.read<T>();
+        m_privilege_level = reader.read<PrivilegeLevel>();
+        m_powered_up      = reader.read<bool>();
+        update_interrupt_pending();
+
+        m_stopped_counters = reader.read<std::uint32_t>();
+        for (std::size_t i = 0; i < CounterCount; i += 1) {
+            set_counter(Counter(i), reader.read<std::uint64_t>());
+        }
+    }
+
+    template class BasicCore<std::uint32_t>;
+    template class BasicCore<std::uint64_t>;
+
 }
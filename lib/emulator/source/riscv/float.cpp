@@ -0,0 +1,554 @@
+#include <emu/riscv/core.hpp>
+#include <emu/riscv/instructions.hpp>
+
+#include <bit>
+#include <cfenv>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace ds::emu::riscv {
+
+    namespace {
+
+        enum RoundingMode : std::uint8_t {
+            NearestEven         = 0b000,
+            TowardsZero         = 0b001,
+            Down                = 0b010,
+            Up                  = 0b011,
+            NearestMaxMagnitude = 0b100,
+            Dynamic             = 0b111
+        };
+
+        enum ExceptionFlag : std::uint32_t {
+            Inexact         = 1 << 0,
+            Underflow       = 1 << 1,
+            Overflow        = 1 << 2,
+            DivideByZero    = 1 << 3,
+            Invalid         = 1 << 4
+        };
+
+        enum Format : std::uint8_t {
+            Single = 0b00,
+            Double = 0b01
+        };
+
+        constexpr std::uint32_t CanonicalNaN32 = 0x7FC0'0000;
+        constexpr std::uint64_t CanonicalNaN64 = 0x7FF8'0000'0000'0000;
+        constexpr std::uint64_t NaNBox = 0xFFFF'FFFF'0000'0000;
+
+        template<typename T>
+        using Bits = std::conditional_t<std::is_same_v<T, float>, std::uint32_t, std::uint64_t>;
+
+        template<typename T>
+        constexpr auto canonical_nan() -> T {
+            if constexpr (std::is_same_v<T, float>)
+                return std::bit_cast<float>(CanonicalNaN32);
+            else
+                return std::bit_cast<double>(CanonicalNaN64);
+        }
+
+        template<typename T>
+        constexpr auto is_signaling_nan(T value) -> bool {
+            constexpr auto QuietBit = Bits<T>(1) << (std::numeric_limits<T>::digits - 2);
+            return std::isnan(value) && (std::bit_cast<Bits<T>>(value) & QuietBit) == 0;
+        }
+
+        // Results that are NaN are always the canonical NaN, the host would propagate payloads instead
+        template<typename T>
+        constexpr auto canonicalize(T value) -> T {
+            return std::isnan(value) ? canonical_nan<T>() : value;
+        }
+
+        // Passing a value through a volatile keeps the compiler from moving the computation using it across
+        // the accesses to the host floating point environment, which it otherwise considers unrelated
+        template<typename T>
+        auto launder(T value) -> T {
+            volatile T result = value;
+            return result;
+        }
+
+        auto get_host_rounding_mode(std::uint8_t rounding_mode) -> int {
+            switch (rounding_mode) {
+                case TowardsZero:   return FE_TOWARDZERO;
+                case Down:          return FE_DOWNWARD;
+                case Up:            return FE_UPWARD;
+
+                // The host can't round ties away from zero in hardware, nearest even is the closest it can do
+                default:            return FE_TONEAREST;
+            }
+        }
+
+        auto get_raised_exceptions() -> std::uint32_t {
+            const auto raised = std::fetestexcept(FE_ALL_EXCEPT);
+
+            std::uint32_t flags = 0;
+            if (raised & FE_INEXACT)    flags |= Inexact;
+            if (raised & FE_UNDERFLOW)  flags |= Underflow;
+            if (raised & FE_OVERFLOW)   flags |= Overflow;
+            if (raised & FE_DIVBYZERO)  flags |= DivideByZero;
+            if (raised & FE_INVALID)    flags |= Invalid;
+
+            return flags;
+        }
+
+        // Runs an operation on the host FPU using the given rounding mode and collects the exceptions it raised
+        template<typename Result, typename ... Args>
+        auto compute(std::uint8_t rounding_mode, std::uint32_t &flags, auto operation, Args ... args) -> Result {
+            // Nearly everything uses the default rounding mode, only pay for switching it when needed
+            const auto host_rounding_mode = get_host_rounding_mode(rounding_mode);
+            if (host_rounding_mode != FE_TONEAREST) [[unlikely]]
+                std::fesetround(host_rounding_mode);
+
+            std::feclearexcept(FE_ALL_EXCEPT);
+            const Result result = launder<Result>(operation(launder(args)...));
+            flags |= get_raised_exceptions();
+
+            if (host_rounding_mode != FE_TONEAREST) [[unlikely]]
+                std::fesetround(FE_TONEAREST);
+
+            return result;
+        }
+
+        template<typename T>
+        auto minimum_maximum(T left, T right, bool maximum, std::uint32_t &flags) -> T {
+            if (is_signaling_nan(left) || is_signaling_nan(right))
+                flags |= Invalid;
+
+            if (std::isnan(left) && std::isnan(right))
+                return canonical_nan<T>();
+            if (std::isnan(left))
+                return right;
+            if (std::isnan(right))
+                return left;
+
+            // -0.0 is considered smaller than +0.0
+            if (left == right)
+                return std::signbit(left) == maximum ? right : left;
+
+            return (left < right) == maximum ? right : left;
+        }
+
+        template<typename T>
+        auto compare(T left, T right, std::uint8_t funct3, std::uint32_t &flags) -> std::optional<bool> {
+            switch (funct3) {
+                case 0b010: // FEQ, quiet comparison
+                    if (is_signaling_nan(left) || is_signaling_nan(right))
+                        flags |= Invalid;
+                    return left == right;
+                case 0b001: // FLT, signaling comparison
+                    if (std::isnan(left) || std::isnan(right)) {
+                        flags |= Invalid;
+                        return false;
+                    }
+                    return left < right;
+                case 0b000: // FLE, signaling comparison
+                    if (std::isnan(left) || std::isnan(right)) {
+                        flags |= Invalid;
+                        return false;
+                    }
+                    return left <= right;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        template<typename T>
+        auto classify(T value) -> std::uint32_t {
+            const bool negative = std::signbit(value);
+            switch (std::fpclassify(value)) {
+                case FP_INFINITE:   return negative ? 1U << 0 : 1U << 7;
+                case FP_NORMAL:     return negative ? 1U << 1 : 1U << 6;
+                case FP_SUBNORMAL:  return negative ? 1U << 2 : 1U << 5;
+                case FP_ZERO:       return negative ? 1U << 3 : 1U << 4;
+                default:            return is_signaling_nan(value) ? 1U << 8 : 1U << 9;
+            }
+        }
+
+        // Out of range values and NaNs saturate and raise the invalid exception instead of being undefined like on the host
+        template<typename Integer>
+        auto convert_to_integer(double value, std::uint8_t rounding_mode, std::uint32_t &flags) -> Integer {
+            if (std::isnan(value)) {
+                flags |= Invalid;
+                return std::numeric_limits<Integer>::max();
+            }
+
+            std::uint32_t ignored_flags = 0;
+            const double rounded = rounding_mode == NearestMaxMagnitude
+                ? std::round(value)
+                : compute<double>(rounding_mode, ignored_flags, [](double operand) { return std::nearbyint(operand); }, value);
+
+            // The maximum of 64 bit integers isn't representable as a double, compare against the power of two above it instead
+            if (rounded < double(std::numeric_limits<Integer>::min())) {
+                flags |= Invalid;
+                return std::numeric_limits<Integer>::min();
+            }
+            if (rounded >= std::ldexp(1.0, std::numeric_limits<Integer>::digits)) {
+                flags |= Invalid;
+                return std::numeric_limits<Integer>::max();
+            }
+
+            if (rounded != value)
+                flags |= Inexact;
+
+            return Integer(rounded);
+        }
+
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::is_fpu_enabled() -> bool {
+        return util::extract_bits<13, 14>(sstatus().get()) != 0b00;
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::mark_fp_state_dirty() -> void {
+        // FS = Dirty, which is summarized in SD
+        sstatus() |= T(0b11 << 13) | StatusStateDirty;
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::accrue_fp_exceptions(std::uint32_t flags) -> void {
+        if (flags == 0) [[likely]]
+            return;
+
+        fcsr() |= flags;
+        mark_fp_state_dirty();
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::get_rounding_mode(std::uint8_t rounding_mode) -> std::optional<std::uint8_t> {
+        if (rounding_mode == Dynamic)
+            rounding_mode = util::extract_bits<5, 7>(fcsr().get());
+
+        if (rounding_mode > NearestMaxMagnitude)
+            return std::nullopt;
+
+        return rounding_mode;
+    }
+
+    namespace {
+
+        // Reads a single precision value. Values that aren't properly NaN-boxed read as the canonical NaN
+        auto read_single(std::uint64_t value) -> float {
+            if ((value & NaNBox) != NaNBox)
+                return canonical_nan<float>();
+
+            return std::bit_cast<float>(std::uint32_t(value));
+        }
+
+        auto box_single(float value) -> std::uint64_t {
+            return NaNBox | std::bit_cast<std::uint32_t>(value);
+        }
+
+        auto read_double(std::uint64_t value) -> double {
+            return std::bit_cast<double>(value);
+        }
+
+        auto box_double(double value) -> std::uint64_t {
+            return std::bit_cast<std::uint64_t>(value);
+        }
+
+        template<typename T>
+        auto read_fp(std::uint64_t value) -> T {
+            if constexpr (std::is_same_v<T, float>)
+                return read_single(value);
+            else
+                return read_double(value);
+        }
+
+        template<typename T>
+        auto box_fp(T value) -> std::uint64_t {
+            if constexpr (std::is_same_v<T, float>)
+                return box_single(value);
+            else
+                return box_double(value);
+        }
+
+        template<typename T>
+        auto sign_injection(std::uint64_t left, std::uint64_t right, std::uint8_t funct3) -> std::optional<T> {
+            constexpr auto SignBit = Bits<T>(1) << (sizeof(T) * 8 - 1);
+
+            const auto magnitude = std::bit_cast<Bits<T>>(read_fp<T>(left)) & ~SignBit;
+            const auto left_sign  = std::bit_cast<Bits<T>>(read_fp<T>(left)) & SignBit;
+            const auto right_sign = std::bit_cast<Bits<T>>(read_fp<T>(right)) & SignBit;
+
+            switch (funct3) {
+                case 0b000: return std::bit_cast<T>(magnitude | right_sign);                  // FSGNJ
+                case 0b001: return std::bit_cast<T>(magnitude | (right_sign ^ SignBit));      // FSGNJN
+                case 0b010: return std::bit_cast<T>(magnitude | (left_sign ^ right_sign));    // FSGNJX
+                default:    return std::nullopt;
+            }
+        }
+
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_load_fp(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause> {
+        if (!is_fpu_enabled()) [[unlikely]]
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        const T address = x(instruction.rs1) + util::sign_extend<T, 12>(instruction.imm);
+        switch (instruction.funct3) {
+            case 0b010: { // FLW
+                const auto value = read<std::uint32_t>(address);
+                if (!value.has_value()) [[unlikely]]
+                    return std::unexpected(value.error());
+
+                f(instruction.rd) = NaNBox | *value;
+                break;
+            }
+            case 0b011: { // FLD
+                const auto value = read<std::uint64_t>(address);
+                if (!value.has_value()) [[unlikely]]
+                    return std::unexpected(value.error());
+
+                f(instruction.rd) = *value;
+                break;
+            }
+            default:
+                return std::unexpected(ExceptionCause::IllegalInstruction);
+        }
+
+        mark_fp_state_dirty();
+        return {};
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_store_fp(const instr::base::type::S &instruction) -> std::expected<void, ExceptionCause> {
+        if (!is_fpu_enabled()) [[unlikely]]
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        const T address = x(instruction.rs1) + util::sign_extend<T, 12>(instruction.imm);
+        switch (instruction.funct3) {
+            case 0b010: // FSW
+                return write<std::uint32_t>(address, std::uint32_t(f(instruction.rs2)));
+            case 0b011: // FSD
+                return write<std::uint64_t>(address, f(instruction.rs2));
+            default:
+                return std::unexpected(ExceptionCause::IllegalInstruction);
+        }
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_fused_multiply_add(const instr::base::type::R4 &instruction) -> std::expected<void, ExceptionCause> {
+        if (!is_fpu_enabled()) [[unlikely]]
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        const auto rounding_mode = get_rounding_mode(instruction.funct3);
+        if (!rounding_mode.has_value()) [[unlikely]]
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        // FMADD: a * b + c, FMSUB: a * b - c, FNMSUB: -(a * b) + c, FNMADD: -(a * b) - c
+        const bool negate_product = instruction.opcode == instr::base::NMSUB::Value || instruction.opcode == instr::base::NMADD::Value;
+        const bool negate_addend  = instruction.opcode == instr::base::MSUB::Value  || instruction.opcode == instr::base::NMADD::Value;
+
+        std::uint32_t flags = 0;
+        const auto execute = [&]<typename Float>() {
+            auto multiplicand = read_fp<Float>(f(instruction.rs1));
+            auto multiplier   = read_fp<Float>(f(instruction.rs2));
+            auto addend       = read_fp<Float>(f(instruction.rs3));
+            if (negate_product) multiplicand = -multiplicand;
+            if (negate_addend)  addend = -addend;
+
+            const auto result = compute<Float>(*rounding_mode, flags, [](Float a, Float b, Float c) { return std::fma(a, b, c); }, multiplicand, multiplier, addend);
+            f(instruction.rd) = box_fp(canonicalize(result));
+        };
+
+        switch (instruction.funct2) {
+            case Single: execute.template operator()<float>();  break;
+            case Double: execute.template operator()<double>(); break;
+            default:     return std::unexpected(ExceptionCause::IllegalInstruction);
+        }
+
+        accrue_fp_exceptions(flags);
+        mark_fp_state_dirty();
+        return {};
+    }
+
+    template<std::unsigned_integral T>
+    auto BasicCore<T>::handle_op_fp(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause> {
+        if (!is_fpu_enabled()) [[unlikely]]
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        const auto funct5 = util::extract_bits<2, 6>(instruction.funct7);
+        const auto format = util::extract_bits<0, 1>(instruction.funct7);
+        if (format != Single && format != Double) [[unlikely]]
+            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+        std::uint32_t flags = 0;
+        const auto execute = [&]<typename Float>() -> std::expected<void, ExceptionCause> {
+            const auto left  = read_fp<Float>(f(instruction.rs1));
+            const auto right = read_fp<Float>(f(instruction.rs2));
+
+            // Operations that round their result
+            const auto arithmetic = [&](auto operation) -> std::expected<void, ExceptionCause> {
+                const auto rounding_mode = get_rounding_mode(instruction.funct3);
+                if (!rounding_mode.has_value()) [[unlikely]]
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                f(instruction.rd) = box_fp(canonicalize(compute<Float>(*rounding_mode, flags, operation, left, right)));
+                return {};
+            };
+
+            switch (funct5) {
+                case 0b00000: return arithmetic([](Float a, Float b) { return a + b; });    // FADD
+                case 0b00001: return arithmetic([](Float a, Float b) { return a - b; });    // FSUB
+                case 0b00010: return arithmetic([](Float a, Float b) { return a * b; });    // FMUL
+                case 0b00011: return arithmetic([](Float a, Float b) { return a / b; });    // FDIV
+                case 0b01011: // FSQRT
+                    if (instruction.rs2 != 0)
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+                    return arithmetic([](Float a, Float) { return std::sqrt(a); });
+                case 0b00100: { // FSGNJ / FSGNJN / FSGNJX
+                    const auto result = sign_injection<Float>(f(instruction.rs1), f(instruction.rs2), instruction.funct3);
+                    if (!result.has_value())
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    f(instruction.rd) = box_fp(*result);
+                    return {};
+                }
+                case 0b00101: // FMIN / FMAX
+                    if (instruction.funct3 > 0b001)
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    f(instruction.rd) = box_fp(minimum_maximum(left, right, instruction.funct3 == 0b001, flags));
+                    return {};
+                case 0b01000: { // FCVT.S.D / FCVT.D.S
+                    const auto rounding_mode = get_rounding_mode(instruction.funct3);
+                    if (!rounding_mode.has_value()) [[unlikely]]
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    if constexpr (std::is_same_v<Float, float>) {
+                        if (instruction.rs2 != Double)
+                            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                        const auto source = read_double(f(instruction.rs1));
+                        f(instruction.rd) = box_single(canonicalize(compute<float>(*rounding_mode, flags, [](double value) { return float(value); }, source)));
+                    } else {
+                        if (instruction.rs2 != Single)
+                            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                        const auto source = read_single(f(instruction.rs1));
+                        f(instruction.rd) = box_double(canonicalize(compute<double>(*rounding_mode, flags, [](float value) { return double(value); }, source)));
+                    }
+                    return {};
+                }
+                case 0b10100: { // FEQ / FLT / FLE
+                    const auto result = compare(left, right, instruction.funct3, flags);
+                    if (!result.has_value())
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    x(instruction.rd) = *result ? 1 : 0;
+                    return {};
+                }
+                case 0b11000: { // FCVT.W / FCVT.WU / FCVT.L / FCVT.LU
+                    const auto rounding_mode = get_rounding_mode(instruction.funct3);
+                    if (!rounding_mode.has_value()) [[unlikely]]
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    // Word results are sign extended on RV64, even the unsigned ones
+                    switch (instruction.rs2) {
+                        case 0b00000: x(instruction.rd) = util::sign_extend<T, 32>(std::uint32_t(convert_to_integer<std::int32_t>(left, *rounding_mode, flags))); break;
+                        case 0b00001: x(instruction.rd) = util::sign_extend<T, 32>(convert_to_integer<std::uint32_t>(left, *rounding_mode, flags)); break;
+                        case 0b00010: if (XLen == 32) return std::unexpected(ExceptionCause::IllegalInstruction);
+                                      x(instruction.rd) = T(convert_to_integer<std::int64_t>(left, *rounding_mode, flags)); break;
+                        case 0b00011: if (XLen == 32) return std::unexpected(ExceptionCause::IllegalInstruction);
+                                      x(instruction.rd) = T(convert_to_integer<std::uint64_t>(left, *rounding_mode, flags)); break;
+                        default: return std::unexpected(ExceptionCause::IllegalInstruction);
+                    }
+
+                    return {};
+                }
+                case 0b11010: { // FCVT.S.W / FCVT.S.WU / FCVT.S.L / FCVT.S.LU and their double precision counterparts
+                    const auto rounding_mode = get_rounding_mode(instruction.funct3);
+                    if (!rounding_mode.has_value()) [[unlikely]]
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    const std::uint64_t source = x(instruction.rs1);
+                    switch (instruction.rs2) {
+                        case 0b00000: f(instruction.rd) = box_fp(compute<Float>(*rounding_mode, flags, [](std::int32_t value) { return Float(value); }, std::int32_t(source))); break;
+                        case 0b00001: f(instruction.rd) = box_fp(compute<Float>(*rounding_mode, flags, [](std::uint32_t value) { return Float(value); }, std::uint32_t(source))); break;
+                        case 0b00010: if (XLen == 32) return std::unexpected(ExceptionCause::IllegalInstruction);
+                                      f(instruction.rd) = box_fp(compute<Float>(*rounding_mode, flags, [](std::int64_t value) { return Float(value); }, std::int64_t(source))); break;
+                        case 0b00011: if (XLen == 32) return std::unexpected(ExceptionCause::IllegalInstruction);
+                                      f(instruction.rd) = box_fp(compute<Float>(*rounding_mode, flags, [](std::uint64_t value) { return Float(value); }, source)); break;
+                        default: return std::unexpected(ExceptionCause::IllegalInstruction);
+                    }
+                    return {};
+                }
+                case 0b11100: { // FMV.X.W / FMV.X.D / FCLASS
+                    if (instruction.rs2 != 0)
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    if (instruction.funct3 == 0b001) {
+                        x(instruction.rd) = classify(left);
+                        return {};
+                    }
+
+                    if (instruction.funct3 != 0b000)
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    // There's no FMV.X.D on RV32, FMV.X.W sign extends the bits it moves on RV64
+                    if constexpr (std::is_same_v<Float, float>) {
+                        x(instruction.rd) = util::sign_extend<T, 32>(std::uint32_t(f(instruction.rs1)));
+                    } else {
+                        if (XLen == 32)
+                            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                        x(instruction.rd) = T(f(instruction.rs1));
+                    }
+                    return {};
+                }
+                case 0b11110: { // FMV.W.X / FMV.D.X
+                    if (instruction.rs2 != 0 || instruction.funct3 != 0b000)
+                        return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                    if constexpr (std::is_same_v<Float, float>) {
+                        f(instruction.rd) = NaNBox | std::uint32_t(x(instruction.rs1));
+                    } else {
+                        if (XLen == 32)
+                            return std::unexpected(ExceptionCause::IllegalInstruction);
+
+                        f(instruction.rd) = x(instruction.rs1);
+                    }
+                    return {};
+                }
+                default:
+                    return std::unexpected(ExceptionCause::IllegalInstruction);
+            }
+        };
+
+        const auto result = format == Single ? execute.template operator()<float>() : execute.template operator()<double>();
+        if (!result.has_value())
+            return result;
+
+        accrue_fp_exceptions(flags);
+
+        // Instructions that only write integer registers don't touch the FP state, unless they raised an exception
+        if (funct5 != 0b10100 && funct5 != 0b11000 && funct5 != 0b11100)
+            mark_fp_state_dirty();
+
+        return {};
+    }
+
+    // The rest of the core gets instantiated along with its definitions in core.cpp
+    template auto BasicCore<std::uint32_t>::is_fpu_enabled() -> bool;
+    template auto BasicCore<std::uint32_t>::mark_fp_state_dirty() -> void;
+    template auto BasicCore<std::uint32_t>::accrue_fp_exceptions(std::uint32_t flags) -> void;
+    template auto BasicCore<std::uint32_t>::get_rounding_mode(std::uint8_t rounding_mode) -> std::optional<std::uint8_t>;
+    template auto BasicCore<std::uint32_t>::handle_load_fp(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+    template auto BasicCore<std::uint32_t>::handle_store_fp(const instr::base::type::S &instruction) -> std::expected<void, ExceptionCause>;
+    template auto BasicCore<std::uint32_t>::handle_fused_multiply_add(const instr::base::type::R4 &instruction) -> std::expected<void, ExceptionCause>;
+    template auto BasicCore<std::uint32_t>::handle_op_fp(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause>;
+
+    template auto BasicCore<std::uint64_t>::is_fpu_enabled() -> bool;
+    template auto BasicCore<std::uint64_t>::mark_fp_state_dirty() -> void;
+    template auto BasicCore<std::uint64_t>::accrue_fp_exceptions(std::uint32_t flags) -> void;
+    template auto BasicCore<std::uint64_t>::get_rounding_mode(std::uint8_t rounding_mode) -> std::optional<std::uint8_t>;
+    template auto BasicCore<std::uint64_t>::handle_load_fp(const instr::base::type::I &instruction) -> std::expected<void, ExceptionCause>;
+    template auto BasicCore<std::uint64_t>::handle_store_fp(const instr::base::type::S &instruction) -> std::expected<void, ExceptionCause>;
+    template auto BasicCore<std::uint64_t>::handle_fused_multiply_add(const instr::base::type::R4 &instruction) -> std::expected<void, ExceptionCause>;
+    template auto BasicCore<std::uint64_t>::handle_op_fp(const instr::base::type::R &instruction) -> std::expected<void, ExceptionCause>;
+
+}
\ No newline at end of file
@@ -1,5 +1,21 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 #include <emu/riscv/emulator.hpp>
+#include <emu/riscv/mmio_tracer.hpp>
+#include <emu/riscv/time_travel.hpp>
+#include <emu/input_log.hpp>
 #include <emu/literals.hpp>
 #include <emu/devices/ram.hpp>
 #include <emu/devices/8250_uart.hpp>
@@ -25,65 +41,525 @@ namespace ds::emu::ffi {
     using namespace ds::literals;
 
     struct Emulator {
-        Emulator() : ram(512_MiB) {
+        Emulator() : ram(512_MiB), mmio_tracer(emulator), time_travel(emulator, ram, input_log) {
             std::setvbuf(stdout, nullptr, _IONBF, 0);
 
-            uart8250.output_callback([](std::uint8_t c) {
+            uart8250.output_callback([this](std::uint8_t c) {
+                // Everything executed again after going backwards has already been printed before
+                if (time_travel.is_reexecuting())
+                    return;
+
                 const std::array buffer = { char(c), char() };
                 send_terminal_data("linux-terminal", buffer.data());
             });
 
+            input_log.bind(InputChannel::UartInput, [this](std::uint32_t value) {
+                uart8250.receive(value);
+            });
+            emulator.attach_input_log(&input_log);
+
             emulator.address_space().map(0x0000'0000, &ram);
             emulator.address_space().map(0xF400'0000, &uart8250);
             emulator.address_space().add_address_translator(&riscv_mmu);
 
-            emulator.power_up();
-
-            ram.write(0x00, LinuxKernel);
+            // Trace all peripherals except for RAM by default once tracing gets started
+            const std::array<const MemoryMappedPeripheral<std::uint32_t>*, 1> untraced = { &ram };
+            mmio_tracer.trace_all_peripherals_except(untraced);
 
             constexpr static auto DeviceTreeBlobLoadAddress = 512_MiB - 1_MiB;
             constexpr static auto InitRamFsLoadAddress = 0x1F700000;
-            ram.write(DeviceTreeBlobLoadAddress, DeviceTreeBlob);
-            ram.write(InitRamFsLoadAddress, InitRamFs);
-            emulator.cores()[0].a1() = DeviceTreeBlobLoadAddress;
+            emulator.add_boot_image(0x00, LinuxKernel);
+            emulator.add_boot_image(DeviceTreeBlobLoadAddress, DeviceTreeBlob);
+            emulator.add_boot_image(InitRamFsLoadAddress, InitRamFs);
+            emulator.set_device_tree_address(DeviceTreeBlobLoadAddress);
+
+            time_travel.power_up();
         }
 
+        // The device callbacks and the mapped devices point back into the emulator, so it has to stay in place
+        Emulator(const Emulator &) = delete;
+        Emulator &operator=(const Emulator &) = delete;
+
         void step() {
-            emulator.step();
+            time_travel.step();
+        }
+
+        [[nodiscard]] bool is_powered_up() const {
+            return emulator.is_powered_up();
+        }
+
+        [[nodiscard]] std::uint64_t ticks() const {
+            return emulator.ticks();
+        }
+
+        [[nodiscard]] dev::Ram& memory() {
+            return ram;
+        }
+
+        [[nodiscard]] InputLog& inputs() {
+            return input_log;
+        }
+
+        [[nodiscard]] riscv::MmioTracer<1>& tracer() {
+            return mmio_tracer;
+        }
+
+        [[nodiscard]] std::span<riscv::Core> cores() {
+            return emulator.cores();
+        }
+
+        [[nodiscard]] AddressSpace<std::uint32_t>& address_space() {
+            return emulator.address_space();
+        }
+
+        [[nodiscard]] riscv::TimeTravel<1>& history() {
+            return time_travel;
         }
 
     private:
+        InputLog input_log;
         riscv::Emulator<1> emulator;
         dev::Ram ram;
         dev::UART8250 uart8250;
         dev::riscv::MMU<std::uint32_t> riscv_mmu;
+        riscv::MmioTracer<1> mmio_tracer;
+
+        riscv::TimeTravel<1> time_travel;
+    };
+
+}
+
+// Runtime performance figures of the emulation, laid out to be shared with the frontend
+struct Telemetry {
+    double mips;                    // Million instructions retired per second of wall time
+    std::uint64_t instructions_retired;
+    double virtual_time_ratio;      // Guest time passed per second of wall time, 1.0 means real-time speed
+    double tlb_hit_rate;            // Fraction of address translations served by the TLB
+    double idle_percentage;         // Percentage of steps the cores spent waiting for an interrupt
+};
+
+namespace ds::emu::ffi {
+
+    // Computes the telemetry figures over the interval since the previous sample.
+    // Only ever used by the emulation thread, so it can read the emulator state directly
+    class TelemetrySampler {
+    public:
+        // Matches the timebase-frequency the device tree reports to the guest
+        constexpr static double TimebaseFrequency = 65'000'000;
+
+        explicit TelemetrySampler(Emulator &emulator) : m_emulator(emulator), m_previous(read_counters()) { }
+
+        Telemetry sample() {
+            const auto current = read_counters();
+            const auto previous = std::exchange(m_previous, current);
+
+            Telemetry telemetry = {};
+            telemetry.instructions_retired = current.instructions_retired;
+
+            // Going backwards in time leaves nothing meaningful to compare against
+            const std::chrono::duration<double> wall_time = current.wall_time - previous.wall_time;
+            if (current.ticks <= previous.ticks || wall_time.count() <= 0)
+                return telemetry;
+
+            const auto steps        = current.ticks - previous.ticks;
+            const auto translations = (current.tlb_hits - previous.tlb_hits) + (current.tlb_misses - previous.tlb_misses);
+
+            telemetry.mips               = double(current.instructions_retired - previous.instructions_retired) / wall_time.count() / 1'000'000;
+            telemetry.virtual_time_ratio = double(current.virtual_time - previous.virtual_time) / TimebaseFrequency / wall_time.count();
+            telemetry.tlb_hit_rate       = translations == 0 ? 0.0 : double(current.tlb_hits - previous.tlb_hits) / double(translations);
+            telemetry.idle_percentage    = double(current.idle_steps - previous.idle_steps) * 100.0 / double(steps);
+
+            return telemetry;
+        }
+
+    private:
+        struct Counters {
+            std::chrono::steady_clock::time_point wall_time;
+            std::uint64_t ticks;
+            std::uint64_t virtual_time;
+            std::uint64_t instructions_retired;
+            std::uint64_t idle_steps;
+            std::uint64_t tlb_hits;
+            std::uint64_t tlb_misses;
+        };
+
+        Counters read_counters() {
+            Counters counters = {};
+            counters.wall_time = std::chrono::steady_clock::now();
+            counters.ticks     = m_emulator.ticks();
+
+            for (auto &core : m_emulator.cores()) {
+                const auto &statistics = core.statistics();
+                counters.instructions_retired += statistics.instructions_retired;
+                counters.idle_steps           += statistics.idle_steps;
+                counters.tlb_hits             += statistics.tlb_hits;
+                counters.tlb_misses           += statistics.tlb_misses;
+            }
+
+            auto &core = m_emulator.cores().front();
+            counters.virtual_time = (std::uint64_t(core.timeh()) << 32) | core.time();
+
+            return counters;
+        }
+
+    private:
+        Emulator &m_emulator;
+        Counters m_previous;
+    };
+
+    // Latest telemetry published by the emulation thread. Guarded by a sequence lock so publishing
+    // never has to wait for readers; readers simply retry if they raced with an update
+    class TelemetryBlock {
+    public:
+        void publish(const Telemetry &telemetry) {
+            const auto sequence = m_sequence.load(std::memory_order_relaxed);
+            m_sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            m_mips.store(telemetry.mips, std::memory_order_relaxed);
+            m_instructions_retired.store(telemetry.instructions_retired, std::memory_order_relaxed);
+            m_virtual_time_ratio.store(telemetry.virtual_time_ratio, std::memory_order_relaxed);
+            m_tlb_hit_rate.store(telemetry.tlb_hit_rate, std::memory_order_relaxed);
+            m_idle_percentage.store(telemetry.idle_percentage, std::memory_order_relaxed);
+
+            m_sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        Telemetry read() const {
+            while (true) {
+                const auto sequence = m_sequence.load(std::memory_order_acquire);
+                if (sequence % 2 != 0)
+                    continue;
+
+                Telemetry telemetry = {};
+                telemetry.mips                 = m_mips.load(std::memory_order_relaxed);
+                telemetry.instructions_retired = m_instructions_retired.load(std::memory_order_relaxed);
+                telemetry.virtual_time_ratio   = m_virtual_time_ratio.load(std::memory_order_relaxed);
+                telemetry.tlb_hit_rate         = m_tlb_hit_rate.load(std::memory_order_relaxed);
+                telemetry.idle_percentage      = m_idle_percentage.load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_sequence.load(std::memory_order_relaxed) == sequence)
+                    return telemetry;
+            }
+        }
+
+    private:
+        std::atomic<std::uint64_t> m_sequence = 0;
+
+        std::atomic<double> m_mips = 0;
+        std::atomic<std::uint64_t> m_instructions_retired = 0;
+        std::atomic<double> m_virtual_time_ratio = 0;
+        std::atomic<double> m_tlb_hit_rate = 0;
+        std::atomic<double> m_idle_percentage = 0;
     };
 
 }
 
 static std::jthread s_emulator_thread;
+static std::atomic<bool> s_emulation_running = false;
+
+// Emulator owned by the emulation thread, shared so other threads can query it while it's running
+static std::mutex s_emulator_mutex;
+static std::shared_ptr<ds::emu::ffi::Emulator> s_emulator;
+
+static std::shared_ptr<ds::emu::ffi::Emulator> get_emulator() {
+    std::scoped_lock lock(s_emulator_mutex);
+    return s_emulator;
+}
+
+// Work queued up by other threads that needs to run on the emulation thread in between two steps
+static std::mutex s_command_mutex;
+static std::condition_variable_any s_command_condition;
+static std::vector<std::function<void(ds::emu::ffi::Emulator&)>> s_commands;
+static std::atomic<bool> s_commands_pending = false;
+static std::atomic<bool> s_emulation_paused = false;
+
+static void run_commands(ds::emu::ffi::Emulator &emulator) {
+    std::vector<std::function<void(ds::emu::ffi::Emulator&)>> commands;
+    {
+        std::scoped_lock lock(s_command_mutex);
+        s_commands_pending = false;
+        std::swap(commands, s_commands);
+    }
+
+    for (const auto &command : commands) {
+        command(emulator);
+    }
+}
+
+static bool queue_on_emulation_thread(std::function<void(ds::emu::ffi::Emulator&)> command) {
+    {
+        std::scoped_lock lock(s_command_mutex);
+        if (!s_emulation_running)
+            return false;
+
+        s_commands.emplace_back(std::move(command));
+        s_commands_pending = true;
+    }
+    s_command_condition.notify_all();
+
+    return true;
+}
+
+// Runs the function on the emulation thread and waits for its result. Returns nothing if no emulation is running
+template<typename F>
+static auto run_on_emulation_thread(F &&function) -> std::optional<std::invoke_result_t<F, ds::emu::ffi::Emulator&>> {
+    using Result = std::invoke_result_t<F, ds::emu::ffi::Emulator&>;
+
+    auto task = std::make_shared<std::packaged_task<Result(ds::emu::ffi::Emulator&)>>(std::forward<F>(function));
+    auto result = task->get_future();
+    if (!queue_on_emulation_thread([task](ds::emu::ffi::Emulator &emulator) { (*task)(emulator); }))
+        return std::nullopt;
+
+    return result.get();
+}
+
+// Checkpoint settings used for reverse execution
+static std::atomic<std::uint64_t> s_checkpoint_interval = ds::emu::riscv::TimeTravel<1>::DefaultCheckpointInterval;
+static std::atomic<std::size_t> s_max_checkpoints = ds::emu::riscv::TimeTravel<1>::DefaultMaxCheckpoints;
+
+// Telemetry gets refreshed at most this often. The clock is only looked at every TelemetryCheckSteps steps
+constexpr static auto TelemetryInterval = std::chrono::milliseconds(500);
+constexpr static std::uint32_t TelemetryCheckSteps = 1 << 20;
+static ds::emu::ffi::TelemetryBlock s_telemetry;
+
+// Paths of the input recording to create or replay on the next start of the emulation
+static std::string s_input_recording_path;
+static std::string s_input_replay_path;
 
 extern "C" void set_device_tree_source(const char *source, std::size_t length) {
 
 }
 
 extern "C" [[gnu::visibility("default")]] bool is_emulation_running() {
-    return !s_emulator_thread.get_stop_token().stop_requested();
+    return s_emulation_running;
+}
+
+extern "C" [[gnu::visibility("default")]] void stop_emulation() {
+    if (!s_emulator_thread.joinable())
+        return;
+
+    s_emulator_thread.request_stop();
+    s_emulator_thread.join();
 }
 
 extern "C" [[gnu::visibility("default")]] void start_emulation() {
+    // A previous emulation thread clears the running flag when it exits, so it has to be gone before the flag is set again
+    stop_emulation();
+
+    s_emulation_running = true;
+    s_emulation_paused = false;
     s_emulator_thread = std::jthread([](const std::stop_token &stop_token) {
-        ds::emu::ffi::Emulator emulator;
-        while (!stop_token.stop_requested()) {
-            emulator.step();
+        auto emulator = std::make_shared<ds::emu::ffi::Emulator>();
+        emulator->history().set_checkpoint_interval(s_checkpoint_interval, s_max_checkpoints);
+        if (!s_input_replay_path.empty()) {
+            if (!emulator->inputs().start_replay(s_input_replay_path))
+                std::printf("Failed to load input recording '%s'\n", s_input_replay_path.c_str());
+        } else if (!s_input_recording_path.empty()) {
+            if (!emulator->inputs().start_recording(s_input_recording_path))
+                std::printf("Failed to create input recording '%s'\n", s_input_recording_path.c_str());
+        }
+
+        {
+            std::scoped_lock lock(s_emulator_mutex);
+            s_emulator = emulator;
+        }
+
+        ds::emu::ffi::TelemetrySampler telemetry_sampler(*emulator);
+        auto next_telemetry_update = std::chrono::steady_clock::now() + TelemetryInterval;
+        auto steps_until_telemetry_check = TelemetryCheckSteps;
+
+        // Keep running until either the frontend stops us or the guest powers off
+        while (!stop_token.stop_requested() && emulator->is_powered_up()) {
+            if (s_commands_pending.load(std::memory_order_relaxed)) [[unlikely]]
+                run_commands(*emulator);
+
+            if (s_emulation_paused.load(std::memory_order_relaxed)) [[unlikely]] {
+                // Report the emulation as standing still and leave the paused time out of the next interval
+                s_telemetry.publish(telemetry_sampler.sample());
+                {
+                    std::unique_lock lock(s_command_mutex);
+                    s_command_condition.wait(lock, stop_token, [] { return !s_emulation_paused || s_commands_pending; });
+                }
+                telemetry_sampler.sample();
+                continue;
+            }
+
+            emulator->step();
+
+            if (--steps_until_telemetry_check == 0) [[unlikely]] {
+                steps_until_telemetry_check = TelemetryCheckSteps;
+
+                if (const auto now = std::chrono::steady_clock::now(); now >= next_telemetry_update) {
+                    s_telemetry.publish(telemetry_sampler.sample());
+                    next_telemetry_update = now + TelemetryInterval;
+                }
+            }
+        }
+
+        s_telemetry.publish(telemetry_sampler.sample());
+
+        {
+            std::scoped_lock lock(s_command_mutex);
+            s_emulation_running = false;
         }
+
+        // Nothing can be queued up anymore, finish whatever is still waiting
+        run_commands(*emulator);
     });
 }
 
-extern "C" [[gnu::visibility("default")]] void stop_emulation() {
-    if (!is_emulation_running())
+extern "C" [[gnu::visibility("default")]] void pause_emulation() {
+    s_emulation_paused = true;
+}
+
+extern "C" [[gnu::visibility("default")]] void resume_emulation() {
+    {
+        std::scoped_lock lock(s_command_mutex);
+        s_emulation_paused = false;
+    }
+    s_command_condition.notify_all();
+}
+
+// Pauses the emulation and goes back the given number of steps. Returns the tick the emulator is at afterwards
+extern "C" [[gnu::visibility("default")]] std::uint64_t reverse_step(std::uint64_t count) {
+    pause_emulation();
+
+    return run_on_emulation_thread([count](ds::emu::ffi::Emulator &emulator) {
+        return emulator.history().step_back(count);
+    }).value_or(0);
+}
+
+// Pauses the emulation and goes back to the instruction that last wrote to the given physical address range.
+// Returns false if there was no such write in the history that's still available
+extern "C" [[gnu::visibility("default")]] bool reverse_to_previous_write(std::uint32_t address, std::uint32_t size, std::uint64_t *tick, std::uint32_t *pc) {
+    pause_emulation();
+
+    const auto location = run_on_emulation_thread([address, size](ds::emu::ffi::Emulator &emulator) {
+        return emulator.history().step_back_to_write(address, size);
+    });
+    if (!location.has_value() || !location->has_value())
+        return false;
+
+    *tick = (*location)->tick;
+    *pc   = (*location)->pc;
+
+    return true;
+}
+
+extern "C" [[gnu::visibility("default")]] void set_checkpoint_interval(std::uint64_t interval, std::size_t max_checkpoints) {
+    s_checkpoint_interval = interval;
+    s_max_checkpoints = max_checkpoints;
+
+    queue_on_emulation_thread([interval, max_checkpoints](ds::emu::ffi::Emulator &emulator) {
+        emulator.history().set_checkpoint_interval(interval, max_checkpoints);
+    });
+}
+
+// Starts writing all accesses to traced peripherals into the given file
+extern "C" [[gnu::visibility("default")]] bool start_mmio_trace(const char *path) {
+    const std::string trace_path = path;
+
+    return run_on_emulation_thread([&trace_path](ds::emu::ffi::Emulator &emulator) {
+        return emulator.tracer().start(trace_path);
+    }).value_or(false);
+}
+
+extern "C" [[gnu::visibility("default")]] void stop_mmio_trace() {
+    queue_on_emulation_thread([](ds::emu::ffi::Emulator &emulator) {
+        emulator.tracer().stop();
+    });
+}
+
+// Enables or disables tracing of the peripheral mapped at the given address
+extern "C" [[gnu::visibility("default")]] bool set_mmio_trace_region(std::uint32_t address, bool enabled) {
+    return run_on_emulation_thread([address, enabled](ds::emu::ffi::Emulator &emulator) {
+        return emulator.address_space().set_traced(address, enabled);
+    }).value_or(false);
+}
+
+// Mirrored by CoreStatistics in main/src/lib.rs, which checks for the same size
+static_assert(sizeof(ds::emu::riscv::CoreStatistics) == 840, "CoreStatistics changed, update its mirror in main/src/lib.rs");
+
+// Copies the statistics counters of the given hart. The copy is taken in between two steps so it's consistent
+extern "C" [[gnu::visibility("default")]] bool get_core_statistics(std::uint16_t hart, ds::emu::riscv::CoreStatistics *statistics) {
+    const auto snapshot = run_on_emulation_thread([hart](ds::emu::ffi::Emulator &emulator) -> std::optional<ds::emu::riscv::CoreStatistics> {
+        const auto cores = emulator.cores();
+        if (hart >= cores.size())
+            return std::nullopt;
+
+        return cores[hart].statistics();
+    });
+    if (!snapshot.has_value() || !snapshot->has_value())
+        return false;
+
+    *statistics = **snapshot;
+    return true;
+}
+
+struct PeripheralStatistics {
+    std::uint32_t base_address;
+    std::uint32_t size;
+    std::uint64_t reads;
+    std::uint64_t writes;
+};
+
+// Copies the access counters of up to `count` peripherals, ordered by address. RAM is only counted while traced.
+// Returns the number of mapped peripherals
+extern "C" [[gnu::visibility("default")]] std::size_t get_peripheral_statistics(PeripheralStatistics *statistics, std::size_t count) {
+    const auto snapshot = run_on_emulation_thread([](ds::emu::ffi::Emulator &emulator) {
+        std::vector<PeripheralStatistics> result;
+        for (const auto &entry : emulator.address_space().peripherals()) {
+            result.emplace_back(entry.base_address, std::uint32_t(entry.peripheral->size()), entry.reads, entry.writes);
+        }
+
+        return result;
+    });
+    if (!snapshot.has_value())
+        return 0;
+
+    std::copy_n(snapshot->begin(), std::min(count, snapshot->size()), statistics);
+    return snapshot->size();
+}
+
+// Copies the most recently published telemetry. Never waits for the emulation thread
+extern "C" [[gnu::visibility("default")]] void get_telemetry(Telemetry *telemetry) {
+    *telemetry = s_telemetry.read();
+}
+
+extern "C" [[gnu::visibility("default")]] std::size_t get_ram_page_count() {
+    const auto emulator = get_emulator();
+    if (emulator == nullptr)
+        return 0;
+
+    return emulator->memory().page_count();
+}
+
+extern "C" [[gnu::visibility("default")]] std::size_t get_dirty_pages(std::uint64_t *bitmap, std::size_t word_count, bool clear) {
+    const auto emulator = get_emulator();
+    if (emulator == nullptr)
+        return 0;
+
+    return emulator->memory().get_dirty_pages({ bitmap, word_count }, clear);
+}
+
+extern "C" [[gnu::visibility("default")]] void send_terminal_input(const char *terminal_id, const char *text) {
+    std::ignore = terminal_id;
+
+    const auto emulator = get_emulator();
+    if (emulator == nullptr)
         return;
 
-    s_emulator_thread.request_stop();
-    s_emulator_thread.join();
-}
\ No newline at end of file
+    for (const char *c = text; *c != '\0'; c += 1) {
+        emulator->inputs().push(ds::emu::InputChannel::UartInput, std::uint8_t(*c));
+    }
+}
+
+extern "C" [[gnu::visibility("default")]] void set_input_recording_path(const char *path) {
+    s_input_recording_path = path != nullptr ? path : "";
+}
+
+extern "C" [[gnu::visibility("default")]] void set_input_replay_path(const char *path) {
+    s_input_replay_path = path != nullptr ? path : "";
+}
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <emu/address_space.hpp>
+#include <emu/command_line.hpp>
+#include <emu/input_log.hpp>
+#include <emu/mmio_trace.hpp>
+#include <emu/devices/8250_uart.hpp>
+
+namespace {
+
+    using namespace ds;
+
+    using Peripheral = emu::MemoryMappedPeripheral<std::uint32_t>;
+
+    enum ExitCode {
+        ExitAllMatched      = 0,
+        ExitMismatch        = 1,
+        ExitInvalidUsage    = 2
+    };
+
+    // Number of mismatches printed per trace before only counting them
+    constexpr static auto MaxReportedMismatches = 16;
+
+    struct Model {
+        std::string_view name;
+        std::uint32_t default_base_address;
+        std::function<std::unique_ptr<Peripheral>()> create;
+
+        // Feeds a value received from the outside world, as stored in an input recording, into the model
+        std::function<void(Peripheral &peripheral, std::uint32_t value)> input;
+    };
+
+    const std::array Models = {
+        Model {
+            "uart8250", 0xF400'0000,
+            [] {
+                auto uart = std::make_unique<emu::dev::UART8250>();
+                uart->output_callback([](std::uint8_t) { });
+
+                return std::unique_ptr<Peripheral>(std::move(uart));
+            },
+            [](Peripheral &peripheral, std::uint32_t value) {
+                static_cast<emu::dev::UART8250 &>(peripheral).receive(value);
+            }
+        }
+    };
+
+    struct Trace {
+        std::string path;
+        std::string input_recording_path;
+    };
+
+    struct Options {
+        const Model *model = nullptr;
+        std::optional<std::uint32_t> base_address;
+        unsigned jobs = std::max(1U, std::thread::hardware_concurrency());
+        std::vector<Trace> traces;
+    };
+
+    struct Mismatch {
+        emu::MmioTraceRecord record;
+        std::uint64_t actual_value;
+    };
+
+    struct Result {
+        bool loaded = false;
+        std::size_t accesses = 0;
+        std::size_t mismatch_count = 0;
+        std::size_t failed_accesses = 0;
+        std::vector<Mismatch> mismatches;
+    };
+
+    auto print_usage(const char *program_name) -> void {
+        std::fprintf(stderr,
+            "Usage: %s --model <name> [options] <trace>[,<input recording>]...\n"
+            "\n"
+            "Replays the accesses to a peripheral recorded in MMIO traces against a fresh instance of\n"
+            "its model and reports every read that returns something different than during the recording.\n"
+            "If the run was also recorded with --record, the inputs the peripheral received are replayed as well.\n"
+            "\n"
+            "Options:\n"
+            "  --model <name>      Peripheral model to replay against\n"
+            "  --base <address>    Physical address the peripheral was mapped at during the recording\n"
+            "  --jobs <count>      Number of traces replayed in parallel\n"
+            "\n"
+            "Models:\n",
+            program_name
+        );
+
+        for (const auto &model : Models) {
+            std::fprintf(stderr, "  %-18s  Mapped at 0x%08X by default\n", model.name.data(), model.default_base_address);
+        }
+    }
+
+    auto parse_options(int argc, char **argv) -> std::optional<Options> {
+        Options options;
+
+        for (int i = 1; i < argc; i += 1) {
+            const std::string_view argument = argv[i];
+            if (!argument.starts_with("--")) {
+                const auto separator = argument.find(',');
+                if (separator == std::string_view::npos)
+                    options.traces.emplace_back(std::string(argument), "");
+                else
+                    options.traces.emplace_back(std::string(argument.substr(0, separator)), std::string(argument.substr(separator + 1)));
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for argument '%s'\n", argv[i]);
+                return std::nullopt;
+            }
+
+            const std::string_view value = argv[++i];
+            if (argument == "--model") {
+                const auto it = std::ranges::find(Models, value, &Model::name);
+                if (it == Models.end()) {
+                    std::fprintf(stderr, "Unknown model '%s'\n", argv[i]);
+                    return std::nullopt;
+                }
+                options.model = &*it;
+            } else if (argument == "--base") {
+                const auto base_address = emu::parse_number<std::uint32_t>(argument, value);
+                if (!base_address.has_value())
+                    return std::nullopt;
+                options.base_address = *base_address;
+            } else if (argument == "--jobs") {
+                const auto jobs = emu::parse_number<unsigned>(argument, value);
+                if (!jobs.has_value())
+                    return std::nullopt;
+                options.jobs = std::max(1U, *jobs);
+            } else {
+                std::fprintf(stderr, "Unknown argument '%s'\n", argv[i - 1]);
+                return std::nullopt;
+            }
+        }
+
+        if (options.model == nullptr || options.traces.empty())
+            return std::nullopt;
+
+        return options;
+    }
+
+    auto replay(const Trace &trace, const Model &model, std::uint32_t base_address) -> Result {
+        Result result;
+
+        auto records = emu::read_mmio_trace(trace.path);
+        if (!records.has_value())
+            return result;
+
+        emu::InputLog input_log;
+        if (!trace.input_recording_path.empty() && !input_log.start_replay(trace.input_recording_path))
+            return result;
+        const auto inputs = input_log.events();
+
+        result.loaded = true;
+
+        // Records of different harts are written out in batches, bring them back into execution order
+        std::ranges::stable_sort(*records, {}, &emu::MmioTraceRecord::tick);
+
+        auto peripheral = model.create();
+        peripheral->reset();
+
+        std::size_t input_index = 0;
+        for (const auto &record : *records) {
+            // Inputs are delivered at the start of their tick, before any access done in it
+            for (; input_index < inputs.size() && inputs[input_index].tick <= record.tick; input_index += 1) {
+                if (inputs[input_index].channel == emu::InputChannel::UartInput)
+                    model.input(*peripheral, inputs[input_index].value);
+            }
+
+            if (record.address < base_address || record.address - base_address >= peripheral->size())
+                continue;
+
+            const auto offset = record.address - base_address;
+            const auto size = std::min<std::size_t>(record.size, sizeof(record.value));
+            result.accesses += 1;
+
+            std::uint64_t value = 0;
+            const auto buffer = std::span(reinterpret_cast<std::uint8_t *>(&value), size);
+            if (record.direction == emu::MmioDirection::Fill) {
+                const std::vector<std::uint8_t> block(record.size, std::uint8_t(record.value));
+                if (peripheral->write(offset, block) != emu::AccessResult::Success)
+                    result.failed_accesses += 1;
+            } else if (record.direction == emu::MmioDirection::Write) {
+                std::memcpy(buffer.data(), &record.value, size);
+                if (peripheral->write(offset, buffer) != emu::AccessResult::Success)
+                    result.failed_accesses += 1;
+            } else {
+                if (peripheral->read(offset, buffer) != emu::AccessResult::Success)
+                    result.failed_accesses += 1;
+
+                if (value != record.value) {
+                    result.mismatch_count += 1;
+                    if (result.mismatches.size() < MaxReportedMismatches)
+                        result.mismatches.emplace_back(record, value);
+                }
+            }
+        }
+
+        return result;
+    }
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+    if (!options.has_value()) {
+        print_usage(argv[0]);
+        return ExitInvalidUsage;
+    }
+
+    const auto &model = *options->model;
+    const auto base_address = options->base_address.value_or(model.default_base_address);
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // Every trace gets replayed against its own model instance, so they can all run in parallel
+    std::vector<Result> results(options->traces.size());
+    std::atomic<std::size_t> next_trace = 0;
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned i = 0; i < std::min<std::size_t>(options->jobs, results.size()); i += 1) {
+            workers.emplace_back([&] {
+                for (auto index = next_trace++; index < results.size(); index = next_trace++) {
+                    results[index] = replay(options->traces[index], model, base_address);
+                }
+            });
+        }
+    }
+
+    bool all_matched = true;
+    for (std::size_t i = 0; i < results.size(); i += 1) {
+        const auto &path = options->traces[i].path;
+        const auto &result = results[i];
+        if (!result.loaded) {
+            std::printf("%s: failed to load trace\n", path.c_str());
+            all_matched = false;
+            continue;
+        }
+
+        std::printf("%s: %zu accesses, %zu mismatches, %zu failed accesses\n", path.c_str(), result.accesses, result.mismatch_count, result.failed_accesses);
+        for (const auto &[record, actual_value] : result.mismatches) {
+            std::printf("  tick %llu pc 0x%08X: read%u at offset 0x%X returned 0x%llX, expected 0x%llX\n",
+                static_cast<unsigned long long>(record.tick), record.pc,
+                record.size * 8U, record.address - base_address,
+                static_cast<unsigned long long>(actual_value), static_cast<unsigned long long>(record.value)
+            );
+        }
+
+        if (result.mismatch_count > 0 || result.failed_accesses > 0)
+            all_matched = false;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::fprintf(stderr, "Replayed %zu traces in %.3fs\n", results.size(), elapsed.count());
+
+    return all_matched ? ExitAllMatched : ExitMismatch;
+}
@@ -0,0 +1,654 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <emu/command_line.hpp>
+#include <emu/riscv/emulator.hpp>
+#include <emu/riscv/instructions.hpp>
+#include <emu/riscv/lockstep.hpp>
+#include <emu/riscv/mmio_tracer.hpp>
+#include <emu/riscv/profiler.hpp>
+#include <emu/symbol_table.hpp>
+#include <emu/input_log.hpp>
+#include <emu/literals.hpp>
+#include <emu/devices/ram.hpp>
+#include <emu/devices/8250_uart.hpp>
+#include <emu/devices/riscv/mmu.hpp>
+
+namespace {
+
+    using namespace ds;
+    using namespace ds::literals;
+
+    constexpr static auto RamSize                   = 512_MiB;
+    constexpr static auto KernelLoadAddress         = 0x0000'0000;
+    constexpr static auto DeviceTreeBlobLoadAddress = 512_MiB - 1_MiB;
+    constexpr static auto InitRamFsLoadAddress      = 0x1F70'0000;
+
+    // Checking the wall clock on every step is too expensive, only do it every N steps
+    constexpr static auto TimeLimitCheckInterval    = 64_KiB;
+
+    // Prime, so the samples don't line up with loops in the guest
+    constexpr static std::uint64_t DefaultProfileInterval = 10007;
+
+    enum ExitCode {
+        ExitGuestShutdown   = 0,
+        ExitGuestFailure    = 1,
+        ExitInvalidUsage    = 2,
+        ExitLimitReached    = 124
+    };
+
+    struct Options {
+        const char *kernel_path = nullptr;
+        const char *device_tree_path = nullptr;
+        const char *initramfs_path = nullptr;
+        const char *output_path = nullptr;
+        const char *record_path = nullptr;
+        const char *replay_path = nullptr;
+        const char *mmio_trace_path = nullptr;
+        const char *statistics_path = nullptr;
+        std::uint64_t statistics_interval = 0;
+        const char *profile_path = nullptr;
+        const char *symbols_path = nullptr;
+        std::uint64_t profile_interval = DefaultProfileInterval;
+        std::optional<std::chrono::microseconds> profile_period;
+        const char *milestones_path = nullptr;
+        std::vector<std::pair<std::string, std::string>> custom_milestones;
+        bool stop_after_milestones = false;
+        bool forward_stdin = false;
+        bool lockstep = false;
+        bool native_misaligned_access = false;
+
+        std::optional<std::uint64_t> max_instructions;
+        std::optional<std::chrono::duration<double>> timeout;
+    };
+
+    auto print_usage(const char *program_name) -> void {
+        std::fprintf(stderr,
+            "Usage: %s --kernel <path> --dtb <path> [options]\n"
+            "\n"
+            "Options:\n"
+            "  --kernel <path>             Kernel image loaded at 0x%08X\n"
+            "  --dtb <path>                Device tree blob loaded at 0x%08X\n"
+            "  --initramfs <path>          Initramfs loaded at 0x%08X\n"
+            "  --max-instructions <count>  Stop after executing the given number of instructions\n"
+            "  --timeout <seconds>         Stop after the given amount of wall time\n"
+            "  --output <path>             Write UART output to a file instead of stdout\n"
+            "  --stdin                     Forward stdin to the UART\n"
+            "  --record <path>             Record all inputs to the guest into a file\n"
+            "  --replay <path>             Replay the inputs of a previous recording instead of taking live inputs\n"
+            "  --mmio-trace <path>         Trace all accesses to peripherals other than RAM into a file\n"
+            "  --statistics <path>         Write execution statistics as JSON lines into a file when the run ends\n"
+            "  --statistics-interval <n>   Additionally write statistics every n instructions\n"
+            "  --profile <path>            Sample the guest PC and write a flat profile to the file and folded stacks to <path>.folded\n"
+            "  --profile-interval <n>      Take a profiling sample every n instructions (default %llu)\n"
+            "  --profile-period <us>       Take a profiling sample every given number of microseconds of wall time instead\n"
+            "  --symbols <path>            System.map or ELF file used to symbolize kernel addresses in the profile\n"
+            "  --milestones <path>         Write a JSON timeline of when boot milestones appeared on the console\n"
+            "  --milestone <name>=<text>   Additionally track when the given text appears on the console\n"
+            "  --stop-after-milestones     Stop as soon as all milestones have been reached\n"
+            "  --lockstep                  Run a second machine in lockstep and stop at the first step where their states differ\n"
+            "  --native-misaligned         Perform misaligned loads and stores in the emulator instead of trapping to the guest\n"
+            "\n"
+            "Exit status is 0 if the guest powered off normally or all milestones were reached with --stop-after-milestones,\n"
+            "1 if the guest reported a system failure or the machines diverged in lockstep mode "
+            "and %d if an instruction or time limit was reached first.\n",
+            program_name,
+            unsigned(KernelLoadAddress), unsigned(DeviceTreeBlobLoadAddress), unsigned(InitRamFsLoadAddress),
+            static_cast<unsigned long long>(DefaultProfileInterval),
+            ExitLimitReached
+        );
+    }
+
+    auto parse_options(int argc, char **argv) -> std::optional<Options> {
+        Options options;
+
+        for (int i = 1; i < argc; i += 1) {
+            const std::string_view argument = argv[i];
+            if (argument == "--stdin") {
+                options.forward_stdin = true;
+                continue;
+            } else if (argument == "--stop-after-milestones") {
+                options.stop_after_milestones = true;
+                continue;
+            } else if (argument == "--lockstep") {
+                options.lockstep = true;
+                continue;
+            } else if (argument == "--native-misaligned") {
+                options.native_misaligned_access = true;
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for argument '%s'\n", argv[i]);
+                return std::nullopt;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--kernel") {
+                options.kernel_path = value;
+            } else if (argument == "--dtb") {
+                options.device_tree_path = value;
+            } else if (argument == "--initramfs") {
+                options.initramfs_path = value;
+            } else if (argument == "--output") {
+                options.output_path = value;
+            } else if (argument == "--record") {
+                options.record_path = value;
+            } else if (argument == "--replay") {
+                options.replay_path = value;
+            } else if (argument == "--mmio-trace") {
+                options.mmio_trace_path = value;
+            } else if (argument == "--statistics") {
+                options.statistics_path = value;
+            } else if (argument == "--statistics-interval") {
+                const auto interval = emu::parse_number<std::uint64_t>(argument, value);
+                if (!interval.has_value())
+                    return std::nullopt;
+                options.statistics_interval = *interval;
+            } else if (argument == "--profile") {
+                options.profile_path = value;
+            } else if (argument == "--profile-interval") {
+                const auto interval = emu::parse_number<std::uint64_t>(argument, value);
+                if (!interval.has_value())
+                    return std::nullopt;
+                options.profile_interval = *interval;
+            } else if (argument == "--profile-period") {
+                const auto period = emu::parse_number<std::uint32_t>(argument, value);
+                if (!period.has_value())
+                    return std::nullopt;
+                options.profile_period = std::chrono::microseconds(*period);
+            } else if (argument == "--symbols") {
+                options.symbols_path = value;
+            } else if (argument == "--milestones") {
+                options.milestones_path = value;
+            } else if (argument == "--milestone") {
+                const std::string_view milestone = value;
+                const auto separator = milestone.find('=');
+                if (separator == std::string_view::npos || separator == 0 || separator + 1 == milestone.size()) {
+                    std::fprintf(stderr, "Invalid milestone '%s', expected <name>=<text>\n", value);
+                    return std::nullopt;
+                }
+                options.custom_milestones.emplace_back(milestone.substr(0, separator), milestone.substr(separator + 1));
+            } else if (argument == "--max-instructions") {
+                const auto count = emu::parse_number<std::uint64_t>(argument, value);
+                if (!count.has_value())
+                    return std::nullopt;
+                options.max_instructions = *count;
+            } else if (argument == "--timeout") {
+                const auto seconds = emu::parse_number<double>(argument, value);
+                if (!seconds.has_value())
+                    return std::nullopt;
+                if (!std::isfinite(*seconds) || *seconds < 0) {
+                    std::fprintf(stderr, "Invalid timeout '%s', expected a non-negative number of seconds\n", value);
+                    return std::nullopt;
+                }
+                options.timeout = std::chrono::duration<double>(*seconds);
+            } else {
+                std::fprintf(stderr, "Unknown argument '%s'\n", argv[i - 1]);
+                return std::nullopt;
+            }
+        }
+
+        if (options.kernel_path == nullptr || options.device_tree_path == nullptr)
+            return std::nullopt;
+
+        // Both need to own the address space's access tracer
+        if (options.lockstep && options.mmio_trace_path != nullptr) {
+            std::fprintf(stderr, "--lockstep can't be combined with --mmio-trace\n");
+            return std::nullopt;
+        }
+
+        return options;
+    }
+
+    auto read_file(const char *path) -> std::optional<std::vector<std::uint8_t>> {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            std::fprintf(stderr, "Failed to open '%s'\n", path);
+            return std::nullopt;
+        }
+
+        std::vector<std::uint8_t> data(file.tellg());
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(data.data()), data.size());
+
+        return data;
+    }
+
+    struct Machine {
+        Machine() : ram(RamSize), mmio_tracer(emulator), profiler(emulator, ram), input_log(std::make_shared<emu::InputLog>()) {
+            input_log->bind(emu::InputChannel::UartInput, [this](std::uint32_t value) {
+                uart8250.receive(value);
+            });
+            emulator.attach_input_log(input_log.get());
+
+            emulator.address_space().map(0x0000'0000, &ram);
+            emulator.address_space().map(0xF400'0000, &uart8250);
+            emulator.address_space().add_address_translator(&riscv_mmu);
+        }
+
+        // The input handler and the mapped devices point back into the machine, so it has to stay in place
+        Machine(const Machine &) = delete;
+        Machine &operator=(const Machine &) = delete;
+
+        auto load(std::uint32_t address, std::span<const std::uint8_t> data, const char *name) -> bool {
+            if (address + data.size() > ram.size()) {
+                std::fprintf(stderr, "%s does not fit into RAM at 0x%08X (%zu bytes)\n", name, address, data.size());
+                return false;
+            }
+
+            emulator.add_boot_image(address, data);
+            return true;
+        }
+
+        emu::riscv::Emulator<1> emulator;
+        emu::dev::Ram ram;
+        emu::dev::UART8250 uart8250;
+        emu::dev::riscv::MMU<std::uint32_t> riscv_mmu;
+        emu::riscv::MmioTracer<1> mmio_tracer;
+        emu::riscv::Profiler<1> profiler;
+
+        // Shared with the stdin forwarding thread which may outlive the machine
+        std::shared_ptr<emu::InputLog> input_log;
+    };
+
+    // Writes a snapshot of all statistics counters as a single line of JSON
+    auto write_statistics(std::FILE *file, Machine &machine) -> void {
+        const auto write_counters = [file](const auto &counters, auto get_name) {
+            bool first = true;
+            for (std::size_t i = 0; i < counters.size(); i += 1) {
+                if (counters[i] == 0)
+                    continue;
+
+                std::fprintf(file, "%s\"%s\":%llu", first ? "" : ",", get_name(i).c_str(), static_cast<unsigned long long>(counters[i]));
+                first = false;
+            }
+        };
+
+        std::fprintf(file, "{\"tick\":%llu,\"harts\":[", static_cast<unsigned long long>(machine.emulator.ticks()));
+        for (auto &core : machine.emulator.cores()) {
+            const auto &statistics = core.statistics();
+
+            std::fprintf(file, "%s{\"hart\":%u,\"instructions_retired\":%llu,\"idle_steps\":%llu,",
+                core.hart_id() == 0 ? "" : ",", core.hart_id(),
+                static_cast<unsigned long long>(statistics.instructions_retired), static_cast<unsigned long long>(statistics.idle_steps));
+
+            std::fprintf(file, "\"opcodes\":{");
+            write_counters(statistics.opcodes, [](std::size_t opcode) { return std::string(emu::riscv::instr::get_opcode_name(opcode)); });
+            std::fprintf(file, "},\"exceptions\":{");
+            write_counters(statistics.exceptions, [](std::size_t cause) { return std::string(emu::riscv::get_exception_string(emu::riscv::ExceptionCause(cause))); });
+            std::fprintf(file, "},\"interrupts\":{");
+            write_counters(statistics.interrupts, [](std::size_t interrupt) { return std::to_string(interrupt); });
+
+            std::fprintf(file, "},\"misaligned_accesses\":%llu,\"tlb_hits\":%llu,\"tlb_misses\":%llu,\"page_table_reads\":%llu}",
+                static_cast<unsigned long long>(statistics.misaligned_accesses),
+                static_cast<unsigned long long>(statistics.tlb_hits), static_cast<unsigned long long>(statistics.tlb_misses),
+                static_cast<unsigned long long>(statistics.page_table_reads));
+        }
+
+        std::fprintf(file, "],\"peripherals\":[");
+        bool first = true;
+        for (const auto &entry : machine.emulator.address_space().peripherals()) {
+            std::fprintf(file, "%s{\"base_address\":%u,\"size\":%zu,\"reads\":%llu,\"writes\":%llu}",
+                first ? "" : ",", entry.base_address, entry.peripheral->size(),
+                static_cast<unsigned long long>(entry.reads), static_cast<unsigned long long>(entry.writes));
+            first = false;
+        }
+        std::fprintf(file, "]}\n");
+    }
+
+    // Records when recognizable milestones of the boot process happen, so boot time can be broken down into phases
+    class BootTimeline {
+    public:
+        BootTimeline(std::chrono::steady_clock::time_point start_time, std::span<const std::pair<std::string, std::string>> custom_milestones)
+            : m_start_time(start_time) {
+            // The kernel's first SBI call, the handoff from the firmware is done and the kernel is setting itself up
+            m_milestones.emplace_back("sbi_handoff", "");
+
+            m_milestones.emplace_back("kernel_banner",      "Linux version ");
+            m_milestones.emplace_back("free_init_memory",   "Freeing unused kernel ");
+            m_milestones.emplace_back("init_start",         " as init process");
+            m_milestones.emplace_back("shell_prompt",       "# ");
+
+            for (const auto &[name, text] : custom_milestones)
+                m_milestones.emplace_back(name, text);
+        }
+
+        // Needs to be called after every step
+        auto step(Machine &machine) -> void {
+            auto &sbi_handoff = m_milestones.front();
+            if (!sbi_handoff.reached.has_value()) [[unlikely]] {
+                if (machine.emulator.cores().front().statistics().exceptions[std::to_underlying(emu::riscv::ExceptionCause::ECallSupervisor)] != 0)
+                    reach(sbi_handoff, machine);
+            }
+        }
+
+        // Needs to be called with every character written to the console
+        auto output(Machine &machine, char c) -> void {
+            m_console.push_back(c);
+            if (m_console.size() > MaxConsoleHistory)
+                m_console.erase(0, m_console.size() - MaxConsoleHistory);
+
+            for (auto &milestone : m_milestones) {
+                if (milestone.reached.has_value() || milestone.text.empty())
+                    continue;
+
+                if (std::string_view(m_console).ends_with(milestone.text))
+                    reach(milestone, machine);
+            }
+        }
+
+        [[nodiscard]] auto all_reached() const -> bool {
+            return m_reached_count == m_milestones.size();
+        }
+
+        auto write(std::FILE *file, Machine &machine) const -> void {
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start_time;
+
+            std::fprintf(file, "{\"milestones\":[");
+            for (std::size_t i = 0; i < m_milestones.size(); i += 1) {
+                const auto &milestone = m_milestones[i];
+                std::fprintf(file, "%s{\"name\":\"%s\",\"reached\":%s", i == 0 ? "" : ",", milestone.name.c_str(), milestone.reached.has_value() ? "true" : "false");
+                if (milestone.reached.has_value()) {
+                    std::fprintf(file, ",\"wall_time\":%.6f,\"instructions_retired\":%llu,\"tick\":%llu",
+                        milestone.reached->wall_time, static_cast<unsigned long long>(milestone.reached->instructions_retired),
+                        static_cast<unsigned long long>(milestone.reached->tick));
+                }
+                std::fprintf(file, "}");
+            }
+
+            std::fprintf(file, "],\"wall_time\":%.6f,\"instructions_retired\":%llu,\"tick\":%llu}\n",
+                elapsed.count(), static_cast<unsigned long long>(instructions_retired(machine)),
+                static_cast<unsigned long long>(machine.emulator.ticks()));
+        }
+
+    private:
+        constexpr static std::size_t MaxConsoleHistory = 256;
+
+        struct Timestamp {
+            double wall_time;
+            std::uint64_t instructions_retired;
+            std::uint64_t tick;
+        };
+
+        struct Milestone {
+            std::string name;
+            std::string text;
+            std::optional<Timestamp> reached;
+        };
+
+        auto reach(Milestone &milestone, Machine &machine) -> void {
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start_time;
+            milestone.reached = Timestamp { elapsed.count(), instructions_retired(machine), machine.emulator.ticks() };
+            m_reached_count += 1;
+        }
+
+        static auto instructions_retired(Machine &machine) -> std::uint64_t {
+            std::uint64_t result = 0;
+            for (const auto &core : machine.emulator.cores())
+                result += core.statistics().instructions_retired;
+
+            return result;
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start_time;
+        std::vector<Milestone> m_milestones;
+        std::size_t m_reached_count = 0;
+        std::string m_console;
+    };
+
+    auto write_profile(const std::string &path, const emu::riscv::Profiler<1> &profiler, const emu::SymbolTable &symbols) -> bool {
+        std::FILE *flat_profile = std::fopen(path.c_str(), "w");
+        std::FILE *folded_stacks = std::fopen((path + ".folded").c_str(), "w");
+        if (flat_profile != nullptr)
+            profiler.write_flat_profile(flat_profile, symbols);
+        if (folded_stacks != nullptr)
+            profiler.write_folded_stacks(folded_stacks, symbols);
+
+        const bool success = flat_profile != nullptr && folded_stacks != nullptr;
+        if (flat_profile != nullptr)
+            std::fclose(flat_profile);
+        if (folded_stacks != nullptr)
+            std::fclose(folded_stacks);
+
+        return success;
+    }
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+    if (!options.has_value()) {
+        print_usage(argv[0]);
+        return ExitInvalidUsage;
+    }
+
+    const auto kernel      = read_file(options->kernel_path);
+    const auto device_tree = read_file(options->device_tree_path);
+    auto initramfs = std::optional<std::vector<std::uint8_t>>(std::in_place);
+    if (options->initramfs_path != nullptr)
+        initramfs = read_file(options->initramfs_path);
+    if (!kernel.has_value() || !device_tree.has_value() || !initramfs.has_value())
+        return ExitInvalidUsage;
+
+    std::FILE *output = stdout;
+    if (options->output_path != nullptr) {
+        output = std::fopen(options->output_path, "wb");
+        if (output == nullptr) {
+            std::fprintf(stderr, "Failed to open output file '%s'\n", options->output_path);
+            return ExitInvalidUsage;
+        }
+    } else {
+        std::setvbuf(stdout, nullptr, _IOLBF, 0);
+    }
+
+    auto machine = std::make_unique<Machine>();
+    std::optional<BootTimeline> timeline;
+    machine->uart8250.output_callback([output, &timeline, machine = machine.get()](std::uint8_t c) {
+        std::fputc(c, output);
+        if (timeline.has_value()) [[unlikely]]
+            timeline->output(*machine, char(c));
+    });
+
+    // Lockstep relies on both machines being set up the same way, otherwise they reboot differently
+    const auto set_up = [&](Machine &target) -> bool {
+        if (!target.load(KernelLoadAddress, *kernel, "Kernel") ||
+            !target.load(DeviceTreeBlobLoadAddress, *device_tree, "Device tree blob") ||
+            !target.load(InitRamFsLoadAddress, *initramfs, "Initramfs"))
+            return false;
+
+        target.emulator.set_device_tree_address(DeviceTreeBlobLoadAddress);
+        target.emulator.set_native_misaligned_access(options->native_misaligned_access);
+        return true;
+    };
+
+    if (!set_up(*machine))
+        return ExitInvalidUsage;
+
+    if (options->replay_path != nullptr) {
+        if (!machine->input_log->start_replay(options->replay_path)) {
+            std::fprintf(stderr, "Failed to load input recording '%s'\n", options->replay_path);
+            return ExitInvalidUsage;
+        }
+    } else if (options->record_path != nullptr) {
+        if (!machine->input_log->start_recording(options->record_path)) {
+            std::fprintf(stderr, "Failed to create input recording '%s'\n", options->record_path);
+            return ExitInvalidUsage;
+        }
+    }
+
+    if (options->mmio_trace_path != nullptr) {
+        const std::array<const emu::MemoryMappedPeripheral<std::uint32_t>*, 1> untraced = { &machine->ram };
+        machine->mmio_tracer.trace_all_peripherals_except(untraced);
+        if (!machine->mmio_tracer.start(options->mmio_trace_path)) {
+            std::fprintf(stderr, "Failed to create MMIO trace '%s'\n", options->mmio_trace_path);
+            return ExitInvalidUsage;
+        }
+    }
+
+    std::FILE *statistics_file = nullptr;
+    if (options->statistics_path != nullptr) {
+        statistics_file = std::fopen(options->statistics_path, "w");
+        if (statistics_file == nullptr) {
+            std::fprintf(stderr, "Failed to create statistics file '%s'\n", options->statistics_path);
+            return ExitInvalidUsage;
+        }
+    }
+
+    emu::SymbolTable symbols;
+    if (options->symbols_path != nullptr && !symbols.load(options->symbols_path)) {
+        std::fprintf(stderr, "Failed to load symbols from '%s'\n", options->symbols_path);
+        return ExitInvalidUsage;
+    }
+
+    if (options->profile_path != nullptr) {
+        if (options->profile_period.has_value())
+            machine->profiler.start(*options->profile_period);
+        else
+            machine->profiler.start(options->profile_interval);
+    }
+
+    if (options->forward_stdin) {
+        std::thread([input_log = machine->input_log] {
+            for (int c = std::getchar(); c != EOF; c = std::getchar()) {
+                input_log->push(emu::InputChannel::UartInput, std::uint8_t(c));
+            }
+        }).detach();
+    }
+
+    // The second machine gets the same inputs but its output goes nowhere. Until there's more than one
+    // execution engine, both run the reference interpreter, which still checks that the cloned state is complete
+    std::unique_ptr<Machine> lockstep_machine;
+    std::optional<emu::riscv::Lockstep<1>> lockstep;
+    if (options->lockstep) {
+        lockstep_machine = std::make_unique<Machine>();
+        lockstep_machine->uart8250.output_callback([](std::uint8_t) { });
+        if (!set_up(*lockstep_machine))
+            return ExitInvalidUsage;
+        machine->input_log->bind(emu::InputChannel::UartInput, [machine = machine.get(), lockstep_machine = lockstep_machine.get()](std::uint32_t value) {
+            machine->uart8250.receive(value);
+            lockstep_machine->uart8250.receive(value);
+        });
+
+        const auto engine = [](emu::riscv::Emulator<1> &emulator) { return emulator.step(); };
+        lockstep.emplace(
+            emu::riscv::Lockstep<1>::Machine { machine->emulator, machine->ram, engine },
+            emu::riscv::Lockstep<1>::Machine { lockstep_machine->emulator, lockstep_machine->ram, engine }
+        );
+    }
+
+    machine->emulator.power_up();
+    if (lockstep.has_value())
+        lockstep->synchronize();
+
+    const auto max_instructions = options->max_instructions.value_or(std::numeric_limits<std::uint64_t>::max());
+    const auto start_time = std::chrono::steady_clock::now();
+    if (options->milestones_path != nullptr)
+        timeline.emplace(start_time, options->custom_milestones);
+
+    std::uint64_t instructions = 0;
+    bool limit_reached = false;
+    bool diverged = false;
+    while (machine->emulator.is_powered_up()) {
+        if (lockstep.has_value()) [[unlikely]] {
+            if (const auto divergence = lockstep->step(); divergence.has_value()) {
+                divergence->write(stderr);
+                diverged = true;
+                break;
+            }
+        } else {
+            machine->emulator.step();
+        }
+        machine->profiler.step();
+        instructions += 1;
+
+        if (timeline.has_value()) [[unlikely]] {
+            timeline->step(*machine);
+            if (options->stop_after_milestones && timeline->all_reached())
+                break;
+        }
+
+        if (instructions >= max_instructions) [[unlikely]] {
+            limit_reached = true;
+            break;
+        }
+
+        if (statistics_file != nullptr && options->statistics_interval != 0 && instructions % options->statistics_interval == 0) [[unlikely]]
+            write_statistics(statistics_file, *machine);
+
+        if (options->timeout.has_value() && instructions % TimeLimitCheckInterval == 0) [[unlikely]] {
+            if (std::chrono::steady_clock::now() - start_time >= *options->timeout) {
+                limit_reached = true;
+                break;
+            }
+        }
+    }
+
+    if (statistics_file != nullptr) {
+        write_statistics(statistics_file, *machine);
+        std::fclose(statistics_file);
+    }
+
+    if (timeline.has_value()) {
+        if (std::FILE *file = std::fopen(options->milestones_path, "w"); file != nullptr) {
+            timeline->write(file, *machine);
+            std::fclose(file);
+        } else {
+            std::fprintf(stderr, "Failed to write milestones '%s'\n", options->milestones_path);
+        }
+    }
+
+    if (options->profile_path != nullptr) {
+        machine->profiler.stop();
+        if (!write_profile(options->profile_path, machine->profiler, symbols))
+            std::fprintf(stderr, "Failed to write profile '%s'\n", options->profile_path);
+    }
+
+    machine->mmio_tracer.stop();
+    if (const auto dropped = machine->mmio_tracer.dropped_records(); dropped > 0)
+        std::fprintf(stderr, "Dropped %llu MMIO trace records\n", static_cast<unsigned long long>(dropped));
+
+    std::fflush(output);
+    if (output != stdout)
+        std::fclose(output);
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::fprintf(stderr, "Executed %llu instructions in %.3fs\n", static_cast<unsigned long long>(instructions), elapsed.count());
+
+    if (diverged)
+        return ExitGuestFailure;
+
+    if (limit_reached) {
+        std::fprintf(stderr, "Limit reached before the guest shut down\n");
+        return ExitLimitReached;
+    }
+
+    if (timeline.has_value() && options->stop_after_milestones && timeline->all_reached()) {
+        std::fprintf(stderr, "All milestones reached\n");
+        return ExitGuestShutdown;
+    }
+
+    switch (machine->emulator.shutdown_reason().value_or(emu::riscv::m_mode::ResetReason::SystemFailure)) {
+        using enum emu::riscv::m_mode::ResetReason;
+        case NoReason:
+            return ExitGuestShutdown;
+        default:
+        case SystemFailure:
+            std::fprintf(stderr, "Guest shut down due to a system failure\n");
+            return ExitGuestFailure;
+    }
+}
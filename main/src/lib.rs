@@ -7,6 +7,22 @@ extern "C" {
     fn stop_emulation();
     fn is_emulation_running() -> bool;
     fn set_device_tree_source(source: *mut c_char, length: c_size_t);
+    fn get_ram_page_count() -> c_size_t;
+    fn get_dirty_pages(bitmap: *mut u64, word_count: c_size_t, clear: bool) -> c_size_t;
+    fn send_terminal_input(terminal_id: *const c_char, text: *const c_char);
+    fn set_input_recording_path(path: *const c_char);
+    fn set_input_replay_path(path: *const c_char);
+    fn pause_emulation();
+    fn resume_emulation();
+    fn reverse_step(count: u64) -> u64;
+    fn reverse_to_previous_write(address: u32, size: u32, tick: *mut u64, pc: *mut u32) -> bool;
+    fn set_checkpoint_interval(interval: u64, max_checkpoints: c_size_t);
+    fn start_mmio_trace(path: *const c_char) -> bool;
+    fn stop_mmio_trace();
+    fn set_mmio_trace_region(address: u32, enabled: bool) -> bool;
+    fn get_core_statistics(hart: u16, statistics: *mut interface::CoreStatistics) -> bool;
+    fn get_peripheral_statistics(statistics: *mut interface::PeripheralStatistics, count: c_size_t) -> c_size_t;
+    fn get_telemetry(telemetry: *mut interface::Telemetry);
 }
 
 mod interface {
@@ -60,6 +76,216 @@ mod interface {
         }
     }
 
+    #[tauri::command]
+    pub fn send_terminal_input(terminal_id: &str, data: &str) {
+        use std::ffi::CString;
+
+        let (Ok(terminal_id), Ok(data)) = (CString::new(terminal_id), CString::new(data)) else {
+            return;
+        };
+
+        unsafe {
+            crate::send_terminal_input(terminal_id.as_ptr(), data.as_ptr());
+        }
+    }
+
+    // Record all inputs of the next emulation run to the given file, or stop recording if no path is given
+    #[tauri::command]
+    pub fn set_input_recording(path: Option<String>) {
+        use std::ffi::CString;
+
+        let path = CString::new(path.unwrap_or_default()).unwrap_or_default();
+        unsafe {
+            crate::set_input_recording_path(path.as_ptr());
+        }
+    }
+
+    // Replay the inputs of a previous recording during the next emulation run instead of taking live inputs
+    #[tauri::command]
+    pub fn set_input_replay(path: Option<String>) {
+        use std::ffi::CString;
+
+        let path = CString::new(path.unwrap_or_default()).unwrap_or_default();
+        unsafe {
+            crate::set_input_replay_path(path.as_ptr());
+        }
+    }
+
+    #[tauri::command]
+    pub fn pause_emulation() {
+        unsafe {
+            crate::pause_emulation();
+        }
+    }
+
+    #[tauri::command]
+    pub fn resume_emulation() {
+        unsafe {
+            crate::resume_emulation();
+        }
+    }
+
+    // Pauses the emulation and steps backwards, returns the tick that was reached
+    #[tauri::command]
+    pub fn reverse_step(count: u64) -> u64 {
+        unsafe {
+            crate::reverse_step(count)
+        }
+    }
+
+    #[derive(Clone, Serialize)]
+    pub struct WriteLocation {
+        tick: u64,
+        pc: u32,
+    }
+
+    // Pauses the emulation and goes back to the instruction that last wrote to the given physical address range
+    #[tauri::command]
+    pub fn reverse_to_previous_write(address: u32, size: u32) -> Option<WriteLocation> {
+        let mut location = WriteLocation { tick: 0, pc: 0 };
+        let found = unsafe {
+            crate::reverse_to_previous_write(address, size, &mut location.tick, &mut location.pc)
+        };
+
+        found.then_some(location)
+    }
+
+    // Checkpoints are taken every `interval` steps, at most `max_checkpoints` of them are kept around
+    #[tauri::command]
+    pub fn set_checkpoint_interval(interval: u64, max_checkpoints: usize) {
+        unsafe {
+            crate::set_checkpoint_interval(interval, max_checkpoints);
+        }
+    }
+
+    // Writes all accesses to traced peripherals into the given file until the trace is stopped
+    #[tauri::command]
+    pub fn start_mmio_trace(path: String) -> bool {
+        use std::ffi::CString;
+
+        let Ok(path) = CString::new(path) else {
+            return false;
+        };
+
+        unsafe {
+            crate::start_mmio_trace(path.as_ptr())
+        }
+    }
+
+    #[tauri::command]
+    pub fn stop_mmio_trace() {
+        unsafe {
+            crate::stop_mmio_trace();
+        }
+    }
+
+    // Enables or disables tracing of the peripheral mapped at the given address
+    #[tauri::command]
+    pub fn set_mmio_trace_region(address: u32, enabled: bool) -> bool {
+        unsafe {
+            crate::set_mmio_trace_region(address, enabled)
+        }
+    }
+
+    // Mirrors ds::emu::riscv::CoreStatistics
+    #[repr(C)]
+    #[derive(Clone, Default, Serialize)]
+    #[serde(rename_all = "camelCase")]
+    pub struct CoreStatistics {
+        cycles: u64,
+        instructions_retired: u64,
+        idle_steps: u64,
+        taken_branches: u64,
+        mmio_accesses: u64,
+        opcodes: [u64; 32],
+        exceptions: [u64; 32],
+        interrupts: [u64; 32],
+        misaligned_accesses: u64,
+        tlb_hits: u64,
+        tlb_misses: u64,
+        page_table_reads: u64,
+    }
+
+    // Has to match the size checked next to get_core_statistics in interface.cpp
+    const _: () = assert!(std::mem::size_of::<CoreStatistics>() == 840);
+
+    #[repr(C)]
+    #[derive(Clone, Default, Serialize)]
+    #[serde(rename_all = "camelCase")]
+    pub struct PeripheralStatistics {
+        base_address: u32,
+        size: u32,
+        reads: u64,
+        writes: u64,
+    }
+
+    #[tauri::command]
+    pub fn get_core_statistics(hart: u16) -> Option<CoreStatistics> {
+        let mut statistics = CoreStatistics::default();
+        let found = unsafe {
+            crate::get_core_statistics(hart, &mut statistics)
+        };
+
+        found.then_some(statistics)
+    }
+
+    #[tauri::command]
+    pub fn get_peripheral_statistics() -> Vec<PeripheralStatistics> {
+        unsafe {
+            let count = crate::get_peripheral_statistics(std::ptr::null_mut(), 0);
+            let mut statistics = vec![PeripheralStatistics::default(); count];
+            let count = crate::get_peripheral_statistics(statistics.as_mut_ptr(), statistics.len());
+            statistics.truncate(count);
+
+            statistics
+        }
+    }
+
+    // Mirrors Telemetry in the interface library
+    #[repr(C)]
+    #[derive(Clone, Default, Serialize)]
+    #[serde(rename_all = "camelCase")]
+    pub struct Telemetry {
+        mips: f64,
+        instructions_retired: u64,
+        virtual_time_ratio: f64,
+        tlb_hit_rate: f64,
+        idle_percentage: f64,
+    }
+
+    // Returns the most recently published performance figures of the emulation, cheap enough to poll
+    #[tauri::command]
+    pub fn get_telemetry() -> Telemetry {
+        let mut telemetry = Telemetry::default();
+        unsafe {
+            crate::get_telemetry(&mut telemetry);
+        }
+
+        telemetry
+    }
+
+    // Returns the indices of all RAM pages written since the last time the bitmap was cleared
+    #[tauri::command]
+    pub fn get_dirty_pages(clear: bool) -> Vec<u32> {
+        let bitmap = unsafe {
+            let page_count = crate::get_ram_page_count();
+            let mut bitmap = vec![0u64; page_count.div_ceil(64)];
+            crate::get_dirty_pages(bitmap.as_mut_ptr(), bitmap.len(), clear);
+
+            bitmap
+        };
+
+        bitmap
+            .iter()
+            .enumerate()
+            .flat_map(|(index, word)| {
+                (0..64)
+                    .filter(move |bit| word & (1u64 << bit) != 0)
+                    .map(move |bit| (index * 64 + bit) as u32)
+            })
+            .collect()
+    }
+
 }
 
 pub fn run() {
@@ -71,7 +297,25 @@ pub fn run() {
             interface::APP_HANDLE.set(app.handle().clone()).unwrap();
             Ok(())
         })
-        .invoke_handler(tauri::generate_handler![interface::start_emulation, interface::stop_emulation])
+        .invoke_handler(tauri::generate_handler![
+            interface::start_emulation,
+            interface::stop_emulation,
+            interface::send_terminal_input,
+            interface::set_input_recording,
+            interface::set_input_replay,
+            interface::get_dirty_pages,
+            interface::pause_emulation,
+            interface::resume_emulation,
+            interface::reverse_step,
+            interface::reverse_to_previous_write,
+            interface::set_checkpoint_interval,
+            interface::start_mmio_trace,
+            interface::stop_mmio_trace,
+            interface::set_mmio_trace_region,
+            interface::get_core_statistics,
+            interface::get_peripheral_statistics,
+            interface::get_telemetry
+        ])
         .run(tauri::generate_context!())
         .expect("error while running tauri application");
 }